@@ -0,0 +1,1635 @@
+//***************************************************************************************
+// Benchmarks.cpp
+//***************************************************************************************
+
+#include "Benchmarks.h"
+#include "BlockCulling.h"
+#include "IndirectArgs.h"
+#include "FrameSubmission.h"
+#include "RecordingBackend.h"
+#include "UploadArena.h"
+#include "TransformStore.h"
+#include "ObjectPool.h"
+#include "Chunk.h"
+#include "ChunkMesher.h"
+#include "WorldEdit.h"
+#include "WorldFile.h"
+#include "MappedRegion.h"
+#include "MeshCache.h"
+#include "ChunkResidency.h"
+#include "ChunkStreamer.h"
+#include "Terrain.h"
+#include "Simd.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock BenchClock;
+
+	double ElapsedMilliseconds(BenchClock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+	}
+
+	// Stops the optimizer from discarding work whose result is otherwise unused.
+	volatile std::size_t gBenchSink = 0;
+
+	// ChunkDims with the sizes as data, as the chunk code would be without templates.
+	struct RuntimeChunkDims
+	{
+		std::uint32_t SizeX;
+		std::uint32_t SizeY;
+		std::uint32_t SizeZ;
+
+		std::uint32_t Index(std::uint32_t x, std::uint32_t y, std::uint32_t z)const
+		{
+			return x + SizeX * (z + SizeZ * y);
+		}
+
+		bool Contains(std::int32_t x, std::int32_t y, std::int32_t z)const
+		{
+			return (std::uint32_t)x < SizeX && (std::uint32_t)y < SizeY && (std::uint32_t)z < SizeZ;
+		}
+
+		std::uint32_t Neighbour(std::uint32_t index, BlockFace face)const
+		{
+			return index + BlockFaceStepX(face) + std::int32_t(SizeX) * (BlockFaceStepZ(face) + std::int32_t(SizeZ) * BlockFaceStepY(face));
+		}
+	};
+
+	// The sizes read back through volatile, so the optimizer cannot fold them into the
+	// loops the way it does template arguments.
+	RuntimeChunkDims OpaqueChunkDims(std::uint32_t sizeX, std::uint32_t sizeY, std::uint32_t sizeZ)
+	{
+		volatile std::uint32_t sizes[3] = { sizeX, sizeY, sizeZ };
+		RuntimeChunkDims dims = { sizes[0], sizes[1], sizes[2] };
+		return dims;
+	}
+
+	// Faces of solid blocks that touch air or the chunk's edge, as a mesher counts them.
+	template<typename Dims>
+	std::size_t CountExposedFaces(const Dims& dims, std::uint32_t sizeX, std::uint32_t sizeY, std::uint32_t sizeZ,
+		const BlockType* blocks)
+	{
+		std::size_t faces = 0;
+		for(std::uint32_t y = 0; y < sizeY; ++y)
+		{
+			for(std::uint32_t z = 0; z < sizeZ; ++z)
+			{
+				for(std::uint32_t x = 0; x < sizeX; ++x)
+				{
+					std::uint32_t index = dims.Index(x, y, z);
+					if(blocks[index] == BlockType_Air)
+						continue;
+
+					for(std::uint32_t f = 0; f < BlockFace_Count; ++f)
+					{
+						BlockFace face = (BlockFace)f;
+						if(!dims.Contains(x + BlockFaceStepX(face), y + BlockFaceStepY(face), z + BlockFaceStepZ(face)) ||
+							blocks[dims.Neighbour(index, face)] == BlockType_Air)
+						{
+							faces++;
+						}
+					}
+				}
+			}
+		}
+		return faces;
+	}
+
+	// Walks the blocks in storage order and, for each solid one, counts its faces that
+	// touch air and its solid neighbours among all 26, as meshing with ambient occlusion
+	// does.  Every neighbour is reached by stepping through Neighbour(), one axis at a
+	// time, so neither layout encodes coordinates inside the loop.
+	template<typename Dims>
+	std::size_t CountNeighbours(const BlockType* blocks)
+	{
+		std::size_t count = 0;
+		for(std::uint32_t index = 0; index < Dims::Volume; ++index)
+		{
+			if(blocks[index] == BlockType_Air)
+				continue;
+
+			std::int32_t x = Dims::X(index), y = Dims::Y(index), z = Dims::Z(index);
+			for(std::uint32_t f = 0; f < BlockFace_Count; ++f)
+			{
+				BlockFace face = (BlockFace)f;
+				if(Dims::Contains(x + BlockFaceStepX(face), y + BlockFaceStepY(face), z + BlockFaceStepZ(face)) &&
+					blocks[Dims::Neighbour(index, face)] == BlockType_Air)
+				{
+					count++;
+				}
+			}
+
+			for(std::int32_t dy = -1; dy <= 1; ++dy)
+			{
+				if(!Dims::Contains(x, y + dy, z))
+					continue;
+				std::uint32_t row = dy == 0 ? index : Dims::Neighbour(index, dy < 0 ? BlockFace_NegY : BlockFace_PosY);
+
+				for(std::int32_t dz = -1; dz <= 1; ++dz)
+				{
+					if(!Dims::Contains(x, y, z + dz))
+						continue;
+					std::uint32_t line = dz == 0 ? row : Dims::Neighbour(row, dz < 0 ? BlockFace_NegZ : BlockFace_PosZ);
+
+					if(Dims::Contains(x - 1, y, z))
+						count += blocks[Dims::Neighbour(line, BlockFace_NegX)] != BlockType_Air;
+					count += blocks[line] != BlockType_Air;
+					if(Dims::Contains(x + 1, y, z))
+						count += blocks[Dims::Neighbour(line, BlockFace_PosX)] != BlockType_Air;
+				}
+			}
+		}
+		return count;
+	}
+
+	// Fills a chunk of either layout with the same ground and caves.
+	template<typename ChunkType>
+	void FillBenchmarkTerrain(ChunkType& chunk, std::uint32_t seed)
+	{
+		typedef typename ChunkType::Dims Dims;
+		for(std::uint32_t y = 0; y < Dims::SizeY; ++y)
+		{
+			for(std::uint32_t z = 0; z < Dims::SizeZ; ++z)
+			{
+				for(std::uint32_t x = 0; x < Dims::SizeX; ++x)
+				{
+					bool ground = y < Dims::SizeY / 2 + (x * 7 + z * 13 + seed) % 5;
+					bool cave = (x * 31 + y * 17 + z * 11) % 13 == 0;
+					chunk.Set(x, y, z, ground && !cave ? BlockType_Stone : BlockType_Air);
+				}
+			}
+		}
+	}
+
+	template<std::uint32_t Size>
+	BenchmarkResult BenchmarkChunkOrder(const char* name, std::size_t blockCount, int runs)
+	{
+		typedef Chunk<Size, Size, Size, LinearLayout> LinearChunk;
+		typedef Chunk<Size, Size, Size, MortonLayout> MortonChunk;
+
+		std::size_t chunkCount = (blockCount + LinearChunk::Dims::Volume - 1) / LinearChunk::Dims::Volume;
+		std::vector<LinearChunk> linearChunks(chunkCount);
+		std::vector<MortonChunk> mortonChunks(chunkCount);
+		for(std::size_t c = 0; c < chunkCount; ++c)
+		{
+			FillBenchmarkTerrain(linearChunks[c], (std::uint32_t)c);
+			FillBenchmarkTerrain(mortonChunks[c], (std::uint32_t)c);
+		}
+
+		std::size_t linearCount = 0;
+		BenchClock::time_point start = BenchClock::now();
+		for(int run = 0; run < runs; ++run)
+		{
+			for(const LinearChunk& chunk : linearChunks)
+				linearCount += CountNeighbours<typename LinearChunk::Dims>(chunk.Data());
+		}
+		double linearMs = ElapsedMilliseconds(start);
+
+		std::size_t mortonCount = 0;
+		start = BenchClock::now();
+		for(int run = 0; run < runs; ++run)
+		{
+			for(const MortonChunk& chunk : mortonChunks)
+				mortonCount += CountNeighbours<typename MortonChunk::Dims>(chunk.Data());
+		}
+		double mortonMs = ElapsedMilliseconds(start);
+		gBenchSink = gBenchSink + linearCount + mortonCount;
+
+		char detail[160];
+		std::snprintf(detail, sizeof(detail), "[%zu chunks%s; row-major: %.3f ms, %.2fx%s]",
+			chunkCount, BLEND_BMI2 ? ", pdep/pext" : "", linearMs / runs, mortonMs > 0.0 ? linearMs / mortonMs : 0.0,
+			linearCount == mortonCount ? "" : ", COUNTS DIFFER");
+
+		BenchmarkResult result;
+		result.Name = name;
+		result.Items = chunkCount * LinearChunk::Dims::Volume;
+		result.MillisecondsPerRun = mortonMs / runs;
+		result.Detail = detail;
+		return result;
+	}
+
+	template<std::uint32_t SX, std::uint32_t SY, std::uint32_t SZ>
+	BenchmarkResult BenchmarkChunkLayout(const char* name, std::size_t blockCount, int runs)
+	{
+		typedef Chunk<SX, SY, SZ> ChunkType;
+		typedef typename ChunkType::Dims Dims;
+
+		// Rolling ground about half way up each chunk, with a scattering of caves.
+		std::size_t chunkCount = (blockCount + Dims::Volume - 1) / Dims::Volume;
+		std::vector<ChunkType> chunks(chunkCount);
+		for(std::size_t c = 0; c < chunkCount; ++c)
+		{
+			for(std::uint32_t index = 0; index < Dims::Volume; ++index)
+			{
+				std::uint32_t x = Dims::X(index), y = Dims::Y(index), z = Dims::Z(index);
+				bool ground = y < SY / 2 + (x * 7 + z * 13 + (std::uint32_t)c) % 5;
+				bool cave = (x * 31 + y * 17 + z * 11) % 13 == 0;
+				chunks[c][index] = ground && !cave ? BlockType_Stone : BlockType_Air;
+			}
+		}
+
+		std::size_t faces = 0;
+		const RuntimeChunkDims runtimeDims = OpaqueChunkDims(SX, SY, SZ);
+
+		// The fences make every run count the faces again, where the optimizer would
+		// otherwise see that the chunks did not change and reuse the first run's counts.
+		BenchClock::time_point start = BenchClock::now();
+		for(int run = 0; run < runs; ++run)
+		{
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+			for(const ChunkType& chunk : chunks)
+				faces += CountExposedFaces(runtimeDims, runtimeDims.SizeX, runtimeDims.SizeY, runtimeDims.SizeZ, chunk.Data());
+		}
+		double runtimeMs = ElapsedMilliseconds(start);
+
+		start = BenchClock::now();
+		for(int run = 0; run < runs; ++run)
+		{
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+			for(const ChunkType& chunk : chunks)
+				faces += CountExposedFaces(Dims(), SX, SY, SZ, chunk.Data());
+		}
+		double constMs = ElapsedMilliseconds(start);
+		gBenchSink = gBenchSink + faces;
+
+		char detail[128];
+		std::snprintf(detail, sizeof(detail), "[%zu chunks; run time sizes: %.3f ms, %.2fx]",
+			chunkCount, runtimeMs / runs, constMs > 0.0 ? runtimeMs / constMs : 0.0);
+
+		BenchmarkResult result;
+		result.Name = name;
+		result.Items = chunkCount * Dims::Volume;
+		result.MillisecondsPerRun = constMs / runs;
+		result.Detail = detail;
+		return result;
+	}
+}
+
+std::string BenchmarkResult::ToString()const
+{
+	char buffer[256];
+	double nsPerItem = Items > 0 ? MillisecondsPerRun * 1.0e6 / (double)Items : 0.0;
+	std::snprintf(buffer, sizeof(buffer), "%s: %.3f ms for %zu items (%.2f ns/item)",
+		Name.c_str(), MillisecondsPerRun, Items, nsPerItem);
+
+	std::string text = buffer;
+	if(!Detail.empty())
+		text += " " + Detail;
+	return text;
+}
+
+BenchmarkResult BenchmarkCullAndIndirectArgs(std::size_t blockCount, int runs)
+{
+	// Square world, eight blocks deep, seen by a camera looking along +z from the edge.
+	std::size_t side = 1;
+	while(side * side * 8 < blockCount)
+		++side;
+
+	BlockInstanceList blocks;
+	blocks.Reserve(blockCount);
+	for(std::size_t i = 0; i < blockCount; ++i)
+	{
+		float x = (float)(i % side) - side * 0.5f;
+		float z = (float)((i / side) % side);
+		float y = (float)(i / (side * side));
+		blocks.Add(x, y, z, (std::uint32_t)(i % 5), 0);
+	}
+
+	// Perspective looking down +z with a 90 degree field of view, near 1, far 1000.
+	const float n = 1.0f, f = 1000.0f;
+	const float viewProj[16] =
+	{
+		1.0f, 0.0f, 0.0f,             0.0f,
+		0.0f, 1.0f, 0.0f,             0.0f,
+		0.0f, 0.0f, f / (f - n),      1.0f,
+		0.0f, -4.0f, -n * f / (f - n), 0.0f,
+	};
+
+	CullFrustum frustum;
+	ExtractFrustumPlanes(viewProj, frustum);
+
+	std::vector<BlockInstance> instances(blockCount);
+	std::vector<IndirectDrawArgs> args(1);
+	IndirectArgsBuilder builder;
+
+	IndirectMesh box;
+	box.IndexCount = 36;
+
+	auto start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		std::size_t visible = CullBlockInstances(blocks, 0.5f, frustum, instances.data());
+
+		builder.Reset(1);
+		builder.AddDraw(0, box, 0, (std::uint32_t)visible);
+		gBenchSink = gBenchSink + builder.Write(args.data()) + visible;
+	}
+
+	BenchmarkResult result;
+	result.Name = "Cull blocks and build indirect args";
+	result.Items = blockCount;
+	result.MillisecondsPerRun = ElapsedMilliseconds(start) / runs;
+	return result;
+}
+
+namespace
+{
+	// Records ranges of the queue into one RecordingRenderContext per list.
+	class HeadlessFrameRecorder : public RangeRecorder
+	{
+	public:
+		HeadlessFrameRecorder(const RenderQueue& queue, const std::vector<QueuedDraw>& draws, const FrameBuffers& frame,
+			std::uint32_t listCount)
+			: mQueue(queue), mDraws(draws), mFrame(frame), mContexts(listCount), mStates(listCount)
+		{
+		}
+
+		virtual void RecordRange(std::uint32_t list, const DrawRange& range)override
+		{
+			mContexts[list].SetConstantBuffer(RootSlot_Pass, mFrame.Pass, mFrame.PassElement);
+			SubmitQueuedDraws(mContexts[list], mQueue, range, mDraws.data(), mFrame, mStates[list]);
+		}
+
+		RecordingRenderContext& Context(std::uint32_t list) { return mContexts[list]; }
+
+	private:
+		const RenderQueue& mQueue;
+		const std::vector<QueuedDraw>& mDraws;
+		const FrameBuffers& mFrame;
+		std::vector<RecordingRenderContext> mContexts;
+		std::vector<DrawStateCache> mStates;
+	};
+
+	BufferHandle CreateBenchBuffer(RenderDevice& device, BufferUsage usage, std::size_t count, std::uint32_t byteSize, const void* data)
+	{
+		BufferDesc desc;
+		desc.Usage = usage;
+		desc.ElementCount = (std::uint32_t)count;
+		desc.ElementByteSize = byteSize;
+		desc.CpuWritable = data == nullptr;
+		return device.CreateBuffer(desc, data);
+	}
+}
+
+BenchmarkResult BenchmarkHeadlessFrame(std::size_t blockCount, std::size_t queuedCount, int runs)
+{
+	const std::uint32_t listCount = 4;
+	const std::uint32_t materialCount = 8;
+
+	// Roughly the sizes of the real vertex and constant structures, which need DirectXMath.
+	const std::uint32_t vertexSize = 32, objectSize = 144, materialSize = 96, passSize = 1024;
+
+	RecordingRenderDevice device;
+
+	std::vector<std::uint8_t> boxVertices(24 * vertexSize);
+	std::vector<std::uint16_t> boxIndices(36);
+	BufferHandle vertices = CreateBenchBuffer(device, BufferUsage::Vertex, 24, vertexSize, boxVertices.data());
+	BufferHandle indices = CreateBenchBuffer(device, BufferUsage::Index, 36, sizeof(std::uint16_t), boxIndices.data());
+
+	FrameBuffers frame;
+	frame.Object = CreateBenchBuffer(device, BufferUsage::Constant, queuedCount, objectSize, nullptr);
+	frame.Material = CreateBenchBuffer(device, BufferUsage::Structured, materialCount, materialSize, nullptr);
+	frame.IndirectArgs = CreateBenchBuffer(device, BufferUsage::IndirectArgs, 1, sizeof(IndirectDrawArgs), nullptr);
+
+	UploadArena arena(device, passSize + (std::uint32_t)(blockCount * sizeof(BlockInstance)) + UploadArena::Granularity);
+
+	// Same flat world and camera as the culling benchmark.
+	std::size_t side = 1;
+	while(side * side * 8 < blockCount)
+		++side;
+
+	BlockInstanceList blocks;
+	blocks.Reserve(blockCount);
+	for(std::size_t i = 0; i < blockCount; ++i)
+		blocks.Add((float)(i % side) - side * 0.5f, (float)(i / (side * side)), (float)((i / side) % side), (std::uint32_t)(i % 5), 0);
+
+	const float n = 1.0f, f = 1000.0f;
+	const float viewProj[16] =
+	{
+		1.0f, 0.0f, 0.0f,             0.0f,
+		0.0f, 1.0f, 0.0f,             0.0f,
+		0.0f, 0.0f, f / (f - n),      1.0f,
+		0.0f, -4.0f, -n * f / (f - n), 0.0f,
+	};
+
+	CullFrustum frustum;
+	ExtractFrustumPlanes(viewProj, frustum);
+
+	// Queued items spread over three layers and a few materials, as the shadows, water
+	// and alpha tested blocks are.
+	std::vector<std::uint64_t> staticKeys(queuedCount);
+	for(std::size_t i = 0; i < queuedCount; ++i)
+	{
+		std::uint32_t layer = 1 + (std::uint32_t)(i % 3);
+		staticKeys[i] = RenderQueue::MakeKey(layer, layer, 0, (std::uint32_t)(i * 7 % materialCount));
+	}
+
+	std::vector<std::uint8_t> objectConstants(objectSize);
+	std::vector<std::uint8_t> passConstants(passSize);
+
+	RenderQueue queue;
+	std::vector<QueuedDraw> draws;
+	IndirectArgsBuilder args;
+	ParallelRecorder recorder(listCount);
+	HeadlessFrameRecorder frameRecorder(queue, draws, frame, listCount);
+	RecordingRenderContext mainContext;
+
+	IndirectMesh box;
+	box.IndexCount = 36;
+
+	device.ResetStats();
+
+	auto start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		// Update: every queued item's constants, then the pass and the instances from
+		// the arena.
+		arena.Reset();
+		for(std::size_t i = 0; i < queuedCount; ++i)
+			device.WriteElement(frame.Object, (std::uint32_t)i, objectConstants.data(), objectSize);
+
+		UploadAllocation pass = arena.Allocate(passSize);
+		std::memcpy(pass.Data, passConstants.data(), passSize);
+		frame.Pass = pass.Buffer;
+		frame.PassElement = pass.Element;
+
+		UploadAllocation instances = arena.Allocate((std::uint32_t)(blockCount * sizeof(BlockInstance)));
+		std::uint32_t visible = (std::uint32_t)CullBlockInstances(blocks, 0.5f, frustum, static_cast<BlockInstance*>(instances.Data));
+		frame.Instances = instances.Buffer;
+		frame.InstancesElement = instances.Element;
+
+		args.Reset(1);
+		args.AddDraw(0, box, 0, visible);
+		args.Write(static_cast<IndirectDrawArgs*>(device.MapElements(frame.IndirectArgs, 0, (std::uint32_t)args.RecordCount())));
+
+		// Draw: the instanced layer, then the render queue in parallel ranges.
+		mainContext.SetConstantBuffer(RootSlot_Pass, frame.Pass, frame.PassElement);
+		SubmitInstancedLayer(mainContext, 0, vertices, indices, args, 0, frame);
+
+		queue.Clear();
+		draws.clear();
+		for(std::size_t i = 0; i < queuedCount; ++i)
+		{
+			QueuedDraw draw;
+			draw.Vertices = vertices;
+			draw.Indices = indices;
+			draw.Material = RenderQueue::KeyMaterial(staticKeys[i]);
+			draw.Texture = draw.Material;
+			draw.Object = (std::uint32_t)i;
+			draw.IndexCount = 36;
+
+			std::uint32_t depth = RenderQueue::QuantizeDepth((float)((i * 2654435761u) % 1000), n, f, false);
+			queue.Push(staticKeys[i] | depth, (std::uint32_t)draws.size());
+			draws.push_back(draw);
+		}
+		queue.Sort();
+
+		recorder.Split(queue.Size(), 256);
+		recorder.Record(frameRecorder);
+	}
+	double ms = ElapsedMilliseconds(start);
+
+	RenderBackendStats stats = device.Stats();
+	stats.Accumulate(mainContext.Stats());
+	for(std::uint32_t i = 0; i < listCount; ++i)
+		stats.Accumulate(frameRecorder.Context(i).Stats());
+
+	char detail[256];
+	std::snprintf(detail, sizeof(detail), "[per frame: %u draws, %u indirect records, %u state changes, %llu bytes uploaded]",
+		stats.Draws / runs, stats.IndirectRecords / runs, stats.StateChanges() / runs,
+		(unsigned long long)(stats.BytesUploaded / runs));
+	gBenchSink = gBenchSink + stats.Draws;
+
+	BenchmarkResult result;
+	result.Name = "Headless frame";
+	result.Items = blockCount + queuedCount;
+	result.MillisecondsPerRun = ms / runs;
+	result.Detail = detail;
+	return result;
+}
+
+namespace
+{
+	// Whether replaying the ranges made the same state changes recording them did.
+	bool SameStateChanges(const RenderQueueStats& replayed, const RenderBackendStats& recorded)
+	{
+		return replayed.Draws == recorded.Draws && replayed.PsoSets == recorded.PipelineSets &&
+			replayed.GeometrySets == recorded.GeometrySets && replayed.TopologySets == recorded.TopologySets &&
+			replayed.MaterialSets == recorded.TableSets;
+	}
+}
+
+std::vector<BenchmarkResult> BenchmarkRangeSplit(std::size_t queuedCount, int runs)
+{
+	const std::uint32_t materialCount = 8, geometryCount = 4;
+
+	// A sorted queue over three layers, a few meshes and materials, with every sixteenth
+	// item drawn as lines as a debug overlay would be.
+	RenderQueue queue;
+	std::vector<QueuedDraw> draws(queuedCount);
+	for(std::size_t i = 0; i < queuedCount; ++i)
+	{
+		std::uint32_t layer = 1 + (std::uint32_t)(i % 3);
+		std::uint32_t geometry = (std::uint32_t)(i * 5 % geometryCount);
+
+		QueuedDraw& draw = draws[i];
+		draw.Vertices = geometry;
+		draw.Indices = geometry;
+		draw.Geometry = geometry;
+		draw.Topology = i % 16 == 0 ? PrimitiveTopology::LineList : PrimitiveTopology::TriangleList;
+		draw.Material = (std::uint32_t)(i * 7 % materialCount);
+		draw.Texture = draw.Material;
+		draw.Object = (std::uint32_t)i;
+		draw.IndexCount = 36;
+
+		std::uint64_t key = RenderQueue::MakeKey(layer, layer, geometry, draw.Material);
+		queue.Push(key | RenderQueue::QuantizeDepth((float)((i * 2654435761u) % 1000), 1.0f, 1000.0f, false), (std::uint32_t)i);
+	}
+	queue.Sort();
+
+	FrameBuffers frame;
+	std::uint32_t oneListChanges = 0;
+
+	std::vector<BenchmarkResult> results;
+	for(std::uint32_t listCount = 1; listCount <= 8; listCount *= 2)
+	{
+		ParallelRecorder recorder(listCount);
+		recorder.Split(queue.Size(), 64);
+
+		// The same ranges recorded through SubmitQueuedDraws, once, to check the replay.
+		HeadlessFrameRecorder submitted(queue, draws, frame, listCount);
+		recorder.Record(submitted);
+
+		RenderBackendStats recorded;
+		for(std::uint32_t i = 0; i < listCount; ++i)
+			recorded.Accumulate(submitted.Context(i).Stats());
+
+		HeadlessRangeRecorder replay(queue, draws.data(), listCount);
+
+		auto start = BenchClock::now();
+		for(int run = 0; run < runs; ++run)
+			recorder.Record(replay);
+		double ms = ElapsedMilliseconds(start);
+
+		RenderQueueStats stats = replay.TotalStats();
+		if(listCount == 1)
+			oneListChanges = stats.StateChangesIssued();
+
+		char name[64];
+		std::snprintf(name, sizeof(name), "Range split %u lists", listCount);
+
+		char detail[256];
+		std::snprintf(detail, sizeof(detail), "[%zu ranges, %u state changes, %+d against one list, %u topology sets; %s]",
+			recorder.Ranges().size(), stats.StateChangesIssued(), (int)stats.StateChangesIssued() - (int)oneListChanges,
+			stats.TopologySets, SameStateChanges(stats, recorded) ? "matches SubmitQueuedDraws" : "DIFFERS from SubmitQueuedDraws");
+		gBenchSink = gBenchSink + stats.Draws;
+
+		BenchmarkResult result;
+		result.Name = name;
+		result.Items = queuedCount;
+		result.MillisecondsPerRun = ms / runs;
+		result.Detail = detail;
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+BenchmarkResult BenchmarkTransformUpload(std::size_t objectCount, int runs)
+{
+	// Same layout as ObjectConstants: transposed world, then transposed texture transform.
+	struct ObjectTransforms
+	{
+		float World[16];
+		float TexTransform[16];
+	};
+
+	std::vector<ObjectTransforms> items(objectCount);
+	TransformStore store;
+	for(std::size_t i = 0; i < objectCount; ++i)
+	{
+		ObjectTransforms& item = items[i];
+		for(int e = 0; e < 16; ++e)
+		{
+			item.World[e] = (e % 5 == 0) ? 1.0f : 0.0f;
+			item.TexTransform[e] = item.World[e];
+		}
+		item.World[12] = (float)(i % 64);
+		item.World[13] = (float)((i / 64) % 8);
+		item.World[14] = (float)(i / 512);
+
+		store.Add(item.World, item.TexTransform);
+	}
+
+	RecordingRenderDevice device;
+	BufferDesc desc;
+	desc.Usage = BufferUsage::Constant;
+	desc.ElementCount = (std::uint32_t)objectCount;
+	desc.ElementByteSize = sizeof(ObjectTransforms);
+	desc.CpuWritable = true;
+	BufferHandle objectCB = device.CreateBuffer(desc, nullptr);
+	std::uint32_t stride = device.ElementStride(objectCB);
+
+	// One object at a time, as UpdateObjectCBs used to: load the rows of each matrix,
+	// transpose, store to a local and copy that into the buffer.
+	BenchClock::time_point start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		for(std::size_t i = 0; i < objectCount; ++i)
+		{
+			ObjectTransforms constants;
+			const float* src[2] = { items[i].World, items[i].TexTransform };
+			float* dst[2] = { constants.World, constants.TexTransform };
+			for(int m = 0; m < 2; ++m)
+			{
+#if BLEND_SSE2
+				__m128 r0 = _mm_loadu_ps(src[m] + 0);
+				__m128 r1 = _mm_loadu_ps(src[m] + 4);
+				__m128 r2 = _mm_loadu_ps(src[m] + 8);
+				__m128 r3 = _mm_loadu_ps(src[m] + 12);
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				_mm_storeu_ps(dst[m] + 0, r0);
+				_mm_storeu_ps(dst[m] + 4, r1);
+				_mm_storeu_ps(dst[m] + 8, r2);
+				_mm_storeu_ps(dst[m] + 12, r3);
+#else
+				for(int r = 0; r < 4; ++r)
+				{
+					for(int c = 0; c < 4; ++c)
+						dst[m][r * 4 + c] = src[m][c * 4 + r];
+				}
+#endif
+			}
+			device.Write(objectCB, (std::uint32_t)i, constants);
+		}
+	}
+	double perItemMs = ElapsedMilliseconds(start);
+
+	start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		for(std::uint32_t block = 0; block < store.BlockCount(); ++block)
+		{
+			std::uint32_t first = block * TransformStore::Width;
+			std::uint32_t count = store.Size() - first < TransformStore::Width ? store.Size() - first : TransformStore::Width;
+			store.WriteTransposed(block, device.MapElements(objectCB, first, count), stride);
+		}
+	}
+	double batchedMs = ElapsedMilliseconds(start);
+	gBenchSink = gBenchSink + device.BufferData(objectCB)[stride * (objectCount - 1) + 48];
+
+	char detail[128];
+	std::snprintf(detail, sizeof(detail), "[per item transpose: %.3f ms, %.2fx]",
+		perItemMs / runs, batchedMs > 0.0 ? perItemMs / batchedMs : 0.0);
+
+	BenchmarkResult result;
+	result.Name = "Transform upload";
+	result.Items = objectCount;
+	result.MillisecondsPerRun = batchedMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+BenchmarkResult BenchmarkObjectPool(std::size_t objectCount, int iterations, int runs)
+{
+	// About the size of a RenderItem: pointers, draw arguments, flags and the sort key.
+	struct PooledItem
+	{
+		void* Mat = nullptr;
+		void* Geo = nullptr;
+		std::uint32_t ObjCBIndex = 0;
+		std::uint32_t IndexCount = 0;
+		std::uint32_t StartIndexLocation = 0;
+		std::int32_t BaseVertexLocation = 0;
+		bool ShouldRender = true;
+		std::uint64_t SortKey = 0;
+	};
+
+	std::size_t sum = 0;
+
+	BenchClock::time_point start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		std::vector<std::unique_ptr<PooledItem>> items;
+		for(std::size_t i = 0; i < objectCount; ++i)
+		{
+			items.push_back(std::unique_ptr<PooledItem>(new PooledItem()));
+			items.back()->ObjCBIndex = (std::uint32_t)i;
+		}
+
+		for(int it = 0; it < iterations; ++it)
+		{
+			for(const auto& item : items)
+			{
+				if(item->ShouldRender)
+					sum += item->ObjCBIndex;
+			}
+		}
+	}
+	double heapMs = ElapsedMilliseconds(start);
+
+	start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		ObjectPool<PooledItem> pool;
+		for(std::size_t i = 0; i < objectCount; ++i)
+			pool.Get(pool.Create())->ObjCBIndex = (std::uint32_t)i;
+
+		for(int it = 0; it < iterations; ++it)
+		{
+			pool.ForEach([&](const PooledItem& item)
+			{
+				if(item.ShouldRender)
+					sum += item.ObjCBIndex;
+			});
+		}
+	}
+	double poolMs = ElapsedMilliseconds(start);
+	gBenchSink = gBenchSink + sum;
+
+	char detail[128];
+	std::snprintf(detail, sizeof(detail), "[%d walks; unique_ptr vector: %.3f ms, %.2fx]",
+		iterations, heapMs / runs, poolMs > 0.0 ? heapMs / poolMs : 0.0);
+
+	BenchmarkResult result;
+	result.Name = "Object pool";
+	result.Items = objectCount;
+	result.MillisecondsPerRun = poolMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+std::vector<BenchmarkResult> BenchmarkChunkLayouts(std::size_t blockCount, int runs)
+{
+	std::vector<BenchmarkResult> results;
+	results.push_back(BenchmarkChunkLayout<16, 16, 16>("Chunk faces 16x16x16", blockCount, runs));
+	results.push_back(BenchmarkChunkLayout<32, 32, 32>("Chunk faces 32x32x32", blockCount, runs));
+	results.push_back(BenchmarkChunkLayout<16, 256, 16>("Chunk faces 16x256x16", blockCount, runs));
+	return results;
+}
+
+std::vector<BenchmarkResult> BenchmarkChunkOrders(std::size_t blockCount, int runs)
+{
+	std::vector<BenchmarkResult> results;
+	results.push_back(BenchmarkChunkOrder<16>("Morton neighbours 16^3", blockCount, runs));
+	results.push_back(BenchmarkChunkOrder<32>("Morton neighbours 32^3", blockCount, runs));
+	results.push_back(BenchmarkChunkOrder<64>("Morton neighbours 64^3", blockCount, runs));
+	return results;
+}
+
+BenchmarkResult BenchmarkChunkMeshing(std::uint32_t sizeXZ, std::uint32_t sizeY, int runs)
+{
+	// Rolling ground with caves, so there are exposed blocks inside chunks and across
+	// chunk borders.
+	World world;
+	world.Resize(sizeXZ, sizeY, sizeXZ);
+	for(std::uint32_t z = 0; z < sizeXZ; ++z)
+	{
+		for(std::uint32_t x = 0; x < sizeXZ; ++x)
+		{
+			std::uint32_t height = sizeY / 2 + (x * 7 + z * 13) % (sizeY / 4);
+			for(std::uint32_t y = 0; y < height; ++y)
+			{
+				bool cave = (x * 31 + y * 17 + z * 11) % 13 == 0;
+				world.Set(x, y, z, cave ? BlockType_Air : BlockType_Stone);
+			}
+		}
+	}
+
+	std::uint32_t blockIds[BlockType_Count] = {};
+	for(std::uint32_t type = 0; type < BlockType_Count; ++type)
+		blockIds[type] = type;
+	const float origin[3] = { 0.0f, 0.0f, 0.0f };
+
+	// The same mesh from World::Get, which tests bounds and finds the chunk for every
+	// neighbour.
+	BlockInstanceList lookedUp;
+	BenchClock::time_point start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		lookedUp.Clear();
+		for(std::int32_t y = 0; y < (std::int32_t)sizeY; ++y)
+		{
+			for(std::int32_t z = 0; z < (std::int32_t)sizeXZ; ++z)
+			{
+				for(std::int32_t x = 0; x < (std::int32_t)sizeXZ; ++x)
+				{
+					BlockType type = world.Get(x, y, z);
+					if(type == BlockType_Air)
+						continue;
+
+					bool exposed =
+						world.Get(x - 1, y, z) == BlockType_Air || world.Get(x + 1, y, z) == BlockType_Air ||
+						world.Get(x, y - 1, z) == BlockType_Air || world.Get(x, y + 1, z) == BlockType_Air ||
+						world.Get(x, y, z - 1) == BlockType_Air || world.Get(x, y, z + 1) == BlockType_Air;
+
+					if(exposed)
+						lookedUp.Add((float)x, (float)y, (float)z, blockIds[type], BlockInstanceFlag_None);
+				}
+			}
+		}
+	}
+	double lookupMs = ElapsedMilliseconds(start);
+
+	BlockInstanceList meshed;
+	start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+		MeshWorld(world, origin, blockIds, meshed);
+	double snapshotMs = ElapsedMilliseconds(start);
+	gBenchSink = gBenchSink + meshed.Size() + lookedUp.Size();
+
+	char detail[160];
+	std::snprintf(detail, sizeof(detail), "[%zu exposed; World::Get per neighbour: %.3f ms, %.2fx%s]",
+		meshed.Size(), lookupMs / runs, snapshotMs > 0.0 ? lookupMs / snapshotMs : 0.0,
+		meshed.Size() == lookedUp.Size() ? "" : ", COUNTS DIFFER");
+
+	BenchmarkResult result;
+	result.Name = "Chunk meshing";
+	result.Items = (std::size_t)sizeXZ * sizeY * sizeXZ;
+	result.MillisecondsPerRun = snapshotMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+BenchmarkResult BenchmarkWorldSharing(std::uint32_t sizeXZ, std::uint32_t sizeY, int runs)
+{
+	WorldMemoryStats stats;
+
+	BenchClock::time_point start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		// Solid stone up to three quarters of the height, then rolling ground.
+		World world;
+		world.Resize(sizeXZ, sizeY, sizeXZ);
+		for(std::uint32_t z = 0; z < sizeXZ; ++z)
+		{
+			for(std::uint32_t x = 0; x < sizeXZ; ++x)
+			{
+				std::uint32_t noise = (x * 73856093u) ^ (z * 19349663u);
+				noise = (noise ^ (noise >> 13)) * 0x5bd1e995u;
+				std::uint32_t height = sizeY * 3 / 4 + (noise >> 24) % 8;
+				for(std::uint32_t y = 0; y < height; ++y)
+					world.Set(x, y, z, y + 1 < height ? BlockType_Stone : BlockType_Grass);
+			}
+		}
+
+		world.Compact();
+		stats = world.MemoryStats();
+	}
+	double totalMs = ElapsedMilliseconds(start);
+
+	char detail[160];
+	std::snprintf(detail, sizeof(detail), "[%zu chunks in %zu stored, %zu uniform; %.2f MB of %.2f MB dense]",
+		stats.Chunks, stats.StoredChunks, stats.UniformChunks,
+		stats.StoredBytes / (1024.0 * 1024.0), stats.DenseBytes / (1024.0 * 1024.0));
+
+	BenchmarkResult result;
+	result.Name = "World sharing";
+	result.Items = (std::size_t)sizeXZ * sizeY * sizeXZ;
+	result.MillisecondsPerRun = totalMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+BenchmarkResult BenchmarkSurfaceQueries(std::uint32_t sizeXZ, std::uint32_t sizeY, int runs)
+{
+	// Ground about half way up with the odd tall pillar, so column tops vary.
+	World world;
+	world.Resize(sizeXZ, sizeY, sizeXZ);
+	for(std::uint32_t z = 0; z < sizeXZ; ++z)
+	{
+		for(std::uint32_t x = 0; x < sizeXZ; ++x)
+		{
+			std::uint32_t height = (x * 31 + z * 17) % 29 == 0 ? sizeY - 1 : sizeY / 2 + (x * 7 + z * 13) % 8;
+			for(std::uint32_t y = 0; y < height; ++y)
+				world.Set(x, y, z, BlockType_Stone);
+		}
+	}
+
+	std::size_t sum = 0;
+
+	BenchClock::time_point start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		for(std::int32_t z = 0; z < (std::int32_t)sizeXZ; ++z)
+		{
+			for(std::int32_t x = 0; x < (std::int32_t)sizeXZ; ++x)
+			{
+				std::int32_t y = (std::int32_t)sizeY - 1;
+				while(y >= 0 && world.Get(x, y, z) == BlockType_Air)
+					--y;
+				sum += y;
+			}
+		}
+	}
+	double scanMs = ElapsedMilliseconds(start);
+
+	start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		for(std::int32_t z = 0; z < (std::int32_t)sizeXZ; ++z)
+		{
+			for(std::int32_t x = 0; x < (std::int32_t)sizeXZ; ++x)
+				sum += world.SurfaceHeight(x, z);
+		}
+	}
+	double cachedMs = ElapsedMilliseconds(start);
+	gBenchSink = gBenchSink + sum;
+
+	char detail[128];
+	std::snprintf(detail, sizeof(detail), "[column scan: %.3f ms, %.2fx]",
+		scanMs / runs, cachedMs > 0.0 ? scanMs / cachedMs : 0.0);
+
+	BenchmarkResult result;
+	result.Name = "Surface queries";
+	result.Items = (std::size_t)sizeXZ * sizeXZ;
+	result.MillisecondsPerRun = cachedMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+BenchmarkResult BenchmarkBulkEdits(std::uint32_t sizeXZ, std::uint32_t sizeY, int runs)
+{
+	// Stone to an unaligned height, dirt over it, a room dug out of the middle and the
+	// stone of one corner turned to bedrock: whole chunks, partial chunks and a replace.
+	const std::int32_t xz = (std::int32_t)sizeXZ;
+	const std::int32_t ground = (std::int32_t)sizeY * 3 / 4 + 3;
+	const BlockBox stone = MakeBlockBox(0, 0, 0, xz, ground - 3, xz);
+	const BlockBox dirt = MakeBlockBox(0, ground - 3, 0, xz, ground, xz);
+	const BlockBox room = MakeBlockBox(xz / 4 + 5, ground / 2 + 1, xz / 4 + 7, xz * 3 / 4 - 2, ground - 6, xz * 3 / 4 + 1);
+	const BlockBox corner = MakeBlockBox(0, 0, 0, xz / 2 + 3, ground, xz / 2 + 9);
+
+	// The same edits one block at a time.
+	std::size_t perBlockStored = 0;
+	BenchClock::time_point start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		World world;
+		world.Resize(sizeXZ, sizeY, sizeXZ);
+
+		auto fill = [&](const BlockBox& box, BlockType type)
+		{
+			for(std::int32_t y = box.MinY; y < box.MaxY; ++y)
+				for(std::int32_t z = box.MinZ; z < box.MaxZ; ++z)
+					for(std::int32_t x = box.MinX; x < box.MaxX; ++x)
+						world.Set(x, y, z, type);
+		};
+		fill(stone, BlockType_Stone);
+		fill(dirt, BlockType_Dirt);
+		fill(room, BlockType_Air);
+		for(std::int32_t y = corner.MinY; y < corner.MaxY; ++y)
+			for(std::int32_t z = corner.MinZ; z < corner.MaxZ; ++z)
+				for(std::int32_t x = corner.MinX; x < corner.MaxX; ++x)
+					if(world.Get(x, y, z) == BlockType_Stone)
+						world.Set(x, y, z, BlockType_BedRock);
+
+		perBlockStored = world.MemoryStats().StoredChunks;
+	}
+	double perBlockMs = ElapsedMilliseconds(start);
+
+	std::size_t bulkStored = 0;
+	start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		World world;
+		world.Resize(sizeXZ, sizeY, sizeXZ);
+
+		FillBlocks(world, stone, BlockType_Stone);
+		FillBlocks(world, dirt, BlockType_Dirt);
+		FillBlocks(world, room, BlockType_Air);
+		ReplaceBlocks(world, corner, BlockType_Stone, BlockType_BedRock);
+
+		bulkStored = world.MemoryStats().StoredChunks;
+	}
+	double bulkMs = ElapsedMilliseconds(start);
+
+	char detail[160];
+	std::snprintf(detail, sizeof(detail), "[%zu chunks stored; per block Set: %.3f ms, %zu stored, %.2fx]",
+		bulkStored, perBlockMs / runs, perBlockStored, bulkMs > 0.0 ? perBlockMs / bulkMs : 0.0);
+
+	BenchmarkResult result;
+	result.Name = "Bulk edits";
+	result.Items = (std::size_t)sizeXZ * sizeY * sizeXZ;
+	result.MillisecondsPerRun = bulkMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+BenchmarkResult BenchmarkRegionLoad(std::uint32_t size, int runs)
+{
+	const std::string prefix = "BenchmarkWorld";
+
+	BenchClock::time_point start = BenchClock::now();
+	World world;
+	for(int run = 0; run < runs; ++run)
+		GenerateTerrain(world, size, 1);
+	double generateMs = ElapsedMilliseconds(start);
+
+	// Saved with no seed, so every chunk is stored whole and read back from the regions.
+	start = BenchClock::now();
+	bool saved = SaveWorld(world, prefix, 0);
+	double saveMs = ElapsedMilliseconds(start);
+
+	std::size_t stored = 0;
+	std::size_t sectors = 0;
+	start = BenchClock::now();
+	for(int run = 0; run < runs && saved; ++run)
+	{
+		World loaded;
+		LoadWorld(loaded, prefix);
+		stored += loaded.MemoryStats().StoredChunks;
+	}
+	double loadMs = ElapsedMilliseconds(start);
+	gBenchSink = gBenchSink + stored;
+
+	for(std::uint32_t cy = 0; cy < world.ChunksY(); ++cy)
+	{
+		for(std::uint32_t rz = 0; rz * RegionChunks < world.ChunksZ(); ++rz)
+		{
+			for(std::uint32_t rx = 0; rx * RegionChunks < world.ChunksX(); ++rx)
+			{
+				RegionFile region;
+				if(region.Open(RegionPath(prefix, rx, cy, rz), false))
+					sectors += region.SectorCount();
+				region.Close();
+				std::remove(RegionPath(prefix, rx, cy, rz).c_str());
+			}
+		}
+	}
+	std::remove((prefix + ".level").c_str());
+
+	// Payloads are whole sectors, so the files are bigger than the encoded chunks.
+	std::vector<std::uint8_t> encoded;
+	for(std::uint32_t cy = 0; cy < world.ChunksY(); ++cy)
+		for(std::uint32_t cz = 0; cz < world.ChunksZ(); ++cz)
+			for(std::uint32_t cx = 0; cx < world.ChunksX(); ++cx)
+				EncodeChunk(world.GetChunk(cx, cy, cz), encoded);
+
+	char detail[224];
+	std::snprintf(detail, sizeof(detail), "[%s%.1f KB on disk, %.1f KB encoded, %.1f KB dense; save: %.3f ms; generate: %.3f ms, %.2fx]",
+		saved ? "" : "save failed; ", sectors * RegionSectorBytes / 1024.0, encoded.size() / 1024.0,
+		world.MemoryStats().DenseBytes / 1024.0, saveMs, generateMs / runs, loadMs > 0.0 ? generateMs / loadMs : 0.0);
+
+	BenchmarkResult result;
+	result.Name = "Region load";
+	result.Items = (std::size_t)world.ChunksX() * world.ChunksY() * world.ChunksZ();
+	result.MillisecondsPerRun = loadMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+BenchmarkResult BenchmarkRegionReads(std::uint32_t size, int runs)
+{
+	const std::string prefix = "BenchmarkWorld";
+
+	srand(1);
+	World world;
+	GenerateTerrain(world, size, 1);
+	bool saved = SaveWorld(world, prefix, 0);
+
+	// Every stored chunk in a shuffled order, as chunks stream in around a player.
+	std::vector<ChunkCoord> order;
+	for(std::uint32_t cy = 0; cy < world.ChunksY(); ++cy)
+		for(std::uint32_t cz = 0; cz < world.ChunksZ(); ++cz)
+			for(std::uint32_t cx = 0; cx < world.ChunksX(); ++cx)
+				order.push_back({ cx, cy, cz });
+	for(std::size_t i = order.size(); i > 1; --i)
+		std::swap(order[i - 1], order[rand() % i]);
+
+	WorldChunk chunk;
+	std::size_t decoded = 0;
+
+	// One seek and read per chunk into a buffer, region files kept open.
+	const std::uint32_t regionsX = (world.ChunksX() + RegionChunks - 1) / RegionChunks;
+	const std::uint32_t regionsZ = (world.ChunksZ() + RegionChunks - 1) / RegionChunks;
+	BenchClock::time_point start = BenchClock::now();
+	for(int run = 0; run < runs && saved; ++run)
+	{
+		std::vector<std::unique_ptr<RegionFile>> regions(regionsX * world.ChunksY() * regionsZ);
+		std::vector<std::uint8_t> buffer;
+		for(const ChunkCoord& c : order)
+		{
+			std::uint32_t rx = c.X / RegionChunks;
+			std::uint32_t rz = c.Z / RegionChunks;
+			std::unique_ptr<RegionFile>& region = regions[rx + regionsX * (rz + regionsZ * c.Y)];
+			if(region == nullptr)
+			{
+				region = std::make_unique<RegionFile>();
+				region->Open(RegionPath(prefix, rx, c.Y, rz), false);
+			}
+
+			ChunkPayload payload;
+			if(region->ReadChunk(c.X % RegionChunks, c.Z % RegionChunks, buffer, payload))
+				decoded += DecodeChunk(payload.Codec, payload.Data, payload.Size, chunk) ? chunk[0] + 1 : 0;
+		}
+	}
+	double bufferedMs = ElapsedMilliseconds(start);
+
+	start = BenchClock::now();
+	for(int run = 0; run < runs && saved; ++run)
+	{
+		RegionMapCache regions(prefix, RegionAccess_Random);
+		for(const ChunkCoord& c : order)
+		{
+			ChunkPayload payload;
+			if(regions.ReadChunk(c.X, c.Y, c.Z, payload))
+				decoded += DecodeChunk(payload.Codec, payload.Data, payload.Size, chunk) ? chunk[0] + 1 : 0;
+		}
+	}
+	double mappedMs = ElapsedMilliseconds(start);
+	gBenchSink = gBenchSink + decoded;
+
+	for(std::uint32_t cy = 0; cy < world.ChunksY(); ++cy)
+		for(std::uint32_t rz = 0; rz * RegionChunks < world.ChunksZ(); ++rz)
+			for(std::uint32_t rx = 0; rx * RegionChunks < world.ChunksX(); ++rx)
+				std::remove(RegionPath(prefix, rx, cy, rz).c_str());
+	std::remove((prefix + ".level").c_str());
+
+	char detail[128];
+	std::snprintf(detail, sizeof(detail), "[%sbuffered reads: %.3f ms, %.2fx]",
+		saved ? "" : "save failed; ", bufferedMs / runs, mappedMs > 0.0 ? bufferedMs / mappedMs : 0.0);
+
+	BenchmarkResult result;
+	result.Name = "Mapped region reads";
+	result.Items = order.size();
+	result.MillisecondsPerRun = mappedMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+namespace
+{
+	// Sectors and encoded bytes of the chunks stored in the regions of a world saved at
+	// prefix, removing the files as it goes.
+	void MeasureAndRemoveSave(const std::string& prefix, const World& world, std::size_t& sectors, std::size_t& bytes)
+	{
+		sectors = 0;
+		bytes = 0;
+		std::vector<std::uint8_t> buffer;
+		for(std::uint32_t cy = 0; cy < world.ChunksY(); ++cy)
+		{
+			for(std::uint32_t rz = 0; rz * RegionChunks < world.ChunksZ(); ++rz)
+			{
+				for(std::uint32_t rx = 0; rx * RegionChunks < world.ChunksX(); ++rx)
+				{
+					RegionFile region;
+					if(region.Open(RegionPath(prefix, rx, cy, rz), false))
+					{
+						sectors += region.SectorCount();
+						for(std::uint32_t lz = 0; lz < RegionChunks; ++lz)
+						{
+							for(std::uint32_t lx = 0; lx < RegionChunks; ++lx)
+							{
+								ChunkPayload payload;
+								if(region.ReadChunk(lx, lz, buffer, payload))
+									bytes += payload.Size;
+							}
+						}
+					}
+					region.Close();
+					std::remove(RegionPath(prefix, rx, cy, rz).c_str());
+				}
+			}
+		}
+		std::remove((prefix + ".level").c_str());
+	}
+}
+
+BenchmarkResult BenchmarkEditedSave(std::uint32_t size, std::size_t edits, int runs)
+{
+	const std::string prefix = "BenchmarkWorld";
+
+	// Scattered edits, as a player digging and building here and there would make.
+	srand(1);
+	World world;
+	GenerateTerrain(world, size, 1);
+	for(std::size_t i = 0; i < edits; ++i)
+		world.Set(rand() % size, rand() % TerrainDepth, rand() % size, BlockType(rand() % BlockType_Count));
+
+	// Whole chunks, as a world with no seed is saved.
+	BenchClock::time_point start = BenchClock::now();
+	bool saved = true;
+	for(int run = 0; run < runs; ++run)
+		saved &= SaveWorld(world, prefix, 0);
+	double wholeMs = ElapsedMilliseconds(start);
+
+	std::size_t wholeSectors, wholeBytes;
+	MeasureAndRemoveSave(prefix, world, wholeSectors, wholeBytes);
+
+	start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+		saved &= SaveWorld(world, prefix, 1);
+	double deltaMs = ElapsedMilliseconds(start);
+
+	// The deltas are applied to the chunks generated again, which must give the same world.
+	World loaded;
+	saved &= LoadWorld(loaded, prefix);
+	std::size_t mismatched = 0;
+	for(std::uint32_t cy = 0; cy < world.ChunksY() && saved; ++cy)
+	{
+		for(std::uint32_t cz = 0; cz < world.ChunksZ(); ++cz)
+		{
+			for(std::uint32_t cx = 0; cx < world.ChunksX(); ++cx)
+			{
+				const WorldChunk& a = world.GetChunk(cx, cy, cz);
+				const WorldChunk& b = loaded.GetChunk(cx, cy, cz);
+				mismatched += std::memcmp(a.Data(), b.Data(), WorldChunk::Dims::Volume) != 0;
+			}
+		}
+	}
+
+	std::size_t deltaSectors, deltaBytes;
+	MeasureAndRemoveSave(prefix, world, deltaSectors, deltaBytes);
+
+	char detail[256];
+	std::snprintf(detail, sizeof(detail),
+		"[%s%zu edits; %.1f KB on disk, %.1f KB encoded; whole chunks: %.1f KB on disk, %.1f KB encoded, %.3f ms; %zu chunks differ after load]",
+		saved ? "" : "save failed; ", edits, deltaSectors * RegionSectorBytes / 1024.0, deltaBytes / 1024.0,
+		wholeSectors * RegionSectorBytes / 1024.0, wholeBytes / 1024.0, wholeMs / runs, mismatched);
+
+	BenchmarkResult result;
+	result.Name = "Edited world save";
+	result.Items = (std::size_t)world.ChunksX() * world.ChunksY() * world.ChunksZ();
+	result.MillisecondsPerRun = deltaMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+BenchmarkResult BenchmarkMeshCache(std::uint32_t size, int runs)
+{
+	const std::string prefix = MeshCache::PrefixFor("BenchmarkWorld");
+
+	World world;
+	GenerateTerrain(world, size, 1);
+	const BlockBox everything = MakeBlockBox(0, 0, 0, world.SizeX(), world.SizeY(), world.SizeZ());
+	const std::uint32_t blockIds[BlockType_Count] = { 0, 1, 2, 3, 4, 5 };
+	const float origin[3] = {};
+
+	// Each pass meshes every chunk into a WorldMesh of its own, as a start would.
+	auto meshAll = [&](MeshCache* cache)
+	{
+		world.MarkDirty(everything);
+		WorldMesh mesh;
+		mesh.SetCache(cache);
+		std::size_t meshed = mesh.Update(world, origin, blockIds);
+		BlockInstanceList instances;
+		mesh.Gather(instances);
+		gBenchSink = gBenchSink + meshed + instances.Size();
+	};
+
+	BenchClock::time_point start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+		meshAll(nullptr);
+	double uncachedMs = ElapsedMilliseconds(start);
+
+	// Cold: no cache files, so every mesh is made and written.  Warm: a new cache over
+	// the same files, as on the next start, finds them all.
+	std::size_t sectors, bytes;
+	double coldMs = 0.0;
+	double warmMs = 0.0;
+	MeshCacheStats warmStats;
+	for(int run = 0; run < runs; ++run)
+	{
+		MeasureAndRemoveSave(prefix, world, sectors, bytes);
+
+		start = BenchClock::now();
+		{
+			MeshCache cache(prefix);
+			meshAll(&cache);
+		}
+		coldMs += ElapsedMilliseconds(start);
+
+		start = BenchClock::now();
+		{
+			MeshCache cache(prefix);
+			meshAll(&cache);
+			warmStats = cache.Stats();
+		}
+		warmMs += ElapsedMilliseconds(start);
+	}
+
+	// An edit in every eighth chunk makes their entries, and their neighbours', stale.
+	MeshCacheStats editStats;
+	{
+		for(std::uint32_t cz = 0; cz < world.ChunksZ(); cz += 2)
+		{
+			for(std::uint32_t cx = 0; cx < world.ChunksX(); cx += 4)
+				world.Set(cx * WorldChunk::Dims::SizeX + 8, 1, cz * WorldChunk::Dims::SizeZ + 8, BlockType_Emerald);
+		}
+
+		MeshCache cache(prefix);
+		meshAll(&cache);
+		editStats = cache.Stats();
+	}
+	MeasureAndRemoveSave(prefix, world, sectors, bytes);
+
+	char detail[256];
+	std::snprintf(detail, sizeof(detail),
+		"[hits %llu; no cache: %.3f ms; cold, writing the cache: %.3f ms; after edits %llu of %llu stale; %.1f KB of entries, %.1f KB on disk]",
+		(unsigned long long)warmStats.Hits, uncachedMs / runs, coldMs / runs,
+		(unsigned long long)editStats.Stale, (unsigned long long)(editStats.Hits + editStats.Misses),
+		bytes / 1024.0, sectors * RegionSectorBytes / 1024.0);
+
+	BenchmarkResult result;
+	result.Name = "Warm start from mesh cache";
+	result.Items = (std::size_t)world.ChunksX() * world.ChunksY() * world.ChunksZ();
+	result.MillisecondsPerRun = warmMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+BenchmarkResult BenchmarkChunkStreaming(std::uint32_t size, float radius, unsigned threadCount, int runs)
+{
+	const std::string prefix = "BenchmarkWorld";
+	DeleteWorld(prefix);
+
+	// The eye in the middle of the world, just above the ground, looking along +x.
+	const float eye[3] = { size * 0.5f, (float)TerrainDepth, size * 0.5f };
+	const float look[3] = { 1.0f, 0.0f, 0.0f };
+
+	double firstMs = 0.0;
+	double allMs = 0.0;
+	std::size_t placed = 0;
+	std::vector<ChunkCoord> chunks;
+	for(int run = 0; run < runs; ++run)
+	{
+		World world;
+		world.Resize(size, TerrainDepth, size);
+
+		BenchClock::time_point start = BenchClock::now();
+		ChunkStreamer streamer(prefix, 1, world.ChunksX(), world.ChunksY(), world.ChunksZ(), threadCount);
+		streamer.Request(eye, look, radius);
+
+		chunks.clear();
+		double first = 0.0;
+		while(streamer.Pending() != 0)
+		{
+			if(streamer.Collect(world, chunks) != 0 && first == 0.0)
+				first = ElapsedMilliseconds(start);
+
+			// Polled now and then, as a frame loop would, rather than fought over.
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		firstMs += first;
+		allMs += ElapsedMilliseconds(start);
+		placed += chunks.size();
+	}
+	gBenchSink = gBenchSink + placed;
+
+	// The whole world generated up front, as startup used to.
+	BenchClock::time_point start = BenchClock::now();
+	for(int run = 0; run < runs; ++run)
+	{
+		World world;
+		GenerateTerrain(world, size, 1);
+		gBenchSink = gBenchSink + world.MemoryStats().StoredChunks;
+	}
+	double syncMs = ElapsedMilliseconds(start);
+
+	const std::uint32_t sizeChunks = (size + WorldChunk::Dims::SizeX - 1) / WorldChunk::Dims::SizeX;
+	char detail[192];
+	std::snprintf(detail, sizeof(detail), "[%u threads, %u chunks in the world; first chunk: %.3f ms; whole world generated up front: %.3f ms]",
+		threadCount, sizeChunks * sizeChunks, firstMs / runs, syncMs / runs);
+
+	BenchmarkResult result;
+	result.Name = "Chunk streaming";
+	result.Items = placed / runs;
+	result.MillisecondsPerRun = allMs / runs;
+	result.Detail = detail;
+	return result;
+}
+
+namespace
+{
+	// The terrain side of one of the app's frames: streams in the chunks around eye,
+	// meshes them and keeps what they hold under budget, as BlendApp does.  Waits for
+	// the streamer, so every frame sees all the chunks it asked for.
+	class ResidencyFrameRunner
+	{
+	public:
+		ResidencyFrameRunner(World& world, ChunkStreamer& streamer, std::size_t budget) :
+			mWorld(world),
+			mStreamer(streamer),
+			mResidency(world.ChunksX(), world.ChunksY(), world.ChunksZ(), budget)
+		{
+		}
+
+		void Run(const float eye[3], const float player[3], float radius, float pinRadius)
+		{
+			const float look[3] = { 1.0f, 0.0f, 0.0f };
+			mStreamer.Request(eye, look, radius);
+
+			mResidency.BeginFrame();
+			mResidency.Pin(player, pinRadius);
+			mChunks.clear();
+			mResidency.Use(eye, radius, mChunks);
+			for(const ChunkCoord& chunk : mChunks)
+			{
+				if(!mResidency.Holds(chunk, ResidencyTier_Blocks))
+					continue;
+
+				if(!mResidency.Holds(chunk, ResidencyTier_CpuMesh))
+				{
+					std::int32_t minX = chunk.X * WorldChunk::Dims::SizeX;
+					std::int32_t minY = chunk.Y * WorldChunk::Dims::SizeY;
+					std::int32_t minZ = chunk.Z * WorldChunk::Dims::SizeZ;
+					mWorld.MarkDirty(MakeBlockBox(minX + 1, minY + 1, minZ + 1,
+						minX + WorldChunk::Dims::SizeX - 1, minY + WorldChunk::Dims::SizeY - 1, minZ + WorldChunk::Dims::SizeZ - 1));
+				}
+				else if(!mResidency.Holds(chunk, ResidencyTier_GpuMesh))
+				{
+					mMesh.Show(chunk, true);
+					mResidency.Hold(chunk, ResidencyTier_GpuMesh, mMesh.ChunkMesh(chunk).Size() * sizeof(BlockInstance));
+				}
+			}
+
+			mChunks.clear();
+			while(mStreamer.Pending() != 0)
+			{
+				mStreamer.Collect(mWorld, mChunks);
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+			mStreamer.Collect(mWorld, mChunks);
+			for(const ChunkCoord& chunk : mChunks)
+			{
+				bool uniform = mWorld.GetChunk(chunk.X, chunk.Y, chunk.Z).IsUniform();
+				mResidency.Hold(chunk, ResidencyTier_Blocks, uniform ? 0 : sizeof(WorldChunk));
+			}
+
+			const float origin[3] = {};
+			mChunks.clear();
+			mMesh.Update(mWorld, origin, mBlockIds, &mChunks);
+			for(const ChunkCoord& chunk : mChunks)
+			{
+				if(!mResidency.Holds(chunk, ResidencyTier_Blocks))
+					continue;
+
+				const BlockInstanceList& mesh = mMesh.ChunkMesh(chunk);
+				mResidency.Hold(chunk, ResidencyTier_CpuMesh, mesh.Bytes());
+				mResidency.Hold(chunk, ResidencyTier_GpuMesh, mesh.Size() * sizeof(BlockInstance));
+			}
+
+			mEvictions.clear();
+			mResidency.Evict(mEvictions);
+			for(const ResidencyEviction& eviction : mEvictions)
+			{
+				if(eviction.Tier == ResidencyTier_GpuMesh)
+					mMesh.Show(eviction.Chunk, false);
+				else if(eviction.Tier == ResidencyTier_CpuMesh)
+					mMesh.Drop(eviction.Chunk);
+				else if(!mStreamer.Unload(mWorld, eviction.Chunk))
+					mResidency.Hold(eviction.Chunk, ResidencyTier_Blocks, sizeof(WorldChunk));
+			}
+			mResidency.EndFrame();
+
+			mMesh.Gather(mInstances);
+			gBenchSink = gBenchSink + mInstances.Size();
+		}
+
+		const ResidencyStats& Stats()const { return mResidency.Stats(); }
+
+	private:
+		World& mWorld;
+		ChunkStreamer& mStreamer;
+		ChunkResidency mResidency;
+		WorldMesh mMesh;
+		BlockInstanceList mInstances;
+		const std::uint32_t mBlockIds[BlockType_Count] = { 0, 1, 2, 3, 4, 5 };
+
+		std::vector<ChunkCoord> mChunks;
+		std::vector<ResidencyEviction> mEvictions;
+	};
+}
+
+BenchmarkResult BenchmarkChunkResidency(std::uint32_t size, float radius, std::size_t budget, int runs)
+{
+	const std::string prefix = "BenchmarkWorld";
+	const float step = (float)WorldChunk::Dims::SizeX;
+	const float pinRadius = 24.0f;
+
+	// The player stays where the flight starts, so its chunks are pinned throughout.
+	const float start[3] = { radius, (float)TerrainDepth, size * 0.5f };
+
+	std::size_t frames = 0;
+	std::size_t editsLost = 0;
+	std::size_t loadFailures = 0;
+	double ms = 0.0;
+	ResidencyStats stats;
+	std::size_t unboundedPeak = 0;
+	for(int run = 0; run <= runs; ++run)
+	{
+		// The last run has no budget, to show what the flight holds without one.
+		bool bounded = run < runs;
+		DeleteWorld(prefix);
+
+		World world;
+		world.Resize(size, TerrainDepth, size);
+
+		// Evicted edits go to regions, which DeleteWorld finds through the level file.
+		LevelInfo level;
+		level.ChunksX = world.ChunksX();
+		level.ChunksY = world.ChunksY();
+		level.ChunksZ = world.ChunksZ();
+		level.Seed = 1;
+		WriteLevel(prefix, level);
+		ChunkStreamer streamer(prefix, 1, world.ChunksX(), world.ChunksY(), world.ChunksZ(), 2);
+		ResidencyFrameRunner runner(world, streamer, bounded ? budget : ~std::size_t(0));
+
+		// Out along x and back, editing a block under the eye on the way out and checking
+		// it on the way back, after its chunk has been evicted and loaded again.
+		std::vector<float> path;
+		for(float x = start[0]; x <= size - radius; x += step)
+			path.push_back(x);
+		std::size_t outbound = path.size();
+		for(std::size_t i = outbound; i-- > 0;)
+			path.push_back(path[i]);
+
+		BenchClock::time_point begin = BenchClock::now();
+		for(std::size_t i = 0; i < path.size(); ++i)
+		{
+			const float eye[3] = { path[i], start[1], start[2] };
+			runner.Run(eye, start, radius, pinRadius);
+
+			std::int32_t x = (std::int32_t)eye[0];
+			std::int32_t z = (std::int32_t)eye[2];
+			if(i < outbound)
+				world.Set(x, 1, z, BlockType_Emerald);
+			else if(world.Get(x, 1, z) != BlockType_Emerald)
+				editsLost++;
+		}
+
+		if(bounded)
+		{
+			ms += ElapsedMilliseconds(begin);
+			frames += path.size();
+			stats = runner.Stats();
+			loadFailures += streamer.LoadFailures();
+		}
+		else
+		{
+			unboundedPeak = runner.Stats().PeakBytes;
+		}
+	}
+	DeleteWorld(prefix);
+
+	char detail[320];
+	std::snprintf(detail, sizeof(detail),
+		"[budget %.2f MB, peak %.2f MB, %.2f MB with no budget; evictions gpu/cpu/blocks %llu/%llu/%llu; "
+		"block hit rate %.2f, mesh hit rate %.2f; edits lost %zu, chunks failed to load %zu]",
+		budget / 1048576.0, stats.PeakBytes / 1048576.0, unboundedPeak / 1048576.0,
+		(unsigned long long)stats.Evictions[ResidencyTier_GpuMesh], (unsigned long long)stats.Evictions[ResidencyTier_CpuMesh],
+		(unsigned long long)stats.Evictions[ResidencyTier_Blocks],
+		stats.HitRate(ResidencyTier_Blocks), stats.HitRate(ResidencyTier_GpuMesh), editsLost, loadFailures);
+
+	BenchmarkResult result;
+	result.Name = "Chunk residency";
+	result.Items = frames / runs;
+	result.MillisecondsPerRun = ms / runs;
+	result.Detail = detail;
+	return result;
+}
+
+std::vector<BenchmarkResult> RunCpuBenchmarks()
+{
+	std::vector<BenchmarkResult> results;
+	results.push_back(BenchmarkCullAndIndirectArgs(32 * 32 * 8, 200));
+	results.push_back(BenchmarkCullAndIndirectArgs(256 * 256 * 8, 10));
+	results.push_back(BenchmarkHeadlessFrame(32 * 32 * 8, 2048, 200));
+	results.push_back(BenchmarkHeadlessFrame(256 * 256 * 8, 16384, 10));
+
+	std::vector<BenchmarkResult> splits = BenchmarkRangeSplit(16384, 50);
+	results.insert(results.end(), splits.begin(), splits.end());
+
+	results.push_back(BenchmarkTransformUpload(32 * 32 * 8, 200));
+	results.push_back(BenchmarkTransformUpload(256 * 256 * 8, 10));
+	results.push_back(BenchmarkObjectPool(32 * 32 * 8, 60, 20));
+	results.push_back(BenchmarkObjectPool(256 * 256 * 8, 60, 2));
+
+	std::vector<BenchmarkResult> layouts = BenchmarkChunkLayouts(256 * 256 * 8, 10);
+	results.insert(results.end(), layouts.begin(), layouts.end());
+
+	std::vector<BenchmarkResult> orders = BenchmarkChunkOrders(256 * 256 * 8, 10);
+	results.insert(results.end(), orders.begin(), orders.end());
+
+	results.push_back(BenchmarkChunkMeshing(32, 16, 200));
+	results.push_back(BenchmarkChunkMeshing(256, 64, 5));
+	results.push_back(BenchmarkWorldSharing(256, 128, 2));
+	results.push_back(BenchmarkSurfaceQueries(256, 128, 20));
+	results.push_back(BenchmarkBulkEdits(256, 128, 2));
+	results.push_back(BenchmarkRegionLoad(32, 50));
+	results.push_back(BenchmarkRegionLoad(512, 2));
+	results.push_back(BenchmarkRegionReads(512, 5));
+	results.push_back(BenchmarkEditedSave(512, 1000, 2));
+	results.push_back(BenchmarkMeshCache(512, 5));
+	results.push_back(BenchmarkChunkStreaming(1024, 128.0f, 2, 5));
+	results.push_back(BenchmarkChunkResidency(1024, 64.0f, 2u << 20, 2));
+	return results;
+}
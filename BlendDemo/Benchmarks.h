@@ -0,0 +1,113 @@
+//***************************************************************************************
+// Benchmarks.h
+//
+// Timings for the CPU side kernels, run on synthetic data so they need neither a
+// device nor a window.  BlendApp runs them at startup when built with BLEND_BENCHMARKS
+// defined and writes the results to the debugger output; the BlendHeadless target of
+// CMakeLists.txt runs them on any platform and prints them.  Checks.h holds the checks
+// that their results are right.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct BenchmarkResult
+{
+	std::string Name;
+	std::size_t Items = 0;
+	double MillisecondsPerRun = 0.0;
+
+	// Extra figures for the run, such as draw and upload counts.  Optional.
+	std::string Detail;
+
+	// "name: x.xxx ms for n items (y.yy ns/item) detail"
+	std::string ToString()const;
+};
+
+// Culls blockCount blocks spread over a flat world, packs the survivors and builds the
+// indirect argument records, as BlendApp does every frame.
+BenchmarkResult BenchmarkCullAndIndirectArgs(std::size_t blockCount, int runs);
+
+// Runs the whole frame submission on a RecordingBackend: constant uploads, culling and
+// indirect arguments for blockCount terrain blocks, and a sorted render queue of
+// queuedCount draws recorded in parallel ranges.  Detail reports the backend counters.
+BenchmarkResult BenchmarkHeadlessFrame(std::size_t blockCount, std::size_t queuedCount, int runs);
+
+// Splits a sorted render queue of queuedCount draws into ranges for 1, 2, 4 and 8
+// command lists and replays them on worker threads through a HeadlessRangeRecorder.
+// Detail gives the state changes the split adds over one list, and whether they match
+// what SubmitQueuedDraws records for the same ranges.
+std::vector<BenchmarkResult> BenchmarkRangeSplit(std::size_t queuedCount, int runs);
+
+// Writes objectCount transposed world and texture transforms into a constant buffer
+// from a TransformStore, a block at a time.  Detail compares it with loading,
+// transposing and writing each matrix one object at a time from an array of structs.
+BenchmarkResult BenchmarkTransformUpload(std::size_t objectCount, int runs);
+
+// Creates objectCount render item sized objects in an ObjectPool, then walks them
+// iterations times, as a frame does.  Detail gives the same for one heap allocation
+// per object held in a vector of unique_ptr.
+BenchmarkResult BenchmarkObjectPool(std::size_t objectCount, int iterations, int runs);
+
+// Counts the exposed faces of blockCount blocks of terrain, a chunk at a time, for
+// 16x16x16, 32x32x32 and 16x256x16 column chunks.  Detail gives the same kernel with
+// the chunk sizes known only at run time.
+std::vector<BenchmarkResult> BenchmarkChunkLayouts(std::size_t blockCount, int runs);
+
+// Counts exposed faces and solid neighbours among all 26 for blockCount blocks of
+// terrain kept in Morton ordered cubic chunks of 16, 32 and 64 blocks a side.  Detail
+// gives the same walk over row-major chunks.
+std::vector<BenchmarkResult> BenchmarkChunkOrders(std::size_t blockCount, int runs);
+
+// Meshes a sizeXZ x sizeY x sizeXZ world of terrain into exposed block instances
+// through chunk snapshots.  Detail gives the same mesh built from World::Get.
+BenchmarkResult BenchmarkChunkMeshing(std::uint32_t sizeXZ, std::uint32_t sizeY, int runs);
+
+// Generates a sizeXZ x sizeY x sizeXZ world that is solid stone for most of its depth,
+// block by block, and compacts it.  Detail gives the chunk storage left afterwards.
+BenchmarkResult BenchmarkWorldSharing(std::uint32_t sizeXZ, std::uint32_t sizeY, int runs);
+
+// Finds the top solid block of every column of a sizeXZ x sizeY x sizeXZ world from
+// the world's column tops.  Detail gives the same by scanning down each column.
+BenchmarkResult BenchmarkSurfaceQueries(std::uint32_t sizeXZ, std::uint32_t sizeY, int runs);
+
+// Builds a sizeXZ x sizeY x sizeXZ world from a few box fills and a replace with the
+// WorldEdit functions.  Detail gives the same edits made one World::Set at a time.
+BenchmarkResult BenchmarkBulkEdits(std::uint32_t sizeXZ, std::uint32_t sizeY, int runs);
+
+// Loads a size x size world of the demo's terrain from region files.  Detail gives the
+// size of the files, the time to save them and the time to generate the same terrain.
+BenchmarkResult BenchmarkRegionLoad(std::uint32_t size, int runs);
+
+// Reads and decodes every chunk of a size x size world of the demo's terrain from
+// region files in a shuffled order, through a RegionMapCache.  Detail gives the same
+// reads through RegionFile, a seek and read into a buffer per chunk.
+BenchmarkResult BenchmarkRegionReads(std::uint32_t size, int runs);
+
+// Saves a size x size world of the demo's terrain with edits scattered over it, as the
+// blocks that differ from the generated terrain.  Detail gives the size on disk and
+// encoded against saving every chunk whole, and checks the world loads back the same.
+BenchmarkResult BenchmarkEditedSave(std::uint32_t size, std::size_t edits, int runs);
+
+// Meshes every chunk of a size x size world of the demo's terrain through a MeshCache
+// that already holds their meshes, as a warm start does.  Detail gives the same with
+// no cache and with an empty one being filled, and how many entries an edit in every
+// eighth chunk made stale.
+BenchmarkResult BenchmarkMeshCache(std::uint32_t size, int runs);
+
+// Streams the chunks within radius blocks of the middle of a size x size world of the
+// demo's terrain in on threadCount threads, until every one has been collected.  Detail
+// gives the time to the first chunk and to generate the whole world up front.
+BenchmarkResult BenchmarkChunkStreaming(std::uint32_t size, float radius, unsigned threadCount, int runs);
+
+// Flies the camera out across a size x size world of the demo's terrain and back,
+// streaming in the chunks within radius blocks and keeping their blocks and meshes
+// under budget bytes.  Items is frames; Detail gives the peak with and without the
+// budget, evictions per tier, hit rates and any edits lost to eviction.
+BenchmarkResult BenchmarkChunkResidency(std::uint32_t size, float radius, std::size_t budget, int runs);
+
+std::vector<BenchmarkResult> RunCpuBenchmarks();
@@ -4,12 +4,29 @@
 
 #include "Common/d3dApp.h"
 #include "Common/MathHelper.h"
-#include "Common/UploadBuffer.h"
 #include "Common/GeometryGenerator.h"
 #include "FrameResource.h"
 #include "Waves.h"
 #include <time.h>
 #include "Camera.h"
+#include "RenderQueue.h"
+#include "BlockInstances.h"
+#include "ParallelRecorder.h"
+#include "BlockCulling.h"
+#include "IndirectArgs.h"
+#include "Benchmarks.h"
+#include "Checks.h"
+#include "D3D12Backend.h"
+#include "FrameSubmission.h"
+#include "TransformStore.h"
+#include "ObjectPool.h"
+#include "Registry.h"
+#include "Terrain.h"
+#include "ChunkResidency.h"
+#include "ChunkStreamer.h"
+#include "MeshCache.h"
+#include "ChunkMesher.h"
+#include <algorithm>
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -20,24 +37,42 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// Number of textures in the SRV heap.  The instanced shader sees all of them as one
+// array indexed by each material's DiffuseMapIndex.
+const int gNumBlockTextures = 9;
+
+// Region files of the world are saved under this name in the working directory.
+const char* const gWorldSavePrefix = "BlendWorld";
+
+// Chunks are brought in around the camera out to this many blocks, by this many
+// background threads.
+const float gViewDistance = 64.0f;
+const unsigned gStreamingThreads = 2;
+
+// What the chunks may hold in blocks and meshes before those furthest out of use are
+// evicted, and how near the player chunks are never evicted.
+const std::size_t gChunkMemoryBudget = 64u << 20;
+const float gPinDistance = 24.0f;
+
+// Most command lists the render queue is split across.  The main thread records one of
+// them, so this is also one more than the number of recording threads.
+const int gNumRecordLists = 4;
+
+// Ranges smaller than this are not worth a command list of their own.
+const int gMinDrawsPerRecordList = 256;
+
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
 struct RenderItem
 {
 	RenderItem() = default;
  
-    // World matrix of the shape that describes the object's local space
-    // relative to the world space, which defines the position, orientation,
-    // and scale of the object in the world.
-    XMFLOAT4X4 World = MathHelper::Identity4x4();
+	// The world matrix, which places the object's local space in the world, and the
+	// texture transform live in BlendApp::mTransforms at ObjCBIndex.
 
-	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
-
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
+	// Because we have an object cbuffer for each FrameResource, a change to the object
+	// data has to reach every FrameResource.  So when we modify object data we call
+	// BlendApp::MarkObjectDirty, which queues the item in each frame resource's dirty list.
 
 	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
 	UINT ObjCBIndex = -1;
@@ -56,6 +91,42 @@ struct RenderItem
 	bool shouldRender = false;
 	bool isShadow = false;
 	bool isPlayer = false;
+
+	// Layer, PSO, geometry and material part of the render queue sort key.  Only the
+	// depth bits are filled in per frame.
+	std::uint64_t SortKey = 0;
+
+	// Index of Geo's buffers in BlendApp::mSortIdBuffers.  Kept apart from the key, which
+	// leaves geometry out in blended layers.
+	UINT GeometrySortId = 0;
+};
+
+// Vertex and index buffers of a MeshGeometry, created through the RenderDevice.
+struct GeometryBuffers
+{
+	BufferHandle Vertices = InvalidBuffer;
+	BufferHandle Indices = InvalidBuffer;
+};
+
+// Blocks of one mesh type.  Every frame the batch is culled, the visible instances are
+// packed into the frame's upload arena and an indirect draw record is built for them.
+struct InstanceBatch
+{
+	MeshGeometry* Geo = nullptr;
+	SubmeshGeometry Args;
+
+	// Geo's buffers, looked up once when the batch is set up.
+	GeometryBuffers Buffers;
+
+	BlockInstanceList Instances;
+};
+
+// Layers drawn instanced, each submitted with one ExecuteIndirect.
+enum class InstancedLayer : int
+{
+	Terrain = 0,
+	Dynamic,
+	Count
 };
 
 enum class RenderLayer : int
@@ -67,7 +138,21 @@ enum class RenderLayer : int
 	Count
 };
 
-class BlendApp : public D3DApp
+// Order the layers are submitted in.  The position in this array is the layer field
+// of the render queue sort key, and each layer has its own PSO so it is also the PSO id.
+const RenderLayer gLayerDrawOrder[(int)RenderLayer::Count] =
+{
+	RenderLayer::Opaque,
+	RenderLayer::AlphaTested,
+	RenderLayer::Transparent,
+	RenderLayer::Shadow
+};
+
+// Pipeline id of the first instanced layer, after the ids the render queue uses.
+const UINT gInstancedPipelines = (UINT)RenderLayer::Count;
+const UINT gPipelineCount = gInstancedPipelines + (UINT)InstancedLayer::Count;
+
+class BlendApp : public D3DApp, private RangeRecorder
 {
 public:
     BlendApp(HINSTANCE hInstance);
@@ -90,21 +175,41 @@ private:
 	void OnCharKeyboardinput(const GameTimer& gt);
 	//void UpdateCamera(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
-	void UpdateMaterialCBs(const GameTimer& gt);
+	void UpdateMaterialBuffer(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
+	void MarkObjectDirty(const RenderItem* ri);
+	UINT AddTransform(FXMMATRIX world);
+	void MarkMaterialDirty(const Material* mat);
 
 	void LoadTextures();
     void BuildRootSignature();
+	void BuildCommandSignatures();
 	void BuildDescriptorHeaps();
     void BuildShadersAndInputLayout();
+	void BuildGeometryBuffers(const std::string& name, const std::vector<Vertex>& vertices, const std::vector<std::uint16_t>& indices);
 	void BuildBoxGeometry();
 	void BuildSkyBoxGeometry();
     void BuildPSOs();
     void BuildFrameResources();
+	void SyncFrameResources();
+	UINT FrameArenaByteSize()const;
+	void BuildRecordCommandLists();
     void BuildMaterials();
-	std::string Block(int y, int size);
     void BuildRenderItems(int worldsize);
-    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void BuildChunkShadowItems(const ChunkCoord& chunk);
+	void RetireChunkShadowItems(const ChunkCoord& chunk);
+	void DestroyRetiredItems();
+	size_t ChunkBlockBytes(const ChunkCoord& chunk)const;
+	void AddRuntimeItem(RenderItem* ri, RenderLayer layer);
+	void UpdateTerrainStreaming();
+	void BuildSortKeys();
+	void BuildSortKey(RenderItem* ri, int slot);
+	UINT GeometrySortId(const MeshGeometry* geo);
+	void BuildRenderQueue();
+	void BuildBlockInstances();
+	void DrawInstancedLayer(RenderContext& context, InstancedLayer layer);
+	void SetPassState(D3D12RenderContext& context);
+	virtual void RecordRange(std::uint32_t list, const DrawRange& range)override;
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -124,11 +229,53 @@ private:
 
 	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
 
-	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
-	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
-	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
-	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
+	typedef Registry<std::unique_ptr<Material>>::Handle MaterialHandle;
+	typedef Registry<ComPtr<ID3D12PipelineState>>::Handle PsoHandle;
+
+	// Looked up by name while loading; anything used per frame or per block keeps a
+	// handle or pointer instead.
+	Registry<std::unique_ptr<MeshGeometry>> mGeometries;
+	Registry<std::unique_ptr<Material>> mMaterials;
+	Registry<std::unique_ptr<Texture>> mTextures;
+	Registry<ComPtr<ID3DBlob>> mShaders;
+	Registry<ComPtr<ID3D12PipelineState>> mPSOs;
+
+	// The PSO behind each pipeline id, solid and wireframe.  Filled in by BuildPSOs.
+	PsoHandle mPipelinePsos[gPipelineCount];
+	PsoHandle mWireframePipelinePsos[gPipelineCount];
+
+	// The material of each block type, so building the terrain hashes no names.
+	MaterialHandle mBlockMaterials[BlockType_Count];
+
+	// The blocks the terrain render items are built from, and their meshes.
+	World mWorld;
+	WorldMesh mWorldMesh;
+
+	// Loads or generates the world's chunks around the camera in the background.  The
+	// chunks it placed this frame, where block 0,0,0 sits in world space, and the
+	// material index of each block type for the terrain instances.
+	std::unique_ptr<ChunkStreamer> mChunkStreamer;
+	std::vector<ChunkCoord> mPlacedChunks;
+
+	// Keeps the chunks' blocks and meshes under gChunkMemoryBudget.  Kept from frame to
+	// frame: the chunks in view missing a tier, those meshed and what was evicted.
+	ChunkResidency mChunkResidency;
+
+	// Finished chunk meshes on disk next to the save, so a warm start or a chunk seen
+	// again is not meshed.
+	std::unique_ptr<MeshCache> mMeshCache;
+	std::vector<ChunkCoord> mMissingChunks;
+	std::vector<ChunkCoord> mMeshedChunks;
+	std::vector<ResidencyEviction> mEvictions;
+
+	// The shadow casters built for each chunk, by chunk index.  The terrain itself is
+	// drawn from mWorldMesh's instances and has no render items.  They are counted with
+	// the chunk's blocks and go when the blocks are evicted; those going this frame wait
+	// in mRetiredItems to be taken out of the shadow layer together.
+	std::vector<std::vector<ObjectPool<RenderItem>::Handle>> mChunkShadowItems;
+	std::vector<ObjectPool<RenderItem>::Handle> mRetiredItems;
+	float mWorldOrigin[3] = {};
+	std::uint32_t mBlockIds[BlockType_Count] = {};
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
  
@@ -138,8 +285,9 @@ private:
 
 	RenderItem* mcharRitem = nullptr;
 
-	// List of all the render items.
-	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
+	// All the render items.  Pooled, so they sit next to each other in memory and keep
+	// their address for the layers' pointers.
+	ObjectPool<RenderItem> mRitems;
 
 	std::vector<std::vector<std::vector<std::unique_ptr<RenderItem>>>> test;
 	std::vector<std::unique_ptr<RenderItem>> ***test2;
@@ -147,6 +295,61 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
+	// World and texture transforms of every render item, by ObjCBIndex.  Dirty items are
+	// written to the object constants a whole block of the store at a time.
+	TransformStore mTransforms;
+	std::vector<UINT> mDirtyTransformBlocks;
+
+	// Render items and materials by constant buffer index, for writing back the
+	// entries of the dirty lists.  Indices of destroyed items are null here and wait in
+	// mFreeObjCBs for AddTransform to hand them out again.
+	std::vector<RenderItem*> mRitemsByObjCB;
+	std::vector<UINT> mFreeObjCBs;
+	std::vector<Material*> mMaterialsByCB;
+
+	// Buffers, uploads, pipeline binding and draws go through the render device and
+	// contexts; only frame setup such as barriers and clears uses the command lists.
+	std::unique_ptr<D3D12RenderDevice> mRenderDevice;
+	std::unique_ptr<D3D12RenderContext> mMainContext;
+	std::vector<std::unique_ptr<D3D12RenderContext>> mRecordContexts;
+	Registry<GeometryBuffers> mGeometryBuffers;
+
+	// Where this frame's draws read their constants and instances from.  Filled in by
+	// Update as the data is written.
+	FrameBuffers mFrameBuffers;
+
+	// Counters of the last frame, summed over the device and every context.
+	RenderBackendStats mBackendStats;
+
+	// Sizes and high water marks of the last frame's frame resource.
+	FrameResourceUsage mFrameUsage;
+
+	// Chunks so far whose stored blocks did not decode and were generated again, to be
+	// saved over the damaged records when they are unloaded.
+	std::size_t mChunkLoadFailures = 0;
+
+	// Visible render items for this frame sorted by state, and the draws the queue
+	// entries index into.
+	RenderQueue mRenderQueue;
+	std::vector<QueuedDraw> mQueuedDraws;
+	std::vector<const MeshGeometry*> mGeometrySortIds;
+	std::vector<GeometryBuffers> mSortIdBuffers;
+
+	// The opaque terrain layer, and dynamic blocks such as the player cube, are drawn
+	// instanced rather than through the render queue.  The culling results become one
+	// indirect argument record per batch.
+	InstanceBatch mInstanceBatches[(int)InstancedLayer::Count];
+	IndirectArgsBuilder mIndirectArgs;
+	ComPtr<ID3D12CommandSignature> mBlockCommandSignature = nullptr;
+
+	// The render queue is recorded in parallel ranges, one command list per range.
+	// Each list tracks its own bound state; the stats of the last recorded frame are
+	// summed over all lists and kept around for profiling.
+	ParallelRecorder mRecorder;
+	std::vector<ComPtr<ID3D12GraphicsCommandList>> mRecordCmdLists;
+	DrawStateCache mDrawStates[gNumRecordLists];
+	RenderQueueStats mDrawStats;
+
 	//Don't need
 	std::unique_ptr<Waves> mWaves;
 
@@ -196,7 +399,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 }
 
 BlendApp::BlendApp(HINSTANCE hInstance)
-    : D3DApp(hInstance)
+    : D3DApp(hInstance), mRecorder(gNumRecordLists)
 {
 }
 
@@ -218,18 +421,25 @@ bool BlendApp::Initialize()
 	// so we have to query this information.
     mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
+	// Static buffers are filled by copies recorded on the initialization command list.
+	mRenderDevice = std::make_unique<D3D12RenderDevice>(md3dDevice.Get(), mCommandList.Get());
+	mMainContext = std::make_unique<D3D12RenderContext>(*mRenderDevice, mCommandList.Get());
+
     mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
 	mCamera.SetPosition(0.0f, 2.0f, -15.0f);
  
 	LoadTextures();
     BuildRootSignature();
+	BuildCommandSignatures();
 	BuildDescriptorHeaps();
     BuildShadersAndInputLayout();
 	BuildBoxGeometry();
 	BuildSkyBoxGeometry(); 
 	BuildMaterials();
     BuildRenderItems(32); //Parameter determines the size of the terrain e.g size x size. The depth of the terrain is hard coded 
+	BuildSortKeys();
     BuildFrameResources();
+	BuildRecordCommandLists();
     BuildPSOs();
 	
 
@@ -240,6 +450,14 @@ bool BlendApp::Initialize()
 
     // Wait until initialization is complete.
     FlushCommandQueue();
+	mRenderDevice->ReleaseUploads();
+
+#if defined(BLEND_BENCHMARKS)
+	for (const std::string& failure : RunCpuChecks())
+		OutputDebugStringA(("Check failed: " + failure + "\n").c_str());
+	for (const BenchmarkResult& result : RunCpuBenchmarks())
+		OutputDebugStringA((result.ToString() + "\n").c_str());
+#endif
 
     return true;
 }
@@ -259,6 +477,9 @@ void BlendApp::Update(const GameTimer& gt)
     OnKeyboardInput(gt);
 	//UpdateCamera(gt);
 
+	//Before the frame resource is grown, so it has room for whatever chunks arrive
+	UpdateTerrainStreaming();
+
     // Cycle through the circular frame resource array.
     mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
     mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
@@ -273,9 +494,20 @@ void BlendApp::Update(const GameTimer& gt)
         CloseHandle(eventHandle);
     }
 
+	//The GPU is done with this frame resource, so it can grow to fit what was added since
+	//it was last used, and its arena can be reset
+	mCurrFrameResource->Grow(*mRenderDevice, FrameArenaByteSize());
+	mFrameUsage = mCurrFrameResource->Usage(*mRenderDevice);
+
+	mFrameBuffers = FrameBuffers();
+	mFrameBuffers.Object = mCurrFrameResource->ObjectCB;
+	mFrameBuffers.Material = mCurrFrameResource->MaterialBuffer;
+	mFrameBuffers.IndirectArgs = mCurrFrameResource->IndirectArgsBuffer;
+
 	UpdateObjectCBs(gt);
-	UpdateMaterialCBs(gt);
+	UpdateMaterialBuffer(gt);
 	UpdateMainPassCB(gt);
+	BuildBlockInstances();
 }
 
 void BlendApp::Draw(const GameTimer& gt)
@@ -288,18 +520,8 @@ void BlendApp::Draw(const GameTimer& gt)
 
     // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
     // Reusing the command list reuses memory.
-    //ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
-	if (mIsWireframe)
-	{
-		ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque_wireframe"].Get()));
-	}
-	else
-	{
-		ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
-	}
-
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
+    // Pipeline states are bound by the draw functions as they need them.
+	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), nullptr));
 
     // Indicate a state transition on the resource usage.
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
@@ -309,32 +531,56 @@ void BlendApp::Draw(const GameTimer& gt)
     mCommandList->ClearRenderTargetView(CurrentBackBufferView(), (float*)&mMainPassCB.FogColor, 0, nullptr);
     mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-    // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+	//Pipeline ids: the queue's layer slots first, then one per instanced layer. Set once
+	//per frame so the recording threads never touch mPSOs.
+	const PsoHandle* pipelinePsos = mIsWireframe ? mWireframePipelinePsos : mPipelinePsos;
+	for (UINT pipeline = 0; pipeline < gPipelineCount; ++pipeline)
+		mRenderDevice->SetPipeline(pipeline, mPSOs[pipelinePsos[pipeline]].Get());
 
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
-	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+	mMainContext->ResetStats();
+	SetPassState(*mMainContext);
+
+	//The terrain and the dynamic blocks are drawn instanced, one indirect call per layer
+	DrawInstancedLayer(*mMainContext, InstancedLayer::Terrain);
+	DrawInstancedLayer(*mMainContext, InstancedLayer::Dynamic);
 
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
+	ThrowIfFailed(mCommandList->Close());
 
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+	ID3D12CommandList* preLists[] = { mCommandList.Get() };
+	mCommandQueue->ExecuteCommandLists(_countof(preLists), preLists);
 
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+	//Everything else goes through the render queue: alpha tested, transparent and then
+	//shadows, in the order of gLayerDrawOrder. The sorted queue is split into ranges that
+	//are recorded in parallel, one command list each.
+	BuildRenderQueue();
 
-	mCommandList->SetPipelineState(mPSOs["alphaTested"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTested]);
+	const std::vector<DrawRange>& ranges = mRecorder.Split(mRenderQueue.Size(), gMinDrawsPerRecordList);
 
-	mCommandList->OMSetStencilRef(0);
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+		auto alloc = mCurrFrameResource->RecordCmdListAllocs[i];
+		ThrowIfFailed(alloc->Reset());
+		ThrowIfFailed(mRecordCmdLists[i]->Reset(alloc.Get(), nullptr));
+		mRecordContexts[i]->ResetStats();
+	}
 
-	mCommandList->SetPipelineState(mPSOs["transparent"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Transparent]);
+	mRecorder.Record(*this);
 
+	std::vector<ID3D12CommandList*> cmdsLists;
+	mDrawStats = RenderQueueStats();
+	mBackendStats = mRenderDevice->Stats();
+	mBackendStats.Accumulate(mMainContext->Stats());
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+		ThrowIfFailed(mRecordCmdLists[i]->Close());
+		cmdsLists.push_back(mRecordCmdLists[i].Get());
+		mDrawStats.Accumulate(mDrawStates[i].Stats());
+		mBackendStats.Accumulate(mRecordContexts[i]->Stats());
+	}
+	mRenderDevice->ResetStats();
 
-	//Draw shadows
-	//omstencil was here
-	mCommandList->SetPipelineState(mPSOs["shadow"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Shadow]);
+	//The main list was submitted above, so it can be recorded again for the final transition
+	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), nullptr));
 
     // Indicate a state transition on the resource usage.
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
@@ -342,10 +588,10 @@ void BlendApp::Draw(const GameTimer& gt)
 
     // Done recording commands.
     ThrowIfFailed(mCommandList->Close());
+	cmdsLists.push_back(mCommandList.Get());
 
-    // Add the command list to the queue for execution.
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+    // Add the command lists to the queue for execution, in range order.
+    mCommandQueue->ExecuteCommandLists((UINT)cmdsLists.size(), cmdsLists.data());
 
     // Swap the back and front buffers
     ThrowIfFailed(mSwapChain->Present(0, 0));
@@ -500,83 +746,91 @@ void BlendApp::OnKeyboardInput(const GameTimer& gt)
 
 void BlendApp::UpdateObjectCBs(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
-	for(auto& e : mAllRitems)
+	//The shadow items follow the light through the pass's shadow transform, so moving
+	//the light dirties nothing here.
+
+	// Only the items whose constants have changed since this frame resource was last
+	// written are in its dirty list.  They are gathered into the transform store blocks
+	// they fall in, and each block is transposed and written in one go; its clean items
+	// are rewritten with the values they already have.
+	mDirtyTransformBlocks.clear();
+	mCurrFrameResource->DirtyObjects.Flush([&](std::uint32_t index)
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if(e->NumFramesDirty > 0)
-		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
-			
-
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
-
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
-
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
-		}
-
-		//This is where the shadows are supposed to be updated so they look like they're changing over time
-		//Currently it works for the only shadow that has been rendered.
-		if (e->isShadow)
-		{
-			// Update shadow world matrix.
-			XMVECTOR shadowPlane = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f); // xz plane
-			XMVECTOR toMainLight = -XMLoadFloat3(&mMainPassCB.Lights[0].Direction);
-			XMMATRIX S = XMMatrixShadow(shadowPlane, toMainLight);
-			XMMATRIX shadowOffsetY = XMMatrixTranslation(0.0f, 0.001f, 0.0f);
-			XMStoreFloat4x4(&e->World, S * shadowOffsetY);
+		mDirtyTransformBlocks.push_back(index / TransformStore::Width);
+	});
 
-			//currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+	std::sort(mDirtyTransformBlocks.begin(), mDirtyTransformBlocks.end());
+	mDirtyTransformBlocks.erase(std::unique(mDirtyTransformBlocks.begin(), mDirtyTransformBlocks.end()), mDirtyTransformBlocks.end());
 
-			e->NumFramesDirty = gNumFrameResources;
-		}
+	BufferHandle currObjectCB = mCurrFrameResource->ObjectCB;
+	UINT stride = mRenderDevice->ElementStride(currObjectCB);
+	for (UINT block : mDirtyTransformBlocks)
+	{
+		UINT first = block * TransformStore::Width;
+		UINT count = std::min(TransformStore::Width, mTransforms.Size() - first);
 
-		//Code to update the characters position using the chartranslation value
-		if (e->isPlayer)
+		BYTE* constants = static_cast<BYTE*>(mRenderDevice->MapElements(currObjectCB, first, count));
+		mTransforms.WriteTransposed(block, constants, stride);
+		for (UINT i = 0; i < count; ++i)
 		{
-			XMMATRIX player = XMLoadFloat4x4(&e->World);
-			XMMATRIX update = XMMatrixTranslation(mCharTranslation.x, mCharTranslation.y, mCharTranslation.z);
-
-			player = update*player;
-
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(player));
-
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+			//Free indices are not drawn, whatever they hold
+			const RenderItem* ri = mRitemsByObjCB[first + i];
+			reinterpret_cast<ObjectConstants*>(constants + i * stride)->MaterialIndex = ri != nullptr ? ri->Mat->MatCBIndex : 0;
 		}
 	}
 }
 
-void BlendApp::UpdateMaterialCBs(const GameTimer& gt)
+//Stores the world matrix of a new render item and returns the item's ObjCBIndex, the
+//index of a destroyed item when there is one
+UINT BlendApp::AddTransform(FXMMATRIX world)
+{
+	XMFLOAT4X4 w;
+	XMStoreFloat4x4(&w, world);
+	if (mFreeObjCBs.empty())
+		return mTransforms.Add(&w._11);
+
+	UINT index = mFreeObjCBs.back();
+	mFreeObjCBs.pop_back();
+
+	XMFLOAT4X4 texTransform = MathHelper::Identity4x4();
+	mTransforms.SetWorld(index, &w._11);
+	mTransforms.SetTexTransform(index, &texTransform._11);
+	return index;
+}
+
+//Rewrites the changed materials in this frame's material buffer. MatCBIndex is the
+//material's index in the buffer.
+void BlendApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
-	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
-	for(auto& e : mMaterials)
+	BufferHandle currMaterialBuffer = mCurrFrameResource->MaterialBuffer;
+	mCurrFrameResource->DirtyMaterials.Flush([&](std::uint32_t index)
 	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
-		Material* mat = e.second.get();
-		if(mat->NumFramesDirty > 0)
-		{
-			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
+		const Material* mat = mMaterialsByCB[index];
 
-			MaterialConstants matConstants;
-			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstants.FresnelR0 = mat->FresnelR0;
-			matConstants.Roughness = mat->Roughness;
-			XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
+		XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
 
-			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
+		MaterialData matData;
+		matData.DiffuseAlbedo = mat->DiffuseAlbedo;
+		matData.FresnelR0 = mat->FresnelR0;
+		matData.Roughness = mat->Roughness;
+		XMStoreFloat4x4(&matData.MatTransform, XMMatrixTranspose(matTransform));
+		matData.DiffuseMapIndex = mat->DiffuseSrvHeapIndex;
 
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
-		}
-	}
+		mRenderDevice->Write(currMaterialBuffer, index, matData);
+	});
+}
+
+//Queues the item's constants to be rewritten in every frame resource
+void BlendApp::MarkObjectDirty(const RenderItem* ri)
+{
+	for (auto& frameResource : mFrameResources)
+		frameResource->DirtyObjects.Mark(ri->ObjCBIndex);
+}
+
+void BlendApp::MarkMaterialDirty(const Material* mat)
+{
+	for (auto& frameResource : mFrameResources)
+		frameResource->DirtyMaterials.Mark(mat->MatCBIndex);
 }
 
 void BlendApp::UpdateMainPassCB(const GameTimer& gt)
@@ -636,8 +890,20 @@ void BlendApp::UpdateMainPassCB(const GameTimer& gt)
 	mMainPassCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
 	mMainPassCB.Lights[2].Strength = { 0.9f, 0.9f, 0.8f };
 
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+	//The planar shadow projection onto the xz plane along the main light, built once per
+	//frame and shared by every shadow item. The shadow VS applies it after each caster's
+	//own world matrix.
+	XMVECTOR shadowPlane = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f); // xz plane
+	XMVECTOR toMainLight = -XMLoadFloat3(&mMainPassCB.Lights[0].Direction);
+	XMMATRIX S = XMMatrixShadow(shadowPlane, toMainLight);
+	XMMATRIX shadowOffsetY = XMMatrixTranslation(0.0f, 0.001f, 0.0f);
+	XMStoreFloat4x4(&mMainPassCB.ShadowTransform, XMMatrixTranspose(S * shadowOffsetY));
+
+	//The pass constants are the first allocation of the frame, and the arena always has room for them
+	UploadAllocation pass = mCurrFrameResource->Arena->Push(mMainPassCB);
+	assert(pass.Valid());
+	mFrameBuffers.Pass = pass.Buffer;
+	mFrameBuffers.PassElement = pass.Element;
 }
 
 void BlendApp::LoadTextures()
@@ -731,19 +997,26 @@ void BlendApp::BuildRootSignature()
 	CD3DX12_DESCRIPTOR_RANGE texTable;
 	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
 
+	//Every block texture at once for the instanced shader, in space2 so it does not overlap t0
+	CD3DX12_DESCRIPTOR_RANGE blockTexTable;
+	blockTexTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, gNumBlockTextures, 0, 2);
+
     // Root parameter can be a table, root descriptor or root constants.
-    CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+    CD3DX12_ROOT_PARAMETER slotRootParameter[7];
 
 	// Perfomance TIP: Order from most frequent to least frequent.
 	slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
     slotRootParameter[1].InitAsConstantBufferView(0);
     slotRootParameter[2].InitAsConstantBufferView(1);
-    slotRootParameter[3].InitAsConstantBufferView(2);
+    slotRootParameter[3].InitAsShaderResourceView(0, 3); // every material
+	slotRootParameter[4].InitAsShaderResourceView(0, 1, D3D12_SHADER_VISIBILITY_VERTEX); // instance records
+	slotRootParameter[5].InitAsDescriptorTable(1, &blockTexTable, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameter[6].InitAsConstants(1, 3, 0, D3D12_SHADER_VISIBILITY_VERTEX); // first instance of an indirect draw
 
 	auto staticSamplers = GetStaticSamplers();
 
     // A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(7, slotRootParameter,
 		(UINT)staticSamplers.size(), staticSamplers.data(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -766,13 +1039,35 @@ void BlendApp::BuildRootSignature()
         IID_PPV_ARGS(mRootSignature.GetAddressOf())));
 }
 
+//Describes an IndirectDrawArgs record: the instance offset root constant, then a DrawIndexedInstanced
+void BlendApp::BuildCommandSignatures()
+{
+	D3D12_INDIRECT_ARGUMENT_DESC argumentDescs[2] = {};
+	argumentDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	argumentDescs[0].Constant.RootParameterIndex = 6;
+	argumentDescs[0].Constant.DestOffsetIn32BitValues = 0;
+	argumentDescs[0].Constant.Num32BitValuesToSet = 1;
+	argumentDescs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+	signatureDesc.ByteStride = sizeof(IndirectDrawArgs);
+	signatureDesc.NumArgumentDescs = _countof(argumentDescs);
+	signatureDesc.pArgumentDescs = argumentDescs;
+
+	//The root signature is required because the records change a root argument
+	ThrowIfFailed(md3dDevice->CreateCommandSignature(&signatureDesc, mRootSignature.Get(),
+		IID_PPV_ARGS(mBlockCommandSignature.GetAddressOf())));
+
+	mRenderDevice->SetIndirectSignature(mBlockCommandSignature.Get());
+}
+
 void BlendApp::BuildDescriptorHeaps()
 {
 	//
 	// Create the SRV heap.
 	//
 	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 9;
+	srvHeapDesc.NumDescriptors = gNumBlockTextures;
 	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
@@ -856,8 +1151,7 @@ void BlendApp::BuildDescriptorHeaps()
 	srvDesc.Format = mEmerald->GetDesc().Format;
 	md3dDevice->CreateShaderResourceView(mEmerald.Get(), &srvDesc, hDescriptor);
 
-
-
+	mRenderDevice->SetTextureHeap(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart(), mCbvSrvDescriptorSize);
 }
 
 void BlendApp::BuildShadersAndInputLayout()
@@ -875,9 +1169,21 @@ void BlendApp::BuildShadersAndInputLayout()
 		NULL, NULL
 	};
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_0");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", defines, "PS", "ps_5_0");
-	mShaders["alphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_0");
+	const D3D_SHADER_MACRO shadowDefines[] =
+	{
+		"SHADOW", "1",
+		NULL, NULL
+	};
+
+	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
+	mShaders["shadowVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", shadowDefines, "VS", "vs_5_1");
+	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", defines, "PS", "ps_5_1");
+	mShaders["alphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_1");
+
+	//Indexing the block texture array per pixel needs shader model 5.1
+	mShaders["instancedVS"] = d3dUtil::CompileShader(L"Shaders\\Instanced.hlsl", nullptr, "VS", "vs_5_1");
+	mShaders["instancedPS"] = d3dUtil::CompileShader(L"Shaders\\Instanced.hlsl", defines, "PS", "ps_5_1");
+	mShaders["instancedAlphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Instanced.hlsl", alphaTestDefines, "PS", "ps_5_1");
 	
     mInputLayout =
     {
@@ -888,6 +1194,25 @@ void BlendApp::BuildShadersAndInputLayout()
 }
 
 
+//Creates the GPU copies of a geometry's vertices and indices
+void BlendApp::BuildGeometryBuffers(const std::string& name, const std::vector<Vertex>& vertices, const std::vector<std::uint16_t>& indices)
+{
+	BufferDesc vbDesc;
+	vbDesc.Usage = BufferUsage::Vertex;
+	vbDesc.ElementCount = (UINT)vertices.size();
+	vbDesc.ElementByteSize = sizeof(Vertex);
+
+	BufferDesc ibDesc;
+	ibDesc.Usage = BufferUsage::Index;
+	ibDesc.ElementCount = (UINT)indices.size();
+	ibDesc.ElementByteSize = sizeof(std::uint16_t);
+
+	GeometryBuffers buffers;
+	buffers.Vertices = mRenderDevice->CreateBuffer(vbDesc, vertices.data());
+	buffers.Indices = mRenderDevice->CreateBuffer(ibDesc, indices.data());
+	mGeometryBuffers[name] = buffers;
+}
+
 void BlendApp::BuildBoxGeometry()
 {
 	GeometryGenerator geoGen;
@@ -916,11 +1241,7 @@ void BlendApp::BuildBoxGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	BuildGeometryBuffers(geo->Name, vertices, indices);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -965,11 +1286,7 @@ void BlendApp::BuildSkyBoxGeometry() //this is where the sky box is built and cr
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	BuildGeometryBuffers(geo->Name, vertices, indices);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1094,20 +1411,114 @@ void BlendApp::BuildPSOs()
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowPsoDesc = transparentPsoDesc;
 	shadowPsoDesc.DepthStencilState = shadowDSS;
+	shadowPsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["shadowVS"]->GetBufferPointer()),
+		mShaders["shadowVS"]->GetBufferSize()
+	};
 	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&shadowPsoDesc,
 		IID_PPV_ARGS(&mPSOs["shadow"])));
 
+	//
+	// PSOs for instanced blocks
+	//
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC instancedPsoDesc = opaquePsoDesc;
+	instancedPsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["instancedVS"]->GetBufferPointer()),
+		mShaders["instancedVS"]->GetBufferSize()
+	};
+	instancedPsoDesc.PS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["instancedPS"]->GetBufferPointer()),
+		mShaders["instancedPS"]->GetBufferSize()
+	};
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&instancedPsoDesc, IID_PPV_ARGS(&mPSOs["instanced"])));
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC instancedWireframePsoDesc = instancedPsoDesc;
+	instancedWireframePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&instancedWireframePsoDesc, IID_PPV_ARGS(&mPSOs["instanced_wireframe"])));
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC instancedAlphaTestedPsoDesc = instancedPsoDesc;
+	instancedAlphaTestedPsoDesc.PS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["instancedAlphaTestedPS"]->GetBufferPointer()),
+		mShaders["instancedAlphaTestedPS"]->GetBufferSize()
+	};
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&instancedAlphaTestedPsoDesc, IID_PPV_ARGS(&mPSOs["instancedAlphaTested"])));
+
+	//Pipeline ids in queue layer slot order, then the instanced layers
+	const char* pipelineNames[gPipelineCount] = { "opaque", "alphaTested", "transparent", "shadow", "instanced", "instancedAlphaTested" };
+	const char* wireframeNames[gPipelineCount] = { "opaque_wireframe", "alphaTested", "transparent", "shadow", "instanced_wireframe", "instancedAlphaTested" };
+	for (UINT pipeline = 0; pipeline < gPipelineCount; ++pipeline)
+	{
+		mPipelinePsos[pipeline] = mPSOs.Find(pipelineNames[pipeline]);
+		mWireframePipelinePsos[pipeline] = mPSOs.Find(wireframeNames[pipeline]);
+		assert(mPipelinePsos[pipeline].Valid() && mWireframePipelinePsos[pipeline].Valid());
+	}
 }//End Build PSOs
 
 void BlendApp::BuildFrameResources()
 {
+	//Starting sizes, room for the world as built and every block as an instance. The frame
+	//resources grow from here as the world does.
+	UINT arenaByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants)) +
+		d3dUtil::CalcConstantBufferByteSize(mRitems.Size() * (UINT)sizeof(BlockInstance));
+
     for(int i = 0; i < gNumFrameResources; ++i)
     {
-        mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount()));
+        mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(), *mRenderDevice,
+            mTransforms.Size(), mMaterials.Size(), mWaves->VertexCount(), arenaByteSize, gNumRecordLists, (UINT)InstancedLayer::Count));
     }
 }
 
+//Call after adding render items or materials, at startup or at runtime. The frame resources
+//take the new counts right away and grow their buffers when they next come round.
+void BlendApp::SyncFrameResources()
+{
+	mRitemsByObjCB.resize(mTransforms.Size());
+	mRitems.ForEach([&](RenderItem& ri)
+	{
+		mRitemsByObjCB[ri.ObjCBIndex] = &ri;
+	});
+
+	mMaterialsByCB.resize(mMaterials.Size());
+	for (auto& mat : mMaterials)
+		mMaterialsByCB[mat->MatCBIndex] = mat.get();
+
+	for (auto& frameResource : mFrameResources)
+		frameResource->Resize(mTransforms.Size(), mMaterials.Size());
+}
+
+//Room in the upload arena for one pass and the instances of every instanced block
+UINT BlendApp::FrameArenaByteSize()const
+{
+	UINT instanceCount = 0;
+	for (int layer = 0; layer < (int)InstancedLayer::Count; ++layer)
+		instanceCount += (UINT)mInstanceBatches[layer].Instances.Size();
+
+	return d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants)) +
+		d3dUtil::CalcConstantBufferByteSize(instanceCount * sizeof(BlockInstance));
+}
+
+//One command list per recording range. They are reset onto the current frame's
+//allocators every frame, so any frame's allocator will do to create them.
+void BlendApp::BuildRecordCommandLists()
+{
+	for (int i = 0; i < gNumRecordLists; ++i)
+	{
+		ComPtr<ID3D12GraphicsCommandList> cmdList;
+		ThrowIfFailed(md3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+			mFrameResources[0]->RecordCmdListAllocs[i].Get(), nullptr, IID_PPV_ARGS(cmdList.GetAddressOf())));
+
+		// Start off in a closed state, Draw resets them before recording.
+		ThrowIfFailed(cmdList->Close());
+		mRecordCmdLists.push_back(cmdList);
+		mRecordContexts.push_back(std::make_unique<D3D12RenderContext>(*mRenderDevice, cmdList.Get()));
+	}
+}
+
 void BlendApp::BuildMaterials()
 {
 	auto grass = std::make_unique<Material>();
@@ -1207,64 +1618,61 @@ void BlendApp::BuildMaterials()
 	mMaterials["mBedRock"] = std::move(mBedRock);
 	mMaterials["mEmerald"] = std::move(mEmerald);
 	mMaterials["shadowMat"] = std::move(shadowMat);
+
+	mBlockMaterials[BlockType_BedRock] = mMaterials.Find("mBedRock");
+	mBlockMaterials[BlockType_Stone] = mMaterials.Find("mStone");
+	mBlockMaterials[BlockType_Emerald] = mMaterials.Find("mEmerald");
+	mBlockMaterials[BlockType_Dirt] = mMaterials.Find("mDirt");
+	mBlockMaterials[BlockType_Grass] = mMaterials.Find("mGrass");
 }
 
 
-//Method to return the material type at the specified level y
-//Also randomly places emerald ore among the stone levels
-std::string BlendApp::Block(int y, int size)
+void BlendApp::BuildRenderItems(int worldsize)
 {
-	bool tf = (rand() % 2) != 0; //Generates a random number between 0 and 1.
-	bool emerald = (rand() % 20 == 0); //Creates a 1 in 20 chance of placing an emerald textured block
-	
-
+	int size = worldsize;
 
-	if (y < 2)	//Bedrock layer
-		return "mBedRock";
-	else if (y > 2 && y < (size/2))	//Stone and emerald layer
+	//The world is kept between runs as a level file holding the terrain's seed, and
+	//region files of any chunks that were saved. A new world with a new seed is only
+	//started when there is no save of the right size. A save made by another version of
+	//the terrain generator is thrown away too, as its chunks are deltas against terrain
+	//that is no longer generated
+	mWorld.Resize(size, TerrainDepth, size);
+
+	LevelInfo level;
+	if (!ReadLevel(gWorldSavePrefix, level) || level.ChunksX != mWorld.ChunksX() ||
+		level.ChunksY != mWorld.ChunksY() || level.ChunksZ != mWorld.ChunksZ() ||
+		level.Generator != TerrainVersion)
 	{
-		if (emerald)
-			return "mEmerald";
-		else
-			return "mStone";
+		DeleteWorld(gWorldSavePrefix);
+		level.Generator = TerrainVersion;
+		level.ChunksX = mWorld.ChunksX();
+		level.ChunksY = mWorld.ChunksY();
+		level.ChunksZ = mWorld.ChunksZ();
+		level.Seed = (std::uint32_t)time(NULL) | 1;
+		WriteLevel(gWorldSavePrefix, level);
 	}
-	else if (y > (size/2) && y < (size-2))	//Dirt layer
-		return "mDirt";
-	else if (y>=(size-2) && y<=size)	//Grass layer
-		return "mGrass";
-
-	//Checks the borders of bedrock/stone and stone/dirt and makes it look like they blend
-	//into each other. Using the tf bool it will be a 50/50 chance for the block on the border
-	//to be either one texture or the other
-	else if (y == 2)
-	{
-		if (tf)
-			return "mBedRock";
-		else
-			return "mStone";
-	}
-	else if (y == size/2)
-	{
-		if (tf)
-			return "mStone";
-		else
-			return "mDirt";
-	}
-	return "mGrass";
-}
 
-void BlendApp::BuildRenderItems(int worldsize)
-{
-	srand (time(NULL));	
-	int size = worldsize;
-	const int DEPTH = 8;
-	int i = 0;
+	//The chunks are loaded or generated in the background as the camera comes near them
+	//and put into the world by UpdateTerrainStreaming, so startup does not wait for them
+	mChunkStreamer = std::make_unique<ChunkStreamer>(gWorldSavePrefix, level.Seed,
+		mWorld.ChunksX(), mWorld.ChunksY(), mWorld.ChunksZ(), gStreamingThreads);
+
+	mWorldOrigin[0] = (float)-(size / 2);
+	mWorldOrigin[1] = (float)-(TerrainDepth / 2);
+	mWorldOrigin[2] = (float)-(size / 2);
+
+	mChunkResidency = ChunkResidency(mWorld.ChunksX(), mWorld.ChunksY(), mWorld.ChunksZ(), gChunkMemoryBudget);
+
+	//Cached meshes are checked against the blocks they were made from, so those of an
+	//old world are simply missed and written over
+	mMeshCache = std::make_unique<MeshCache>(MeshCache::PrefixFor(gWorldSavePrefix));
+	mWorldMesh.SetCache(mMeshCache.get());
+	mChunkShadowItems.assign((size_t)mWorld.ChunksX() * mWorld.ChunksY() * mWorld.ChunksZ(), std::vector<ObjectPool<RenderItem>::Handle>());
 
 
 	//Character render item code
-	auto charRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&charRitem->World, XMMatrixTranslation(mCharTranslation.x, mCharTranslation.y, mCharTranslation.z));//Translates the character to the mchartranslation float3
-	charRitem->ObjCBIndex = i;
+	RenderItem* charRitem = mRitems.Get(mRitems.Create());
+	charRitem->ObjCBIndex = AddTransform(XMMatrixTranslation(mCharTranslation.x, mCharTranslation.y, mCharTranslation.z));//Translates the character to the mchartranslation float3
 	charRitem->Mat = mMaterials["wirefence"].get();
 	charRitem->Geo = mGeometries["boxGeo"].get();
 	charRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -1273,13 +1681,11 @@ void BlendApp::BuildRenderItems(int worldsize)
 	charRitem->BaseVertexLocation = charRitem->Geo->DrawArgs["box"].BaseVertexLocation;
 	charRitem->shouldRender = true;
 	charRitem->isPlayer = true;
-	mRitemLayer[(int)RenderLayer::AlphaTested].push_back(charRitem.get());
-	mAllRitems.push_back(std::move(charRitem));
+	mcharRitem = charRitem; //Drawn instanced as a dynamic block, so it is not in a layer
 
 	//Skybox creation and size
-	auto skyboxRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&skyboxRitem->World, XMMatrixScaling(200, 200, 200));
-	skyboxRitem->ObjCBIndex = ++i;
+	RenderItem* skyboxRitem = mRitems.Get(mRitems.Create());
+	skyboxRitem->ObjCBIndex = AddTransform(XMMatrixScaling(200, 200, 200));
 	skyboxRitem->Mat = mMaterials["grass"].get(); //loads first material called grass but is the skybox.dds
 	skyboxRitem->Geo = mGeometries["skyboxGeo"].get();
 	skyboxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -1287,101 +1693,442 @@ void BlendApp::BuildRenderItems(int worldsize)
 	skyboxRitem->StartIndexLocation = skyboxRitem->Geo->DrawArgs["skybox"].StartIndexLocation;
 	skyboxRitem->BaseVertexLocation = skyboxRitem->Geo->DrawArgs["skybox"].BaseVertexLocation;
 	skyboxRitem->shouldRender = true;
-	mRitemLayer[(int)RenderLayer::AlphaTested].push_back(skyboxRitem.get());
-	mAllRitems.push_back(std::move(skyboxRitem));
+	mRitemLayer[(int)RenderLayer::AlphaTested].push_back(skyboxRitem);
+
 
+	SyncFrameResources();
 
-	//This is the terrain generator. 
-	//Goes through each x,z coordinate and builds up the y direction
-	//So at x=0 and z=0 it will build a stack of render items to a random height between DEPTH -1 and DEPTH -3
-	for (int x = 0; x < size; x++) 
+	MeshGeometry* boxGeo = mGeometries["boxGeo"].get();
+	const SubmeshGeometry& boxArgs = boxGeo->DrawArgs["box"];
+
+	//The terrain layer draws the exposed blocks of the world, meshed again only where
+	//chunks arrive rather than gathered from the render items every frame
+	InstanceBatch& terrain = mInstanceBatches[(int)InstancedLayer::Terrain];
+	terrain.Geo = boxGeo;
+	terrain.Args = boxArgs;
+	terrain.Buffers = mGeometryBuffers[boxGeo->Name];
+
+	for (int type = BlockType_Air + 1; type < BlockType_Count; ++type)
+		mBlockIds[type] = mMaterials[mBlockMaterials[type]]->MatCBIndex;
+
+	InstanceBatch& dynamic = mInstanceBatches[(int)InstancedLayer::Dynamic];
+	dynamic.Geo = boxGeo;
+	dynamic.Args = boxArgs;
+	dynamic.Buffers = mGeometryBuffers[boxGeo->Name];
+}
+
+//Builds the shadow casters of a chunk that has just arrived: one for every block of
+//the top layer of the terrain. The blocks themselves are drawn from the meshed world's
+//instances and get no render items.
+void BlendApp::BuildChunkShadowItems(const ChunkCoord& chunk)
+{
+	//Looked up once here rather than for every block
+	MeshGeometry* boxGeo = mGeometries["boxGeo"].get();
+	const SubmeshGeometry& boxArgs = boxGeo->DrawArgs["box"];
+	Material* shadowMat = mMaterials["shadowMat"].get();
+
+	size_t index = chunk.X + (size_t)mWorld.ChunksX() * (chunk.Z + (size_t)mWorld.ChunksZ() * chunk.Y);
+	std::vector<ObjectPool<RenderItem>::Handle>& shadowItems = mChunkShadowItems[index];
+
+	int minX = (int)(chunk.X * WorldChunk::Dims::SizeX);
+	int minY = (int)(chunk.Y * WorldChunk::Dims::SizeY);
+	int minZ = (int)(chunk.Z * WorldChunk::Dims::SizeZ);
+
+	//Only columns reaching the top layer cast a shadow, so the rest of the chunk is not looked at
+	int y = TerrainDepth - 1;
+	if (y < minY || y >= minY + (int)WorldChunk::Dims::SizeY)
+		return;
+
+	for (int x = minX; x < minX + (int)WorldChunk::Dims::SizeX; x++) 
 	{
-		for (int z = 0; z < size; z++)
+		for (int z = minZ; z < minZ + (int)WorldChunk::Dims::SizeZ; z++)
 		{
-			for (int y = 0; y < rand() % 2 + (DEPTH - 1); y++)
-			{
-				auto boxRitem = std::make_unique<RenderItem>();		
-				XMStoreFloat4x4(&boxRitem->World, XMMatrixTranslation((float)x - (size / 2), (float)y - (DEPTH / 2), (float)z - (size / 2)));
-				boxRitem->ObjCBIndex = ++i;
-				boxRitem->Mat = mMaterials[Block(y, DEPTH)].get(); //Calls the Block method to determine the material of the block at position y
-				boxRitem->Geo = mGeometries["boxGeo"].get();
-				boxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-				boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
-				boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
-				boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
-				boxRitem->shouldRender = false;						//We set the value of shouldRender to false so all of the render items won't render
-																	//unless we specify that they should
-				mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem.get());
-
-				if (x == 0 || y == 0 || z == 0 || x == size-1 || y >= DEPTH-4 || z == size-1) //Here, if the item is not within these specified borders
-				{																			// then we don't render it
-					boxRitem->shouldRender = true;
-				}
-				
-				//If the current height is the top layer of the terrain then we're going to build a shadow item for the current item
-				//This code currently only creates one planar shadow at the world origin
-				//It does update with time and the position of the light source.
-				if (y >= DEPTH-1)
-				{
-					auto shadowedBoxRitem = std::make_unique<RenderItem>();
-					XMStoreFloat4x4(&shadowedBoxRitem->World, XMMatrixTranslation((float)x - (size / 2), (float)y - (DEPTH / 2), (float)z - (size / 2)));
-					shadowedBoxRitem->ObjCBIndex = ++i;
-					shadowedBoxRitem->Mat = mMaterials["shadowMat"].get();
-					shadowedBoxRitem->Geo = mGeometries["boxGeo"].get();
-					shadowedBoxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-					shadowedBoxRitem->IndexCount = shadowedBoxRitem->Geo->DrawArgs["box"].IndexCount;
-					shadowedBoxRitem->StartIndexLocation = shadowedBoxRitem->Geo->DrawArgs["box"].StartIndexLocation;
-					shadowedBoxRitem->BaseVertexLocation = shadowedBoxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
-					shadowedBoxRitem->isShadow = true;
-					shadowedBoxRitem->shouldRender = true;
-					mRitemLayer[(int)RenderLayer::Shadow].push_back(shadowedBoxRitem.get());
-
-					mAllRitems.push_back(std::move(shadowedBoxRitem));
-				}
-				mAllRitems.push_back(std::move(boxRitem));
-			}//End y for			
+			if (mWorld.SurfaceHeight(x, z) < y)
+				continue;
+
+			//Its world matrix places the block, which the pass's shadow transform then flattens,
+			//so it follows the light source over time.
+			ObjectPool<RenderItem>::Handle handle = mRitems.Create();
+			RenderItem* shadowedBoxRitem = mRitems.Get(handle);
+			shadowedBoxRitem->ObjCBIndex = AddTransform(XMMatrixTranslation((float)x + mWorldOrigin[0], (float)y + mWorldOrigin[1], (float)z + mWorldOrigin[2]));
+			shadowedBoxRitem->Mat = shadowMat;
+			shadowedBoxRitem->Geo = boxGeo;
+			shadowedBoxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			shadowedBoxRitem->IndexCount = boxArgs.IndexCount;
+			shadowedBoxRitem->StartIndexLocation = boxArgs.StartIndexLocation;
+			shadowedBoxRitem->BaseVertexLocation = boxArgs.BaseVertexLocation;
+			shadowedBoxRitem->isShadow = true;
+			shadowedBoxRitem->shouldRender = true;
+			AddRuntimeItem(shadowedBoxRitem, RenderLayer::Shadow);
+			shadowItems.push_back(handle);
 		}//End z for
 	}//End x for
+}
 
+//Takes in a render item created after startup. Unlike SyncFrameResources and BuildSortKeys
+//it looks at this item only, so streaming chunks in costs what they add and not what the
+//world already holds.
+void BlendApp::AddRuntimeItem(RenderItem* ri, RenderLayer layer)
+{
+	if (mRitemsByObjCB.size() < mTransforms.Size())
+		mRitemsByObjCB.resize(mTransforms.Size());
+	mRitemsByObjCB[ri->ObjCBIndex] = ri;
 
+	for (auto& frameResource : mFrameResources)
+		frameResource->Resize(mTransforms.Size(), mMaterials.Size());
+	MarkObjectDirty(ri);
+
+	for (int slot = 0; slot < (int)RenderLayer::Count; ++slot)
+	{
+		if (gLayerDrawOrder[slot] == layer)
+			BuildSortKey(ri, slot);
+	}
+	mRitemLayer[(int)layer].push_back(ri);
 }
 
-void BlendApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+//Hands the shadow casters of a chunk whose blocks were evicted to DestroyRetiredItems
+void BlendApp::RetireChunkShadowItems(const ChunkCoord& chunk)
 {
-	/*For destroying blocks, if we get on to it, could check the y coord of the destroyed and change all
-	the shouldRender bools of the y-1 render items*/
+	size_t index = chunk.X + (size_t)mWorld.ChunksX() * (chunk.Z + (size_t)mWorld.ChunksZ() * chunk.Y);
+	std::vector<ObjectPool<RenderItem>::Handle>& shadowItems = mChunkShadowItems[index];
+
+	mRetiredItems.insert(mRetiredItems.end(), shadowItems.begin(), shadowItems.end());
+	shadowItems.clear();
+}
 
-    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-    UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+//Takes the retired items out of the shadow layer in one pass over it, then destroys them
+//and frees their object constants
+void BlendApp::DestroyRetiredItems()
+{
+	if (mRetiredItems.empty())
+		return;
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	std::vector<const RenderItem*> retired;
+	retired.reserve(mRetiredItems.size());
+	for (ObjectPool<RenderItem>::Handle handle : mRetiredItems)
+		retired.push_back(mRitems.Get(handle));
+	std::sort(retired.begin(), retired.end());
 
-    // For each render item...
-    for(size_t i = 0; i < ritems.size(); ++i)
-    {
-        auto ri = ritems[i];
+	std::vector<RenderItem*>& shadowLayer = mRitemLayer[(int)RenderLayer::Shadow];
+	shadowLayer.erase(std::remove_if(shadowLayer.begin(), shadowLayer.end(),
+		[&](const RenderItem* ri) { return std::binary_search(retired.begin(), retired.end(), ri); }), shadowLayer.end());
+
+	for (ObjectPool<RenderItem>::Handle handle : mRetiredItems)
+	{
+		UINT index = mRitems.Get(handle)->ObjCBIndex;
+		mRitemsByObjCB[index] = nullptr;
+		mFreeObjCBs.push_back(index);
+		mRitems.Destroy(handle);
+	}
+	mRetiredItems.clear();
+}
+
+//What the blocks of a resident chunk cost the budget, with the shadow casters built from
+//them: each caster's pool slot, transforms and object constants in every frame resource
+size_t BlendApp::ChunkBlockBytes(const ChunkCoord& chunk)const
+{
+	//Uniform chunks point at the world's shared chunk of their type and cost nothing
+	size_t blockBytes = mWorld.GetChunk(chunk.X, chunk.Y, chunk.Z).IsUniform() ? 0 : sizeof(WorldChunk);
 
-		if (ri->shouldRender) //Checks if it should draw the item from ritems list
+	size_t index = chunk.X + (size_t)mWorld.ChunksX() * (chunk.Z + (size_t)mWorld.ChunksZ() * chunk.Y);
+	size_t itemBytes = sizeof(RenderItem) + 2 * sizeof(XMFLOAT4X4) +
+		gNumFrameResources * d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	return blockBytes + mChunkShadowItems[index].size() * itemBytes;
+}
+
+//Asks for the chunks around the camera and takes in those that have arrived: their
+//shadow casters are built and the terrain instances meshed again.  Then keeps what the
+//chunks hold under budget, dropping the meshes and blocks of chunks long out of view.
+void BlendApp::UpdateTerrainStreaming()
+{
+	XMFLOAT3 eye = mCamera.GetPosition3f();
+	XMFLOAT3 look = mCamera.GetLook3f();
+	const float eyeBlocks[3] = { eye.x - mWorldOrigin[0], eye.y - mWorldOrigin[1], eye.z - mWorldOrigin[2] };
+	const float lookDir[3] = { look.x, look.y, look.z };
+	mChunkStreamer->Request(eyeBlocks, lookDir, gViewDistance);
+
+	//The player cube is drawn at its starting position plus however far it has moved
+	float charPos[3];
+	mTransforms.GetTranslation(mcharRitem->ObjCBIndex, charPos);
+	const float playerBlocks[3] = {
+		charPos[0] + mCharTranslation.x - mWorldOrigin[0],
+		charPos[1] + mCharTranslation.y - mWorldOrigin[1],
+		charPos[2] + mCharTranslation.z - mWorldOrigin[2] };
+
+	mChunkResidency.BeginFrame();
+	mChunkResidency.Pin(playerBlocks, gPinDistance);
+	mMissingChunks.clear();
+	mChunkResidency.Use(eyeBlocks, gViewDistance, mMissingChunks);
+
+	//Chunks back in view that kept their blocks get back the mesh tiers they lost.
+	//Those without blocks are being streamed in again.
+	bool terrainChanged = false;
+	for (const ChunkCoord& chunk : mMissingChunks)
+	{
+		if (!mChunkResidency.Holds(chunk, ResidencyTier_Blocks))
+			continue;
+
+		if (!mChunkResidency.Holds(chunk, ResidencyTier_CpuMesh))
+		{
+			//Inside the chunk by a block, so only this chunk is meshed again
+			int minX = (int)(chunk.X * WorldChunk::Dims::SizeX);
+			int minY = (int)(chunk.Y * WorldChunk::Dims::SizeY);
+			int minZ = (int)(chunk.Z * WorldChunk::Dims::SizeZ);
+			mWorld.MarkDirty(MakeBlockBox(minX + 1, minY + 1, minZ + 1,
+				minX + (int)WorldChunk::Dims::SizeX - 1, minY + (int)WorldChunk::Dims::SizeY - 1, minZ + (int)WorldChunk::Dims::SizeZ - 1));
+		}
+		else if (!mChunkResidency.Holds(chunk, ResidencyTier_GpuMesh))
 		{
-			cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-			cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-			cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+			mWorldMesh.Show(chunk, true);
+			mChunkResidency.Hold(chunk, ResidencyTier_GpuMesh, mWorldMesh.ChunkMesh(chunk).Size() * sizeof(BlockInstance));
+			terrainChanged = true;
+		}
+	}
 
-			CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-			tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+	mPlacedChunks.clear();
+	mChunkStreamer->Collect(mWorld, mPlacedChunks);
+	mChunkLoadFailures = mChunkStreamer->LoadFailures();
 
-			D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
-			D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
+	//A chunk is placed again only after its blocks and casters were evicted, so it never
+	//has casters already
+	for (const ChunkCoord& chunk : mPlacedChunks)
+	{
+		BuildChunkShadowItems(chunk);
+		mChunkResidency.Hold(chunk, ResidencyTier_Blocks, ChunkBlockBytes(chunk));
+	}
 
-			cmdList->SetGraphicsRootDescriptorTable(0, tex);
-			cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-			cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+	mMeshedChunks.clear();
+	mWorldMesh.Update(mWorld, mWorldOrigin, mBlockIds, &mMeshedChunks);
+	for (const ChunkCoord& chunk : mMeshedChunks)
+	{
+		//Chunks not streamed in yet are meshed as air, next to ones that were
+		if (!mChunkResidency.Holds(chunk, ResidencyTier_Blocks))
+			continue;
+
+		const BlockInstanceList& mesh = mWorldMesh.ChunkMesh(chunk);
+		mChunkResidency.Hold(chunk, ResidencyTier_CpuMesh, mesh.Bytes());
+		mChunkResidency.Hold(chunk, ResidencyTier_GpuMesh, mesh.Size() * sizeof(BlockInstance));
+		terrainChanged = true;
+	}
 
-			cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+	mEvictions.clear();
+	mChunkResidency.Evict(mEvictions);
+	for (const ResidencyEviction& eviction : mEvictions)
+	{
+		switch (eviction.Tier)
+		{
+		case ResidencyTier_GpuMesh:
+			mWorldMesh.Show(eviction.Chunk, false);
+			terrainChanged = true;
+			break;
+		case ResidencyTier_CpuMesh:
+			mWorldMesh.Drop(eviction.Chunk);
+			break;
+		case ResidencyTier_Blocks:
+			//A chunk whose edits cannot be saved keeps its blocks and casters rather than lose them
+			if (mChunkStreamer->Unload(mWorld, eviction.Chunk))
+				RetireChunkShadowItems(eviction.Chunk);
+			else
+				mChunkResidency.Hold(eviction.Chunk, ResidencyTier_Blocks, ChunkBlockBytes(eviction.Chunk));
+			break;
+		default:
+			break;
 		}
-        
-    }
+	}
+	DestroyRetiredItems();
+	mChunkResidency.EndFrame();
+
+	if (terrainChanged)
+	{
+		InstanceBatch& terrain = mInstanceBatches[(int)InstancedLayer::Terrain];
+		mWorldMesh.Gather(terrain.Instances);
+	}
+}
+
+//Static part of every item's sort key. Has to run after BuildRenderItems and again
+//whenever an item changes layer, geometry or material.
+void BlendApp::BuildSortKeys()
+{
+	for (int slot = 0; slot < (int)RenderLayer::Count; ++slot)
+	{
+		for (auto ri : mRitemLayer[(int)gLayerDrawOrder[slot]])
+			BuildSortKey(ri, slot);
+	}
+}
+
+//Static part of the sort key of an item in the layer drawn at slot
+void BlendApp::BuildSortKey(RenderItem* ri, int slot)
+{
+	//Blended items have to be drawn back to front across the whole layer, so depth
+	//is the only thing they are sorted by
+	bool blended = (gLayerDrawOrder[slot] == RenderLayer::Transparent);
+
+	ri->GeometrySortId = GeometrySortId(ri->Geo);
+	ri->SortKey = blended ? RenderQueue::MakeKey(slot, slot, 0, 0) :
+		RenderQueue::MakeKey(slot, slot, ri->GeometrySortId, ri->Mat->MatCBIndex);
+}
+
+UINT BlendApp::GeometrySortId(const MeshGeometry* geo)
+{
+	for (size_t i = 0; i < mGeometrySortIds.size(); ++i)
+	{
+		if (mGeometrySortIds[i] == geo)
+			return (UINT)i;
+	}
+
+	mGeometrySortIds.push_back(geo);
+	mSortIdBuffers.push_back(mGeometryBuffers[geo->Name]);
+	return (UINT)mGeometrySortIds.size() - 1;
+}
+
+//Gathers the visible items of every layer and sorts them so that items sharing
+//state end up next to each other
+void BlendApp::BuildRenderQueue()
+{
+	XMFLOAT3 eye = mCamera.GetPosition3f();
+	XMFLOAT3 look = mCamera.GetLook3f();
+	float nearZ = mCamera.GetNearZ();
+	float farZ = mCamera.GetFarZ();
+
+	mRenderQueue.Clear();
+	mQueuedDraws.clear();
+
+	for (int slot = 0; slot < (int)RenderLayer::Count; ++slot)
+	{
+		RenderLayer layer = gLayerDrawOrder[slot];
+		bool backToFront = (layer == RenderLayer::Transparent);
+
+		if (layer == RenderLayer::Opaque) //Drawn instanced by DrawInstancedLayer
+			continue;
+
+		for (auto ri : mRitemLayer[(int)layer])
+		{
+			if (!ri->shouldRender)
+				continue;
+
+			float pos[3];
+			mTransforms.GetTranslation(ri->ObjCBIndex, pos);
+
+			float viewDepth = (pos[0] - eye.x)*look.x + (pos[1] - eye.y)*look.y + (pos[2] - eye.z)*look.z;
+			UINT depth = RenderQueue::QuantizeDepth(viewDepth, nearZ, farZ, backToFront);
+
+			const GeometryBuffers& buffers = mSortIdBuffers[ri->GeometrySortId];
+
+			QueuedDraw draw;
+			draw.Vertices = buffers.Vertices;
+			draw.Indices = buffers.Indices;
+			draw.Geometry = ri->GeometrySortId;
+			draw.Topology = ToPrimitiveTopology(ri->PrimitiveType);
+			draw.Texture = ri->Mat->DiffuseSrvHeapIndex;
+			draw.Material = ri->Mat->MatCBIndex;
+			draw.Object = ri->ObjCBIndex;
+			draw.IndexCount = ri->IndexCount;
+			draw.StartIndex = ri->StartIndexLocation;
+			draw.BaseVertex = ri->BaseVertexLocation;
+
+			mRenderQueue.Push(ri->SortKey | depth, (UINT)mQueuedDraws.size());
+			mQueuedDraws.push_back(draw);
+		}
+	}
+
+	mRenderQueue.Sort();
+}
+
+//Culls the instanced blocks for this frame, packs the visible ones into the frame's
+//upload arena and builds the indirect draw arguments that point at them
+void BlendApp::BuildBlockInstances()
+{
+	//The terrain instances are meshed by UpdateTerrainStreaming as chunks arrive and kept
+
+	//The player cube sits at its starting position plus however far it has been moved
+	InstanceBatch& dynamic = mInstanceBatches[(int)InstancedLayer::Dynamic];
+	float charPos[3];
+	mTransforms.GetTranslation(mcharRitem->ObjCBIndex, charPos);
+
+	dynamic.Instances.Clear();
+	dynamic.Instances.Add(
+		charPos[0] + mCharTranslation.x,
+		charPos[1] + mCharTranslation.y,
+		charPos[2] + mCharTranslation.z,
+		mcharRitem->Mat->MatCBIndex, BlockInstanceFlag_Dynamic);
+
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixMultiply(mCamera.GetView(), mCamera.GetProj()));
+
+	CullFrustum frustum;
+	ExtractFrustumPlanes(&viewProj._11, frustum);
+
+	UINT maxInstances = 0;
+	for (int layer = 0; layer < (int)InstancedLayer::Count; ++layer)
+		maxInstances += (UINT)mInstanceBatches[layer].Instances.Size();
+
+	//If the arena is full the instanced layers are skipped for the frame rather than overrun
+	UploadAllocation instanceUpload = mCurrFrameResource->Arena->Allocate(maxInstances * sizeof(BlockInstance));
+	BlockInstance* instances = static_cast<BlockInstance*>(instanceUpload.Data);
+	UINT instanceCount = 0;
+
+	mFrameBuffers.Instances = instanceUpload.Buffer;
+	mFrameBuffers.InstancesElement = instanceUpload.Element;
+
+	mIndirectArgs.Reset((UINT)InstancedLayer::Count);
+	for (int layer = 0; layer < (int)InstancedLayer::Count; ++layer)
+	{
+		const InstanceBatch& batch = mInstanceBatches[layer];
+
+		//Blocks are unit cubes, so a half extent of 0.5
+		UINT visible = instances ? (UINT)CullBlockInstances(batch.Instances, 0.5f, frustum, instances + instanceCount) : 0;
+
+		IndirectMesh mesh;
+		mesh.IndexCount = batch.Args.IndexCount;
+		mesh.StartIndexLocation = batch.Args.StartIndexLocation;
+		mesh.BaseVertexLocation = batch.Args.BaseVertexLocation;
+		mIndirectArgs.AddDraw(layer, mesh, instanceCount, visible);
+
+		instanceCount += visible;
+	}
+
+	mIndirectArgs.Write(static_cast<IndirectDrawArgs*>(
+		mRenderDevice->MapElements(mCurrFrameResource->IndirectArgsBuffer, 0, (UINT)mIndirectArgs.RecordCount())));
+}
+
+void BlendApp::DrawInstancedLayer(RenderContext& context, InstancedLayer layer)
+{
+	const InstanceBatch& batch = mInstanceBatches[(int)layer];
+
+	SubmitInstancedLayer(context, gInstancedPipelines + (UINT)layer, batch.Buffers.Vertices, batch.Buffers.Indices,
+		mIndirectArgs, (UINT)layer, mFrameBuffers);
+}
+
+//Called on a recording thread for each range of the sorted render queue
+void BlendApp::RecordRange(std::uint32_t list, const DrawRange& range)
+{
+	D3D12RenderContext& context = *mRecordContexts[list];
+
+	/*For destroying blocks, if we get on to it, could check the y coord of the destroyed and change all
+	the shouldRender bools of the y-1 render items*/
+
+	SetPassState(context);
+	SubmitQueuedDraws(context, mRenderQueue, range, mQueuedDraws.data(), mFrameBuffers, mDrawStates[list]);
+}
+
+//State every command list of the frame starts with, since none of it carries over between lists
+void BlendApp::SetPassState(D3D12RenderContext& context)
+{
+	ID3D12GraphicsCommandList* cmdList = context.CommandList();
+
+    cmdList->RSSetViewports(1, &mScreenViewport);
+    cmdList->RSSetScissorRects(1, &mScissorRect);
+
+    // Specify the buffers we are going to render to.
+    cmdList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+	cmdList->OMSetStencilRef(0);
+
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
+	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+
+	cmdList->SetGraphicsRootSignature(mRootSignature.Get());
+
+	context.SetConstantBuffer(RootSlot_Pass, mFrameBuffers.Pass, mFrameBuffers.PassElement);
 }
 
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> BlendApp::GetStaticSamplers()
@@ -0,0 +1,119 @@
+//***************************************************************************************
+// BlockCulling.cpp
+//***************************************************************************************
+
+#include "BlockCulling.h"
+#include "Simd.h"
+#include <cmath>
+
+void ExtractFrustumPlanes(const float viewProj[16], CullFrustum& frustum)
+{
+	// Column j of the matrix, as a plane.
+	auto column = [&](int j, int k) { return viewProj[k * 4 + j]; };
+
+	for(int k = 0; k < 4; ++k)
+	{
+		frustum.Planes[0][k] = column(3, k) + column(0, k); // left
+		frustum.Planes[1][k] = column(3, k) - column(0, k); // right
+		frustum.Planes[2][k] = column(3, k) + column(1, k); // bottom
+		frustum.Planes[3][k] = column(3, k) - column(1, k); // top
+		frustum.Planes[4][k] = column(2, k);                // near
+		frustum.Planes[5][k] = column(3, k) - column(2, k); // far
+	}
+}
+
+namespace
+{
+	// Survivors are gathered this many at a time before they are packed.  Small enough
+	// to stay in L1, large enough that each batch writes whole cache lines.
+	const std::uint32_t CullBatch = 256;
+}
+
+std::size_t CullBlockInstances(const BlockInstanceList& src, float halfExtent, const CullFrustum& frustum, BlockInstance* dst)
+{
+	const std::size_t count = src.Size();
+	std::size_t visible = 0;
+	std::size_t i = 0;
+
+	// Indices of the survivors not yet written.  Packed a batch at a time, so the upload
+	// memory only ever sees whole records written in order.
+	std::uint32_t batch[CullBatch];
+	std::uint32_t batched = 0;
+
+	auto flush = [&]()
+	{
+		visible += PackBlockInstances(src, batch, batched, dst + visible);
+		batched = 0;
+	};
+
+	// How far a box reaches along each plane normal.  Adding it to the signed distance
+	// of the centre gives the distance of the box corner nearest the inside.
+	float reach[6];
+	for(int p = 0; p < 6; ++p)
+	{
+		const float* plane = frustum.Planes[p];
+		reach[p] = halfExtent * (std::fabs(plane[0]) + std::fabs(plane[1]) + std::fabs(plane[2]));
+	}
+
+#if BLEND_SSE2
+	__m128 planeA[6], planeB[6], planeC[6], planeD[6];
+	for(int p = 0; p < 6; ++p)
+	{
+		planeA[p] = _mm_set1_ps(frustum.Planes[p][0]);
+		planeB[p] = _mm_set1_ps(frustum.Planes[p][1]);
+		planeC[p] = _mm_set1_ps(frustum.Planes[p][2]);
+		planeD[p] = _mm_set1_ps(frustum.Planes[p][3] + reach[p]);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+
+	for(; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&src.X[i]);
+		__m128 y = _mm_loadu_ps(&src.Y[i]);
+		__m128 z = _mm_loadu_ps(&src.Z[i]);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for(int p = 0; p < 6; ++p)
+		{
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeA[p], x), _mm_mul_ps(planeB[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeC[p], z), planeD[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, zero));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		while(mask != 0)
+		{
+			int lane = 0;
+			while(((mask >> lane) & 1) == 0)
+				++lane;
+			mask &= mask - 1;
+			batch[batched++] = (std::uint32_t)(i + lane);
+		}
+
+		if(batched > CullBatch - 4)
+			flush();
+	}
+#endif
+
+	for(; i < count; ++i)
+	{
+		bool inside = true;
+		for(int p = 0; p < 6 && inside; ++p)
+		{
+			const float* plane = frustum.Planes[p];
+			float d = plane[0] * src.X[i] + plane[1] * src.Y[i] + plane[2] * src.Z[i] + plane[3] + reach[p];
+			inside = d >= 0.0f;
+		}
+
+		if(inside)
+		{
+			batch[batched++] = (std::uint32_t)i;
+			if(batched == CullBatch)
+				flush();
+		}
+	}
+
+	flush();
+	return visible;
+}
@@ -0,0 +1,30 @@
+//***************************************************************************************
+// BlockCulling.h
+//
+// Frustum culling for instanced blocks.  Candidates are tested four at a time and the
+// indices of the survivors compacted, then packed out as whole BlockInstance records,
+// so the culling result is already the compact instance stream the indirect draws
+// read from.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include "BlockInstances.h"
+
+// Six clip planes (a, b, c, d) with the inside where a*x + b*y + c*z + d >= 0.  They
+// are not normalized, the tests below do not need them to be.
+struct CullFrustum
+{
+	float Planes[6][4];
+};
+
+// Extracts the planes from a row-major view-projection matrix that transforms row
+// vectors (the DirectXMath convention, before any transpose for HLSL), with clip
+// space depth in [0, 1].
+void ExtractFrustumPlanes(const float viewProj[16], CullFrustum& frustum);
+
+// Writes every instance of src whose axis aligned box of the given half extent is at
+// least partly inside the frustum to dst, in order, and returns how many were written.
+// dst needs room for src.Size() records.
+std::size_t CullBlockInstances(const BlockInstanceList& src, float halfExtent, const CullFrustum& frustum, BlockInstance* dst);
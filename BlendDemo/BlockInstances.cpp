@@ -0,0 +1,107 @@
+//***************************************************************************************
+// BlockInstances.cpp
+//***************************************************************************************
+
+#include "BlockInstances.h"
+#include "Simd.h"
+
+void BlockInstanceList::Clear()
+{
+	X.clear();
+	Y.clear();
+	Z.clear();
+	BlockAndFlags.clear();
+}
+
+void BlockInstanceList::Reserve(std::size_t count)
+{
+	X.reserve(count);
+	Y.reserve(count);
+	Z.reserve(count);
+	BlockAndFlags.reserve(count);
+}
+
+void BlockInstanceList::Add(float x, float y, float z, std::uint32_t blockId, std::uint32_t flags)
+{
+	X.push_back(x);
+	Y.push_back(y);
+	Z.push_back(z);
+	BlockAndFlags.push_back(PackBlockAndFlags(blockId, flags));
+}
+
+std::size_t BlockInstanceList::Bytes()const
+{
+	return (X.capacity() + Y.capacity() + Z.capacity()) * sizeof(float) +
+		BlockAndFlags.capacity() * sizeof(std::uint32_t);
+}
+
+void BlockInstanceList::Release()
+{
+	std::vector<float>().swap(X);
+	std::vector<float>().swap(Y);
+	std::vector<float>().swap(Z);
+	std::vector<std::uint32_t>().swap(BlockAndFlags);
+}
+
+std::size_t PackBlockInstances(const BlockInstanceList& src, const std::uint32_t* indices, std::size_t count,
+	BlockInstance* dst)
+{
+	std::size_t i = 0;
+
+#if BLEND_SSE2
+	// Gather four of each field and transpose, which turns the four columns into four
+	// complete records.  Aligned destinations get non-temporal stores so the upload
+	// heap is not read back into the cache.
+	const bool aligned = ((std::uintptr_t)dst & 15) == 0;
+	const float* x = src.X.data();
+	const float* y = src.Y.data();
+	const float* z = src.Z.data();
+	const float* w = reinterpret_cast<const float*>(src.BlockAndFlags.data());
+
+	auto store = [aligned](float* out, __m128 record)
+	{
+		if(aligned)
+			_mm_stream_ps(out, record);
+		else
+			_mm_storeu_ps(out, record);
+	};
+
+	for(; i + 4 <= count; i += 4)
+	{
+		const std::uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2], d = indices[i + 3];
+		__m128 r0 = _mm_setr_ps(x[a], x[b], x[c], x[d]);
+		__m128 r1 = _mm_setr_ps(y[a], y[b], y[c], y[d]);
+		__m128 r2 = _mm_setr_ps(z[a], z[b], z[c], z[d]);
+		__m128 r3 = _mm_setr_ps(w[a], w[b], w[c], w[d]);
+
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+		float* out = dst[i].Position;
+		store(out + 0, r0);
+		store(out + 4, r1);
+		store(out + 8, r2);
+		store(out + 12, r3);
+	}
+
+	// The rest still go out a whole record at a time.
+	for(; i < count; ++i)
+	{
+		const std::uint32_t a = indices[i];
+		store(dst[i].Position, _mm_setr_ps(x[a], y[a], z[a], w[a]));
+	}
+
+	if(aligned)
+		_mm_sfence();
+#endif
+
+	for(; i < count; ++i)
+	{
+		const std::uint32_t a = indices[i];
+		dst[i].Position[0] = src.X[a];
+		dst[i].Position[1] = src.Y[a];
+		dst[i].Position[2] = src.Z[a];
+		dst[i].BlockAndFlags = src.BlockAndFlags[a];
+	}
+
+	return count;
+}
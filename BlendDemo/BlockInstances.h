@@ -0,0 +1,67 @@
+//***************************************************************************************
+// BlockInstances.h
+//
+// Per-instance data for drawing many blocks of the same mesh with a single
+// DrawIndexedInstanced.  Instances are collected in structure-of-arrays form and
+// packed four at a time into the 16 byte records the instanced shader reads from a
+// structured buffer, so no instance pays for a 256 byte constant buffer slot.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum BlockInstanceFlags : std::uint32_t
+{
+	BlockInstanceFlag_None = 0,
+
+	// Block moves or animates, e.g. the player cube or a falling block.
+	BlockInstanceFlag_Dynamic = 1 << 0,
+};
+
+// Matches struct BlockInstance in Shaders/Instanced.hlsl.
+struct BlockInstance
+{
+	float Position[3];
+
+	// Block id in the low 16 bits, BlockInstanceFlags in the high 16 bits.
+	std::uint32_t BlockAndFlags;
+};
+
+static_assert(sizeof(BlockInstance) == 16, "BlockInstance must stay 16 bytes to match the shader.");
+
+inline std::uint32_t PackBlockAndFlags(std::uint32_t blockId, std::uint32_t flags)
+{
+	return (blockId & 0xffff) | (flags << 16);
+}
+
+// Instances waiting to be packed, kept as separate arrays so the packer can load four
+// of each field with one instruction.
+class BlockInstanceList
+{
+public:
+	void Clear();
+	void Reserve(std::size_t count);
+	void Add(float x, float y, float z, std::uint32_t blockId, std::uint32_t flags);
+
+	std::size_t Size()const { return X.size(); }
+
+	// Memory the arrays hold, used or not.
+	std::size_t Bytes()const;
+
+	// Clears the list and frees its memory.
+	void Release();
+
+	std::vector<float> X;
+	std::vector<float> Y;
+	std::vector<float> Z;
+	std::vector<std::uint32_t> BlockAndFlags;
+};
+
+// Writes the instances of src at the count indices to dst as BlockInstance records, in
+// the order given, and returns count.  dst is usually mapped upload heap memory, which
+// is write-combined, so the records are written whole and in order.
+std::size_t PackBlockInstances(const BlockInstanceList& src, const std::uint32_t* indices, std::size_t count,
+	BlockInstance* dst);
@@ -0,0 +1,1210 @@
+//***************************************************************************************
+// Checks.cpp
+//***************************************************************************************
+
+#include "Checks.h"
+#include "RenderQueue.h"
+#include "ParallelRecorder.h"
+#include "LinearAllocator.h"
+#include "UploadArena.h"
+#include "RecordingBackend.h"
+#include "ChunkSnapshot.h"
+#include "BlockCulling.h"
+#include "Chunk.h"
+#include "WorldEdit.h"
+#include "RegionFile.h"
+#include "Terrain.h"
+#include "WorldFile.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+
+namespace
+{
+	// Collects the failures of one run.  Unlike assert it is not compiled out of release
+	// builds, and a failure does not stop the checks after it.
+	class CheckLog
+	{
+	public:
+		void Check(bool passed, const char* condition, int line)
+		{
+			if(passed)
+				return;
+
+			char message[256];
+			std::snprintf(message, sizeof(message), "Checks.cpp(%d): %s", line, condition);
+			mFailures.push_back(message);
+		}
+
+		std::vector<std::string>& Failures() { return mFailures; }
+
+	private:
+		std::vector<std::string> mFailures;
+	};
+
+	#define BLEND_CHECK(condition) log.Check((condition), #condition, __LINE__)
+
+	//
+	// Render queue
+	//
+
+	// Sorts keys with the render queue and with std::stable_sort and checks they agree,
+	// items included, as the radix sort is stable.  Returns the passes it ran.
+	int CheckSortMatches(CheckLog& log, const std::vector<std::uint64_t>& keys)
+	{
+		RenderQueue queue;
+		std::vector<RenderQueueEntry> expected(keys.size());
+		for(std::size_t i = 0; i < keys.size(); ++i)
+		{
+			queue.Push(keys[i], (std::uint32_t)i);
+			expected[i].Key = keys[i];
+			expected[i].Item = (std::uint32_t)i;
+		}
+
+		queue.Sort();
+		std::stable_sort(expected.begin(), expected.end(), [](const RenderQueueEntry& a, const RenderQueueEntry& b)
+		{
+			return a.Key < b.Key;
+		});
+
+		bool same = queue.Size() == expected.size();
+		for(std::size_t i = 0; same && i < expected.size(); ++i)
+			same = queue[i].Key == expected[i].Key && queue[i].Item == expected[i].Item;
+		BLEND_CHECK(same);
+
+		return queue.LastSortPasses();
+	}
+
+	void CheckRadixSort(CheckLog& log)
+	{
+		std::mt19937_64 random(12345);
+
+		// Nothing and one key need no passes.
+		BLEND_CHECK(CheckSortMatches(log, std::vector<std::uint64_t>()) == 0);
+		BLEND_CHECK(CheckSortMatches(log, std::vector<std::uint64_t>(1, random())) == 0);
+
+		// Keys spread over all 64 bits.
+		for(std::size_t count : { 2, 3, 255, 256, 257, 1000, 70000 })
+		{
+			std::vector<std::uint64_t> keys(count);
+			for(auto& key : keys)
+				key = random();
+			CheckSortMatches(log, keys);
+		}
+
+		// Keys as BlendApp builds them, whose high bytes are the same for every draw.  Only
+		// the bytes holding depth and the low material bits need a pass.
+		{
+			std::vector<std::uint64_t> keys(5000);
+			for(auto& key : keys)
+				key = RenderQueue::MakeKey(2, 2, 0, 0, (std::uint32_t)random());
+			BLEND_CHECK(CheckSortMatches(log, keys) <= 4);
+		}
+
+		// Constant high bytes with a few values in one low byte, an odd number of passes,
+		// and many equal keys that have to keep their order.
+		{
+			std::vector<std::uint64_t> keys(3000);
+			for(auto& key : keys)
+				key = 0xabcd000000000000ull | (random() % 7) << 8;
+			BLEND_CHECK(CheckSortMatches(log, keys) == 1);
+		}
+
+		// Keys that are all equal are left where they are.
+		BLEND_CHECK(CheckSortMatches(log, std::vector<std::uint64_t>(1000, 0x123456789abcdef0ull)) == 0);
+
+		// Already sorted and reversed input.
+		{
+			std::vector<std::uint64_t> keys(4096);
+			for(std::size_t i = 0; i < keys.size(); ++i)
+				keys[i] = (std::uint64_t)i * 0x0001000100010001ull;
+			CheckSortMatches(log, keys);
+
+			std::reverse(keys.begin(), keys.end());
+			CheckSortMatches(log, keys);
+		}
+
+		// The queue sorts again from scratch after Clear.
+		{
+			RenderQueue queue;
+			for(std::uint32_t i = 0; i < 100; ++i)
+				queue.Push(random(), i);
+			queue.Sort();
+			queue.Clear();
+			BLEND_CHECK(queue.Empty());
+
+			queue.Push(2, 0);
+			queue.Push(1, 1);
+			queue.Sort();
+			BLEND_CHECK(queue.Size() == 2 && queue[0].Item == 1 && queue[1].Item == 0);
+		}
+	}
+
+	void CheckSortKeys(CheckLog& log)
+	{
+		std::uint64_t key = RenderQueue::MakeKey(9, 200, 3000, 4000, 123456789);
+		BLEND_CHECK(RenderQueue::KeyLayer(key) == 9);
+		BLEND_CHECK(RenderQueue::KeyPso(key) == 200);
+		BLEND_CHECK(RenderQueue::KeyGeometry(key) == 3000);
+		BLEND_CHECK(RenderQueue::KeyMaterial(key) == 4000);
+		BLEND_CHECK(RenderQueue::KeyDepth(key) == 123456789);
+
+		// Values too wide for their field are masked rather than spilling into the next.
+		std::uint64_t wide = RenderQueue::MakeKey(0, 0, 0, 0xffffffff, 0xffffffff);
+		BLEND_CHECK(RenderQueue::KeyGeometry(wide) == 0);
+		BLEND_CHECK(RenderQueue::KeyMaterial(wide) == (1u << RenderQueue::MaterialBits) - 1);
+		BLEND_CHECK(RenderQueue::KeyDepth(wide) == (1u << RenderQueue::DepthBits) - 1);
+
+		// Fields order keys from the most significant down.
+		BLEND_CHECK(RenderQueue::MakeKey(1, 0, 0, 0) > RenderQueue::MakeKey(0, 255, 4095, 4095, (1u << 28) - 1));
+		BLEND_CHECK(RenderQueue::MakeKey(0, 1, 0, 0) > RenderQueue::MakeKey(0, 0, 4095, 4095, (1u << 28) - 1));
+		BLEND_CHECK(RenderQueue::MakeKey(0, 0, 1, 0) > RenderQueue::MakeKey(0, 0, 0, 4095, (1u << 28) - 1));
+		BLEND_CHECK(RenderQueue::MakeKey(0, 0, 0, 1) > RenderQueue::MakeKey(0, 0, 0, 0, (1u << 28) - 1));
+
+		// Depth runs front to back, or back to front for blending, and stays in range.
+		const std::uint32_t maxDepth = (1u << RenderQueue::DepthBits) - 1;
+		const float nearZ = 1.0f, farZ = 1000.0f;
+		BLEND_CHECK(RenderQueue::QuantizeDepth(nearZ, nearZ, farZ, false) == 0);
+		BLEND_CHECK(RenderQueue::QuantizeDepth(farZ, nearZ, farZ, false) == maxDepth);
+		BLEND_CHECK(RenderQueue::QuantizeDepth(-5.0f, nearZ, farZ, false) == 0);
+		BLEND_CHECK(RenderQueue::QuantizeDepth(5000.0f, nearZ, farZ, false) == maxDepth);
+		BLEND_CHECK(RenderQueue::QuantizeDepth(std::numeric_limits<float>::quiet_NaN(), nearZ, farZ, false) == 0);
+		BLEND_CHECK(RenderQueue::QuantizeDepth(nearZ, nearZ, farZ, true) == maxDepth);
+		BLEND_CHECK(RenderQueue::QuantizeDepth(farZ, nearZ, farZ, true) == 0);
+
+		bool frontToBack = true, backToFront = true;
+		for(float z = nearZ; z < farZ; z += 0.75f)
+		{
+			frontToBack = frontToBack && RenderQueue::QuantizeDepth(z, nearZ, farZ, false) <= RenderQueue::QuantizeDepth(z + 0.75f, nearZ, farZ, false);
+			backToFront = backToFront && RenderQueue::QuantizeDepth(z, nearZ, farZ, true) >= RenderQueue::QuantizeDepth(z + 0.75f, nearZ, farZ, true);
+		}
+		BLEND_CHECK(frontToBack);
+		BLEND_CHECK(backToFront);
+	}
+
+	void CheckDrawStateCache(CheckLog& log)
+	{
+		DrawStateCache state;
+		BLEND_CHECK(state.SetPso(1));
+		BLEND_CHECK(!state.SetPso(1));
+		BLEND_CHECK(state.SetGeometry(0));
+		BLEND_CHECK(!state.SetGeometry(0));
+		BLEND_CHECK(state.SetTopology(0));
+		BLEND_CHECK(state.SetMaterial(5));
+		BLEND_CHECK(state.SetMaterial(6));
+		BLEND_CHECK(state.Stats().GeometrySkipped == 1 && state.Stats().MaterialSets == 2);
+
+		// A reset list has nothing bound.
+		state.Reset();
+		BLEND_CHECK(state.SetPso(1));
+		BLEND_CHECK(state.SetGeometry(0));
+		BLEND_CHECK(state.Stats().PsoSets == 1 && state.Stats().GeometrySkipped == 0);
+	}
+
+	//
+	// Linear allocator and upload arena
+	//
+
+	void CheckLinearAllocator(CheckLog& log)
+	{
+		// Every offset is aligned and starts at or after the end of the one before.
+		{
+			LinearAllocator allocator(1 << 20);
+			std::uint32_t end = 0;
+			bool aligned = true, ordered = true;
+			for(std::uint32_t i = 0; i < 200; ++i)
+			{
+				std::uint32_t alignment = 1u << (i % 9);
+				std::uint32_t size = 1 + i * 37 % 300;
+				std::uint32_t offset = allocator.Allocate(size, alignment);
+
+				aligned = aligned && offset != LinearAllocator::InvalidOffset && offset % alignment == 0;
+				ordered = ordered && offset >= end;
+				end = offset + size;
+			}
+			BLEND_CHECK(aligned);
+			BLEND_CHECK(ordered);
+			BLEND_CHECK(allocator.Used() == end);
+			BLEND_CHECK(allocator.FailedAllocations() == 0);
+		}
+
+		// Allocations that do not fit fail without using anything.
+		{
+			LinearAllocator allocator(1024);
+			BLEND_CHECK(allocator.Allocate(1000, 4) == 0);
+			BLEND_CHECK(allocator.Allocate(100, 4) == LinearAllocator::InvalidOffset);
+			BLEND_CHECK(allocator.Used() == 1000);
+			BLEND_CHECK(allocator.FailedAllocations() == 1);
+
+			// Fits unaligned but not once aligned.
+			BLEND_CHECK(allocator.Allocate(20, 256) == LinearAllocator::InvalidOffset);
+			BLEND_CHECK(allocator.FailedAllocations() == 2);
+
+			// Exactly fills what is left.
+			BLEND_CHECK(allocator.Allocate(24, 8) == 1000);
+			BLEND_CHECK(allocator.Used() == 1024);
+			BLEND_CHECK(allocator.Allocate(0, 1) == 1024);
+			BLEND_CHECK(allocator.Allocate(1, 1) == LinearAllocator::InvalidOffset);
+		}
+
+		// Near the top of the 32-bit range, aligning and adding must not wrap.
+		{
+			LinearAllocator allocator(0xffffffffu);
+			BLEND_CHECK(allocator.Allocate(0xfffffff0u, 1) == 0);
+			BLEND_CHECK(allocator.Allocate(16, 256) == LinearAllocator::InvalidOffset);
+			BLEND_CHECK(allocator.Allocate(0xffffffffu, 1) == LinearAllocator::InvalidOffset);
+			BLEND_CHECK(allocator.Used() == 0xfffffff0u);
+		}
+
+		// Reset frees everything but keeps the high water mark and failure count.
+		{
+			LinearAllocator allocator(256);
+			allocator.Allocate(200, 1);
+			allocator.Allocate(100, 1);
+			allocator.Reset();
+			BLEND_CHECK(allocator.Used() == 0);
+			BLEND_CHECK(allocator.HighWater() == 200);
+			BLEND_CHECK(allocator.FailedAllocations() == 1);
+			BLEND_CHECK(allocator.Allocate(256, 256) == 0);
+			BLEND_CHECK(allocator.HighWater() == 256);
+		}
+	}
+
+	void CheckUploadArena(CheckLog& log)
+	{
+		const std::uint32_t granularity = UploadArena::Granularity;
+		RecordingRenderDevice device;
+
+		// Two allocations fit and two fail; the frame asked for all four.
+		UploadArena arena(device, 4 * granularity);
+		std::uint32_t failed = 0;
+		for(int i = 0; i < 4; ++i)
+		{
+			UploadAllocation allocation = arena.Allocate(2 * granularity - 16);
+			if(!allocation.Valid())
+				++failed;
+			else
+				BLEND_CHECK(allocation.Buffer == arena.Buffer() && allocation.Element == (std::uint32_t)i * 2);
+		}
+		BLEND_CHECK(failed == 2);
+		BLEND_CHECK(arena.Allocator().FailedAllocations() == 2);
+		BLEND_CHECK(arena.Demand() == 8 * granularity);
+
+		// Resetting grows the arena to hold what the frame asked for, and then all of it fits.
+		arena.Reset();
+		BLEND_CHECK(arena.Grows() == 1);
+		BLEND_CHECK(arena.Demand() == 0);
+		BLEND_CHECK(arena.Allocator().Capacity() >= 8 * granularity);
+		BLEND_CHECK(device.ElementCount(arena.Buffer()) * granularity == arena.Allocator().Capacity());
+
+		for(int i = 0; i < 4; ++i)
+			BLEND_CHECK(arena.Allocate(2 * granularity - 16).Valid());
+		BLEND_CHECK(arena.Allocator().FailedAllocations() == 2);
+
+		// A frame that fits does not grow it again, but a minimum size still does.
+		arena.Reset();
+		BLEND_CHECK(arena.Grows() == 1);
+		arena.Reset(64 * granularity);
+		BLEND_CHECK(arena.Grows() == 2);
+		BLEND_CHECK(arena.Allocator().Capacity() >= 64 * granularity);
+
+		// Pushed values land in the element the allocation names.
+		UploadAllocation pushed = arena.Push(0x12345678u);
+		BLEND_CHECK(pushed.Valid());
+		BLEND_CHECK(*reinterpret_cast<const std::uint32_t*>(device.BufferData(arena.Buffer()) + pushed.Element * granularity) == 0x12345678u);
+	}
+
+	//
+	// Recording ranges
+	//
+
+	// Checks that ranges cover [0, itemCount) once, in order, with sizes that differ by at
+	// most one and no more of them than maxRanges.
+	void CheckRanges(CheckLog& log, const std::vector<DrawRange>& ranges, std::size_t itemCount, std::uint32_t maxRanges,
+		std::uint32_t minItemsPerRange)
+	{
+		if(itemCount == 0 || maxRanges == 0)
+		{
+			BLEND_CHECK(ranges.empty());
+			return;
+		}
+
+		BLEND_CHECK(!ranges.empty() && ranges.size() <= maxRanges);
+
+		std::vector<std::uint32_t> covered(itemCount, 0);
+		std::uint32_t next = 0, smallest = 0xffffffff, largest = 0;
+		bool contiguous = true, inBounds = true;
+		for(const DrawRange& range : ranges)
+		{
+			contiguous = contiguous && range.Begin == next && range.End > range.Begin;
+			inBounds = inBounds && range.End <= itemCount;
+			for(std::uint32_t i = range.Begin; i < range.End && i < itemCount; ++i)
+				covered[i]++;
+
+			smallest = std::min(smallest, range.End - range.Begin);
+			largest = std::max(largest, range.End - range.Begin);
+			next = range.End;
+		}
+
+		BLEND_CHECK(contiguous);
+		BLEND_CHECK(inBounds);
+		BLEND_CHECK(next == itemCount);
+		BLEND_CHECK(std::all_of(covered.begin(), covered.end(), [](std::uint32_t n) { return n == 1; }));
+		BLEND_CHECK(largest - smallest <= 1);
+
+		// More than one range only when each gets its minimum share.
+		BLEND_CHECK(ranges.size() == 1 || smallest >= std::max(minItemsPerRange, 1u));
+	}
+
+	void CheckSplitDrawRanges(CheckLog& log)
+	{
+		std::vector<DrawRange> ranges;
+		for(std::size_t itemCount : { 0, 1, 2, 7, 63, 64, 65, 255, 1000, 16384, 16387 })
+		{
+			for(std::uint32_t maxRanges : { 0, 1, 2, 3, 4, 8 })
+			{
+				for(std::uint32_t minItems : { 0, 1, 16, 64, 256 })
+				{
+					SplitDrawRanges(itemCount, maxRanges, minItems, ranges);
+					CheckRanges(log, ranges, itemCount, maxRanges, minItems);
+				}
+			}
+		}
+
+		// Enough items use every list.
+		SplitDrawRanges(1000, 4, 100, ranges);
+		BLEND_CHECK(ranges.size() == 4);
+		SplitDrawRanges(1000, 4, 300, ranges);
+		BLEND_CHECK(ranges.size() == 3);
+	}
+
+	// Counts how often each item is recorded, from any thread.
+	class CountingRecorder : public RangeRecorder
+	{
+	public:
+		CountingRecorder(std::size_t itemCount, std::uint32_t listCount) : mItems(itemCount), mLists(listCount)
+		{
+			for(auto& n : mItems)
+				n = 0;
+			for(auto& n : mLists)
+				n = 0;
+		}
+
+		virtual void RecordRange(std::uint32_t list, const DrawRange& range)override
+		{
+			mLists[list]++;
+			for(std::uint32_t i = range.Begin; i < range.End; ++i)
+				mItems[i]++;
+		}
+
+		bool EachItemOnce()const
+		{
+			return std::all_of(mItems.begin(), mItems.end(), [](const std::atomic<std::uint32_t>& n) { return n == 1; });
+		}
+
+		std::uint32_t ListCalls(std::uint32_t list)const { return mLists[list]; }
+
+	private:
+		std::vector<std::atomic<std::uint32_t>> mItems;
+		std::vector<std::atomic<std::uint32_t>> mLists;
+	};
+
+	void CheckParallelRecorder(CheckLog& log)
+	{
+		const std::uint32_t listCount = 4;
+		ParallelRecorder recorder(listCount);
+
+		for(std::size_t itemCount : { 0, 5, 300, 10000 })
+		{
+			const std::vector<DrawRange>& ranges = recorder.Split(itemCount, 64);
+			CheckRanges(log, ranges, itemCount, listCount, 64);
+
+			CountingRecorder counts(itemCount, listCount);
+			recorder.Record(counts);
+			BLEND_CHECK(counts.EachItemOnce());
+
+			bool oncePerList = true;
+			for(std::uint32_t list = 0; list < listCount; ++list)
+				oncePerList = oncePerList && counts.ListCalls(list) == (list < ranges.size() ? 1u : 0u);
+			BLEND_CHECK(oncePerList);
+		}
+	}
+
+	//
+	// Block culling
+	//
+
+	void CheckBlockCulling(CheckLog& log)
+	{
+		// Blocks scattered around a camera at the origin looking down +z.
+		std::mt19937 random(3);
+		BlockInstanceList blocks;
+		for(std::uint32_t i = 0; i < 5003; ++i)
+		{
+			float x = (float)(random() % 400) - 200.0f, y = (float)(random() % 400) - 200.0f, z = (float)(random() % 400) - 200.0f;
+			blocks.Add(x, y, z, i % 7, i % 3 == 0 ? BlockInstanceFlag_Dynamic : BlockInstanceFlag_None);
+		}
+
+		const float n = 1.0f, f = 150.0f;
+		const float viewProj[16] =
+		{
+			1.0f, 0.0f, 0.0f,              0.0f,
+			0.0f, 1.0f, 0.0f,              0.0f,
+			0.0f, 0.0f, f / (f - n),       1.0f,
+			0.0f, 0.0f, -n * f / (f - n),  0.0f,
+		};
+		CullFrustum frustum;
+		ExtractFrustumPlanes(viewProj, frustum);
+
+		// Every block whose box reaches inside all six planes, in order.
+		std::vector<std::uint32_t> expected;
+		for(std::uint32_t i = 0; i < blocks.Size(); ++i)
+		{
+			bool inside = true;
+			for(const float* plane : frustum.Planes)
+			{
+				float reach = 0.5f * (std::fabs(plane[0]) + std::fabs(plane[1]) + std::fabs(plane[2]));
+				inside = inside && plane[0] * blocks.X[i] + plane[1] * blocks.Y[i] + plane[2] * blocks.Z[i] + plane[3] + reach >= 0.0f;
+			}
+			if(inside)
+				expected.push_back(i);
+		}
+		BLEND_CHECK(!expected.empty() && expected.size() < blocks.Size());
+
+		// Once into aligned memory, which takes the streaming stores, and once not.
+		std::vector<BlockInstance> aligned(blocks.Size());
+		std::vector<std::uint8_t> bytes((blocks.Size() + 1) * sizeof(BlockInstance));
+		BlockInstance* unaligned = reinterpret_cast<BlockInstance*>(bytes.data() + 4);
+
+		for(BlockInstance* dst : { aligned.data(), unaligned })
+		{
+			std::size_t visible = CullBlockInstances(blocks, 0.5f, frustum, dst);
+			BLEND_CHECK(visible == expected.size());
+
+			bool same = visible == expected.size();
+			for(std::size_t i = 0; same && i < visible; ++i)
+			{
+				BlockInstance out;
+				std::memcpy(&out, dst + i, sizeof(out));
+				std::uint32_t k = expected[i];
+				same = out.Position[0] == blocks.X[k] && out.Position[1] == blocks.Y[k] && out.Position[2] == blocks.Z[k] &&
+					out.BlockAndFlags == blocks.BlockAndFlags[k];
+			}
+			BLEND_CHECK(same);
+		}
+	}
+
+	//
+	// Snapshot hash
+	//
+
+	void CheckSnapshotHash(CheckLog& log)
+	{
+		const std::uint32_t volume = PaddedChunkDims::Volume;
+		const std::uint32_t typeCount = BlockType_Count;
+
+		std::mt19937 random(7);
+		std::unique_ptr<ChunkSnapshot> base = std::make_unique<ChunkSnapshot>();
+		for(BlockType& block : base->Blocks)
+			block = (BlockType)(random() % typeCount);
+		const std::uint64_t baseHash = HashChunkSnapshot(*base);
+
+		// Any one block changed changes the hash.
+		std::unique_ptr<ChunkSnapshot> edited = std::make_unique<ChunkSnapshot>(*base);
+		bool singleChanges = true;
+		for(std::uint32_t i = 0; i < volume; ++i)
+		{
+			edited->Blocks[i] = (BlockType)((base->Blocks[i] + 1) % typeCount);
+			singleChanges = singleChanges && HashChunkSnapshot(*edited) != baseHash;
+			edited->Blocks[i] = base->Blocks[i];
+		}
+		BLEND_CHECK(singleChanges);
+
+		// Pairs of edits, half of them both in the top byte of an eight block word, which
+		// a hash that only multiplies lets cancel out about once in a few hundred.
+		std::uint32_t collisions = 0;
+		for(std::uint32_t trial = 0; trial < 20000; ++trial)
+		{
+			std::uint32_t a = random() % volume, b = random() % volume;
+			if(trial % 2 == 0)
+			{
+				a = a / 8 * 8 + 7;
+				b = b / 8 * 8 + 7;
+			}
+			if(a == b)
+				continue;
+
+			edited->Blocks[a] = (BlockType)((base->Blocks[a] + 1 + random() % (typeCount - 1)) % typeCount);
+			edited->Blocks[b] = (BlockType)((base->Blocks[b] + 1 + random() % (typeCount - 1)) % typeCount);
+			if(HashChunkSnapshot(*edited) == baseHash)
+				++collisions;
+			edited->Blocks[a] = base->Blocks[a];
+			edited->Blocks[b] = base->Blocks[b];
+		}
+		BLEND_CHECK(collisions == 0);
+	}
+
+	//
+	// Morton order
+	//
+
+	// Mistakes found by CheckMortonBlock.
+	struct MortonErrors
+	{
+		std::uint64_t Encode = 0;
+		std::uint64_t Decode = 0;
+		std::uint64_t Step = 0;
+	};
+
+	// Checks block x, y, z of a cube with a side of edge.  The build's encoding and
+	// decoding, pdep and pext when it has BMI2, have to agree with the shift-and-mask
+	// ones, and stepping the code along each axis has to give the neighbour's code.
+	// The expected codes are put together from spread, each axis value spread on its own.
+	void CheckMortonBlock(std::uint32_t x, std::uint32_t y, std::uint32_t z, std::uint32_t edge,
+		const std::uint32_t* spread, MortonErrors& errors)
+	{
+		std::uint32_t expected = spread[x] | spread[y] << 1 | spread[z] << 2;
+		std::uint32_t code = MortonEncode(x, y, z);
+		errors.Encode += code != expected;
+		errors.Decode += MortonDecodeX(code) != x || MortonDecodeY(code) != y || MortonDecodeZ(code) != z;
+		errors.Decode += MortonCompact(code) != x || MortonCompact(code >> 1) != y || MortonCompact(code >> 2) != z;
+
+		if(x + 1 < edge)
+			errors.Step += MortonIncrement(code, MortonMaskX) != ((expected & ~MortonMaskX) | spread[x + 1]);
+		if(x > 0)
+			errors.Step += MortonDecrement(code, MortonMaskX) != ((expected & ~MortonMaskX) | spread[x - 1]);
+		if(y + 1 < edge)
+			errors.Step += MortonIncrement(code, MortonMaskY) != ((expected & ~MortonMaskY) | spread[y + 1] << 1);
+		if(y > 0)
+			errors.Step += MortonDecrement(code, MortonMaskY) != ((expected & ~MortonMaskY) | spread[y - 1] << 1);
+		if(z + 1 < edge)
+			errors.Step += MortonIncrement(code, MortonMaskZ) != ((expected & ~MortonMaskZ) | spread[z + 1] << 2);
+		if(z > 0)
+			errors.Step += MortonDecrement(code, MortonMaskZ) != ((expected & ~MortonMaskZ) | spread[z - 1] << 2);
+	}
+
+	void CheckMortonCodes(CheckLog& log)
+	{
+		const std::uint32_t MaxEdge = 1024;
+		std::vector<std::uint32_t> spread(MaxEdge);
+		for(std::uint32_t v = 0; v < MaxEdge; ++v)
+			spread[v] = MortonEncodeSpread(v, 0, 0);
+
+		// Every block of a 16 cube.
+		MortonErrors small;
+		for(std::uint32_t z = 0; z < 16; ++z)
+			for(std::uint32_t y = 0; y < 16; ++y)
+				for(std::uint32_t x = 0; x < 16; ++x)
+					CheckMortonBlock(x, y, z, 16, spread.data(), small);
+		BLEND_CHECK(small.Encode == 0);
+		BLEND_CHECK(small.Decode == 0);
+		BLEND_CHECK(small.Step == 0);
+
+		// All billion blocks of the 1024 cube take half a minute, so it is checked on
+		// whole planes through it instead: every pair of values of two axes, at the
+		// edges of the third and where a step carries or borrows across many bits.
+		const std::uint32_t planes[] = { 0, 1, 2, 3, 7, 8, 63, 64, 511, 512, 1022, 1023 };
+		MortonErrors large;
+		for(std::uint32_t plane : planes)
+		{
+			for(std::uint32_t v = 0; v < MaxEdge; ++v)
+			{
+				for(std::uint32_t u = 0; u < MaxEdge; ++u)
+				{
+					CheckMortonBlock(u, v, plane, MaxEdge, spread.data(), large);
+					CheckMortonBlock(u, plane, v, MaxEdge, spread.data(), large);
+					CheckMortonBlock(plane, u, v, MaxEdge, spread.data(), large);
+				}
+			}
+		}
+		BLEND_CHECK(large.Encode == 0);
+		BLEND_CHECK(large.Decode == 0);
+		BLEND_CHECK(large.Step == 0);
+	}
+
+	// Steps from every block of a Morton ordered chunk to each neighbour inside it, and
+	// checks it lands on the same block as the same step in row-major order.
+	template<std::uint32_t Size>
+	void CheckMortonNeighbours(CheckLog& log)
+	{
+		typedef ChunkDims<Size, Size, Size, LinearLayout> LinearDims;
+		typedef ChunkDims<Size, Size, Size, MortonLayout> MortonDims;
+
+		std::uint32_t wrong = 0;
+		for(std::uint32_t index = 0; index < LinearDims::Volume; ++index)
+		{
+			std::int32_t x = LinearDims::X(index), y = LinearDims::Y(index), z = LinearDims::Z(index);
+			std::uint32_t code = MortonDims::Index(x, y, z);
+			for(std::uint32_t f = 0; f < BlockFace_Count; ++f)
+			{
+				BlockFace face = (BlockFace)f;
+				if(!LinearDims::Contains(x + BlockFaceStepX(face), y + BlockFaceStepY(face), z + BlockFaceStepZ(face)))
+					continue;
+
+				std::uint32_t linear = LinearDims::Neighbour(index, face);
+				std::uint32_t morton = MortonDims::Neighbour(code, face);
+				wrong += LinearDims::X(linear) != MortonDims::X(morton) || LinearDims::Y(linear) != MortonDims::Y(morton) ||
+					LinearDims::Z(linear) != MortonDims::Z(morton);
+			}
+		}
+		BLEND_CHECK(wrong == 0);
+	}
+
+	void CheckMorton(CheckLog& log)
+	{
+		CheckMortonCodes(log);
+		CheckMortonNeighbours<16>(log);
+	}
+
+	//
+	// World edits
+	//
+
+	bool InWorld(const World& world, std::int32_t x, std::int32_t y, std::int32_t z)
+	{
+		return (std::uint32_t)x < world.SizeX() && (std::uint32_t)y < world.SizeY() && (std::uint32_t)z < world.SizeZ();
+	}
+
+	// The box edits done the slow way, one World::Set per block, to check them against.
+	void SetEachFill(World& world, const BlockBox& box, BlockType type)
+	{
+		for(std::int32_t y = box.MinY; y < box.MaxY; ++y)
+			for(std::int32_t z = box.MinZ; z < box.MaxZ; ++z)
+				for(std::int32_t x = box.MinX; x < box.MaxX; ++x)
+					if(InWorld(world, x, y, z))
+						world.Set(x, y, z, type);
+	}
+
+	void SetEachReplace(World& world, const BlockBox& box, BlockType from, BlockType to)
+	{
+		for(std::int32_t y = box.MinY; y < box.MaxY; ++y)
+			for(std::int32_t z = box.MinZ; z < box.MaxZ; ++z)
+				for(std::int32_t x = box.MinX; x < box.MaxX; ++x)
+					if(InWorld(world, x, y, z) && world.Get(x, y, z) == from)
+						world.Set(x, y, z, to);
+	}
+
+	// Blocks whose source or destination is outside the world are left alone.
+	void SetEachClone(World& world, const BlockBox& source, std::int32_t dstX, std::int32_t dstY, std::int32_t dstZ)
+	{
+		std::int32_t offsetX = dstX - source.MinX, offsetY = dstY - source.MinY, offsetZ = dstZ - source.MinZ;
+		std::vector<BlockType> blocks;
+		for(std::int32_t y = source.MinY; y < source.MaxY; ++y)
+			for(std::int32_t z = source.MinZ; z < source.MaxZ; ++z)
+				for(std::int32_t x = source.MinX; x < source.MaxX; ++x)
+					blocks.push_back(world.Get(x, y, z));
+
+		std::size_t next = 0;
+		for(std::int32_t y = source.MinY; y < source.MaxY; ++y)
+		{
+			for(std::int32_t z = source.MinZ; z < source.MaxZ; ++z)
+			{
+				for(std::int32_t x = source.MinX; x < source.MaxX; ++x, ++next)
+				{
+					if(InWorld(world, x, y, z) && InWorld(world, x + offsetX, y + offsetY, z + offsetZ))
+						world.Set(x + offsetX, y + offsetY, z + offsetZ, blocks[next]);
+				}
+			}
+		}
+	}
+
+	std::vector<bool> TakeDirtyChunks(World& world)
+	{
+		std::vector<bool> dirty((std::size_t)world.ChunksX() * world.ChunksY() * world.ChunksZ(), false);
+		world.FlushDirtyChunks([&](std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)
+		{
+			dirty[cx + (std::size_t)world.ChunksX() * (cz + (std::size_t)world.ChunksZ() * cy)] = true;
+		});
+		return dirty;
+	}
+
+	// The edited world has to hold the same blocks and column tops as the one set block
+	// by block, and have at least the chunks it changed marked for meshing.
+	void CheckSameWorld(CheckLog& log, World& edited, World& expected)
+	{
+		bool sameBlocks = true;
+		for(std::int32_t y = 0; y < (std::int32_t)expected.SizeY(); ++y)
+			for(std::int32_t z = 0; z < (std::int32_t)expected.SizeZ(); ++z)
+				for(std::int32_t x = 0; x < (std::int32_t)expected.SizeX(); ++x)
+					sameBlocks = sameBlocks && edited.Get(x, y, z) == expected.Get(x, y, z);
+		BLEND_CHECK(sameBlocks);
+
+		bool sameTops = true;
+		for(std::int32_t z = 0; z < (std::int32_t)expected.SizeZ(); ++z)
+		{
+			for(std::int32_t x = 0; x < (std::int32_t)expected.SizeX(); ++x)
+			{
+				sameTops = sameTops && edited.SurfaceHeight(x, z) == expected.SurfaceHeight(x, z) &&
+					edited.LightHeight(x, z) == expected.LightHeight(x, z) &&
+					edited.SurfaceBlock(x, z) == expected.SurfaceBlock(x, z);
+			}
+		}
+		BLEND_CHECK(sameTops);
+
+		std::vector<bool> editedDirty = TakeDirtyChunks(edited);
+		std::vector<bool> expectedDirty = TakeDirtyChunks(expected);
+		bool dirtyCovered = true;
+		for(std::size_t i = 0; i < expectedDirty.size(); ++i)
+			dirtyCovered = dirtyCovered && (!expectedDirty[i] || editedDirty[i]);
+		BLEND_CHECK(dirtyCovered);
+	}
+
+	// Both worlds get the same ground: stone chunks below, air chunks above, and a
+	// rough surface in between, so box edits meet shared, uniform and private chunks.
+	void BuildEditWorld(World& world)
+	{
+		world.Resize(48, 48, 48);
+		std::mt19937 random(99);
+		for(std::int32_t z = 0; z < 48; ++z)
+		{
+			for(std::int32_t x = 0; x < 48; ++x)
+			{
+				std::int32_t top = 16 + (std::int32_t)(random() % 12);
+				for(std::int32_t y = 0; y < top; ++y)
+					world.Set(x, y, z, y < 16 ? BlockType_Stone : (BlockType)(1 + random() % (BlockType_Count - 1)));
+			}
+		}
+		world.Compact();
+	}
+
+	void CheckWorldEdits(CheckLog& log)
+	{
+		World edited, expected;
+		BuildEditWorld(edited);
+		BuildEditWorld(expected);
+		TakeDirtyChunks(edited);
+		TakeDirtyChunks(expected);
+
+		const BlockBox fills[] =
+		{
+			MakeBlockBox(0, 32, 0, 32, 48, 32),      // whole chunks
+			MakeBlockBox(3, 5, 7, 29, 40, 21),       // unaligned, across chunks
+			MakeBlockBox(-5, -3, 40, 10, 60, 60),    // partly outside the world
+			MakeBlockBox(-20, 0, 0, -4, 16, 16),     // wholly outside
+			MakeBlockBox(10, 10, 10, 10, 20, 20),    // empty
+		};
+		BlockType type = BlockType_Emerald;
+		for(const BlockBox& box : fills)
+		{
+			FillBlocks(edited, box, type);
+			SetEachFill(expected, box, type);
+			CheckSameWorld(log, edited, expected);
+			type = type == BlockType_Air ? BlockType_Dirt : BlockType_Air;
+		}
+
+		const BlockBox replaces[] =
+		{
+			MakeBlockBox(1, 14, 2, 47, 30, 45),
+			MakeBlockBox(-8, -8, -8, 56, 56, 56),
+			MakeBlockBox(16, 16, 16, 32, 32, 32),
+		};
+		for(const BlockBox& box : replaces)
+		{
+			ReplaceBlocks(edited, box, BlockType_Stone, BlockType_Grass);
+			SetEachReplace(expected, box, BlockType_Stone, BlockType_Grass);
+			CheckSameWorld(log, edited, expected);
+			ReplaceBlocks(edited, box, BlockType_Air, BlockType_Dirt);
+			SetEachReplace(expected, box, BlockType_Air, BlockType_Dirt);
+			CheckSameWorld(log, edited, expected);
+		}
+
+		struct Clone
+		{
+			BlockBox Source;
+			std::int32_t X, Y, Z;
+		};
+		const Clone clones[] =
+		{
+			{ MakeBlockBox(0, 0, 0, 32, 16, 32), 16, 32, 16 },    // whole chunks, aligned
+			{ MakeBlockBox(2, 2, 2, 30, 30, 30), 5, 3, 1 },       // overlapping, moved up
+			{ MakeBlockBox(5, 3, 1, 33, 31, 29), 2, 2, 2 },       // overlapping, moved down
+			{ MakeBlockBox(20, 10, 20, 47, 40, 47), -7, -2, 3 },  // partly to outside
+			{ MakeBlockBox(-10, -10, -10, 20, 20, 20), 30, 30, 30 }, // partly from outside
+			{ MakeBlockBox(16, 16, 16, 48, 48, 48), 0, 0, 0 },    // aligned, negative offset
+		};
+		for(const Clone& clone : clones)
+		{
+			CloneBlocks(edited, clone.Source, clone.X, clone.Y, clone.Z);
+			SetEachClone(expected, clone.Source, clone.X, clone.Y, clone.Z);
+			CheckSameWorld(log, edited, expected);
+		}
+	}
+
+	//
+	// Chunk codec and region files
+	//
+
+	bool SameBlocks(const WorldChunk& a, const WorldChunk& b)
+	{
+		return std::memcmp(a.Data(), b.Data(), WorldChunk::Dims::Volume) == 0;
+	}
+
+	// Encodes chunk and decodes it again, and checks the codec picked and the blocks.
+	void CheckRoundTrip(CheckLog& log, const WorldChunk& chunk, ChunkCodec expectedCodec)
+	{
+		std::vector<std::uint8_t> encoded;
+		ChunkCodec codec = EncodeChunk(chunk, encoded);
+		BLEND_CHECK(codec == expectedCodec);
+
+		WorldChunk decoded;
+		decoded.Fill(BlockType_Emerald);
+		BLEND_CHECK(DecodeChunk(codec, encoded.data(), encoded.size(), decoded));
+		BLEND_CHECK(SameBlocks(decoded, chunk));
+	}
+
+	// A layered chunk whose runs span the short runs, the long run that needs no more
+	// than one varint byte and those that need two.
+	void FillRunChunk(WorldChunk& chunk)
+	{
+		const std::uint32_t runs[] = { 1, 14, 15, 16, 17, 143, 144, 145, 1000 };
+		std::uint32_t at = 0, next = 0;
+		while(at < WorldChunk::Dims::Volume)
+		{
+			std::uint32_t run = std::min(runs[next % 9], WorldChunk::Dims::Volume - at);
+			std::memset(chunk.Data() + at, 1 + next % (BlockType_Count - 1), run);
+			at += run;
+			next++;
+		}
+	}
+
+	// No block the same as the one before it, so every run is one block long and run
+	// length coding is no smaller than raw.
+	void FillNoise(WorldChunk& chunk, std::uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		BlockType last = BlockType_Air;
+		for(std::uint32_t i = 0; i < WorldChunk::Dims::Volume; ++i)
+		{
+			last = (BlockType)((last + 1 + random() % (BlockType_Count - 1)) % BlockType_Count);
+			chunk[i] = last;
+		}
+	}
+
+	void CheckChunkCodec(CheckLog& log)
+	{
+		const std::uint32_t volume = WorldChunk::Dims::Volume;
+
+		// One run of the whole chunk, three bytes and seen as uniform without decoding.
+		WorldChunk uniform;
+		uniform.Fill(BlockType_Stone);
+		CheckRoundTrip(log, uniform, ChunkCodec_Rle);
+		std::vector<std::uint8_t> encoded;
+		EncodeChunk(uniform, encoded);
+		BlockType uniformType = BlockType_Air;
+		BLEND_CHECK(encoded.size() == 3);
+		BLEND_CHECK(EncodedChunkUniform(ChunkCodec_Rle, encoded.data(), encoded.size(), uniformType) &&
+			uniformType == BlockType_Stone);
+
+		WorldChunk runs;
+		FillRunChunk(runs);
+		CheckRoundTrip(log, runs, ChunkCodec_Rle);
+		BlockType runsType;
+		encoded.clear();
+		EncodeChunk(runs, encoded);
+		BLEND_CHECK(!EncodedChunkUniform(ChunkCodec_Rle, encoded.data(), encoded.size(), runsType));
+
+		// Noise does not shrink and goes out raw.
+		WorldChunk noise;
+		FillNoise(noise, 45);
+		CheckRoundTrip(log, noise, ChunkCodec_Raw);
+
+		// Cut short anywhere, run length coding fails to decode, as does anything after
+		// its last run.
+		encoded.clear();
+		EncodeChunk(runs, encoded);
+		WorldChunk decoded;
+		bool truncatedRejected = true;
+		for(std::size_t size = 0; size < encoded.size(); ++size)
+			truncatedRejected = truncatedRejected && !DecodeChunk(ChunkCodec_Rle, encoded.data(), size, decoded);
+		BLEND_CHECK(truncatedRejected);
+		std::vector<std::uint8_t> longer = encoded;
+		longer.push_back(0x11);
+		BLEND_CHECK(!DecodeChunk(ChunkCodec_Rle, longer.data(), longer.size(), decoded));
+
+		// A run past the end of the chunk, a varint that never ends and a block type that
+		// does not exist.
+		const std::uint8_t overrun[] = { BlockType_Stone, 0xf1, 0x1f, 0x11 };
+		BLEND_CHECK(!DecodeChunk(ChunkCodec_Rle, overrun, sizeof(overrun), decoded));
+		const std::uint8_t endless[] = { BlockType_Stone, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01 };
+		BLEND_CHECK(!DecodeChunk(ChunkCodec_Rle, endless, sizeof(endless), decoded));
+		const std::uint8_t badType[] = { BlockType_Count, 0xf0, 0x1f };
+		BLEND_CHECK(!DecodeChunk(ChunkCodec_Rle, badType, sizeof(badType), decoded));
+		BlockType badUniform;
+		BLEND_CHECK(!EncodedChunkUniform(ChunkCodec_Rle, badType, sizeof(badType), badUniform));
+
+		// Raw blocks have to be a whole chunk of known types.
+		std::vector<std::uint8_t> raw(noise.Data(), noise.Data() + volume);
+		BLEND_CHECK(!DecodeChunk(ChunkCodec_Raw, raw.data(), volume - 1, decoded));
+		raw[volume / 2] = BlockType_Count;
+		BLEND_CHECK(!DecodeChunk(ChunkCodec_Raw, raw.data(), volume, decoded));
+
+		// Mesh payloads are not blocks.
+		BLEND_CHECK(!DecodeChunk(ChunkCodec_Mesh, encoded.data(), encoded.size(), decoded));
+	}
+
+	// Reads chunk lx, lz of region back and checks it decodes to expected.
+	bool ReadsBack(RegionFile& region, std::uint32_t lx, std::uint32_t lz, const WorldChunk& expected)
+	{
+		std::vector<std::uint8_t> buffer;
+		ChunkPayload payload;
+		WorldChunk decoded;
+		return region.ReadChunk(lx, lz, buffer, payload) &&
+			DecodeChunk(payload.Codec, payload.Data, payload.Size, decoded) && SameBlocks(decoded, expected);
+	}
+
+	bool WriteChunkTo(RegionFile& region, std::uint32_t lx, std::uint32_t lz, const WorldChunk& chunk)
+	{
+		std::vector<std::uint8_t> encoded;
+		ChunkCodec codec = EncodeChunk(chunk, encoded);
+		return region.WriteChunk(lx, lz, codec, encoded.data(), encoded.size());
+	}
+
+	// First sector of chunk lx, lz, read from the table in the file.  The region is
+	// closed for it, so its writes reach the file, and opened again after.
+	std::uint32_t StoredOffset(RegionFile& region, const std::string& path, std::uint32_t lx, std::uint32_t lz)
+	{
+		region.Close();
+		std::uint8_t table[RegionSectorBytes] = {};
+		std::FILE* file = OpenBinaryFile(path, "rb");
+		if(file != nullptr)
+		{
+			if(std::fread(table, 1, sizeof(table), file) != sizeof(table))
+				std::memset(table, 0, sizeof(table));
+			std::fclose(file);
+		}
+		region.Open(path, false);
+		return RegionEntryOffset(RegionTableEntry(table, RegionEntryIndex(lx, lz)));
+	}
+
+	void CheckRegionFile(CheckLog& log)
+	{
+		const std::string path = "CheckRegion.region";
+		std::remove(path.c_str());
+
+		// Run length coded chunks take one sector, raw ones two.
+		WorldChunk small, otherSmall, large;
+		small.Fill(BlockType_Stone);
+		otherSmall.Fill(BlockType_Dirt);
+		FillNoise(large, 46);
+
+		RegionFile region;
+		BLEND_CHECK(region.Open(path, true));
+		BLEND_CHECK(WriteChunkTo(region, 0, 0, small));
+		BLEND_CHECK(WriteChunkTo(region, 1, 0, small));
+		BLEND_CHECK(region.SectorCount() == 3 && region.UsedSectors() == 3);
+		std::uint32_t firstA = StoredOffset(region, path, 0, 0), firstB = StoredOffset(region, path, 1, 0);
+		BLEND_CHECK(firstA == 1 && firstB == 2);
+
+		// Rewritten no bigger, a chunk stays in place.
+		BLEND_CHECK(WriteChunkTo(region, 0, 0, otherSmall));
+		BLEND_CHECK(StoredOffset(region, path, 0, 0) == firstA);
+		BLEND_CHECK(ReadsBack(region, 0, 0, otherSmall));
+
+		// Grown past its sectors it moves to the end, as no gap fits it, and frees the
+		// sector it had.
+		BLEND_CHECK(WriteChunkTo(region, 0, 0, large));
+		BLEND_CHECK(StoredOffset(region, path, 0, 0) == 3);
+		BLEND_CHECK(region.SectorCount() == 5 && region.UsedSectors() == 4);
+		BLEND_CHECK(ReadsBack(region, 0, 0, large));
+		BLEND_CHECK(ReadsBack(region, 1, 0, small));
+
+		// A new chunk goes into the freed sector.
+		BLEND_CHECK(WriteChunkTo(region, 2, 0, small));
+		BLEND_CHECK(StoredOffset(region, path, 2, 0) == firstA);
+		BLEND_CHECK(region.SectorCount() == 5 && region.UsedSectors() == 5);
+
+		// Erased chunks read as not stored and their sectors are free again.
+		BLEND_CHECK(region.EraseChunk(1, 0));
+		BLEND_CHECK(!region.HasChunk(1, 0));
+		BLEND_CHECK(region.UsedSectors() == 4);
+
+		// Shrunk, a chunk stays where it is even with a free sector before it, and gives
+		// back the sector it no longer needs.  New chunks take the gap, then that sector.
+		BLEND_CHECK(WriteChunkTo(region, 0, 0, small));
+		BLEND_CHECK(StoredOffset(region, path, 0, 0) == 3);
+		BLEND_CHECK(region.UsedSectors() == 3);
+		BLEND_CHECK(WriteChunkTo(region, 3, 0, otherSmall));
+		BLEND_CHECK(StoredOffset(region, path, 3, 0) == 2);
+		BLEND_CHECK(WriteChunkTo(region, 4, 0, small));
+		BLEND_CHECK(StoredOffset(region, path, 4, 0) == 4);
+		BLEND_CHECK(region.SectorCount() == 5 && region.UsedSectors() == 5);
+		region.Close();
+
+		// Reopened, the chunks are all there.  Then an entry is pointed past the end of
+		// the file, as a crash between writing the table and the sectors would leave it,
+		// and another at the table itself; opening drops both and keeps the rest.
+		BLEND_CHECK(region.Open(path, false));
+		BLEND_CHECK(ReadsBack(region, 0, 0, small) && ReadsBack(region, 2, 0, small) &&
+			ReadsBack(region, 3, 0, otherSmall) && ReadsBack(region, 4, 0, small));
+		BLEND_CHECK(region.UsedSectors() == 5);
+		region.Close();
+
+		std::FILE* file = OpenBinaryFile(path, "r+b");
+		BLEND_CHECK(file != nullptr);
+		if(file != nullptr)
+		{
+			const std::uint32_t entries[2] = { 4u << 8 | 2u, 0u << 8 | 1u };
+			const std::uint32_t indices[2] = { RegionEntryIndex(3, 0), RegionEntryIndex(2, 0) };
+			for(int i = 0; i < 2; ++i)
+			{
+				std::uint8_t bytes[4] = { std::uint8_t(entries[i]), std::uint8_t(entries[i] >> 8),
+					std::uint8_t(entries[i] >> 16), std::uint8_t(entries[i] >> 24) };
+				std::fseek(file, long(indices[i] * 4), SEEK_SET);
+				BLEND_CHECK(std::fwrite(bytes, 1, 4, file) == 4);
+			}
+			std::fclose(file);
+		}
+
+		BLEND_CHECK(region.Open(path, false));
+		BLEND_CHECK(!region.HasChunk(3, 0) && !region.HasChunk(2, 0));
+		BLEND_CHECK(ReadsBack(region, 0, 0, small) && ReadsBack(region, 4, 0, small));
+		BLEND_CHECK(region.UsedSectors() == 3);
+		region.Close();
+
+		// A table cut short does not open.
+		file = OpenBinaryFile(path, "wb");
+		if(file != nullptr)
+		{
+			std::uint8_t half[RegionSectorBytes / 2] = {};
+			std::fwrite(half, 1, sizeof(half), file);
+			std::fclose(file);
+		}
+		BLEND_CHECK(!region.Open(path, false));
+
+		std::remove(path.c_str());
+	}
+
+	//
+	// Saved worlds
+	//
+
+	// Writes a level file as version 2 wrote them, before the generator was recorded.
+	bool WriteOldLevel(const std::string& prefix, const LevelInfo& level)
+	{
+		const std::uint32_t words[6] = { 0x444c5742, 2, level.ChunksX, level.ChunksY, level.ChunksZ, level.Seed };
+		std::FILE* file = OpenBinaryFile(prefix + ".level", "wb");
+		if(file == nullptr)
+			return false;
+		bool written = std::fwrite(words, sizeof(words), 1, file) == 1;
+		return std::fclose(file) == 0 && written;
+	}
+
+	bool LoadsAs(const std::string& prefix, std::uint32_t seed, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz,
+		const WorldChunk& expected)
+	{
+		RegionMapCache regions(prefix, RegionAccess_Random);
+		LoadedChunk chunk;
+		if(!LoadChunk(regions, seed, cx, cy, cz, chunk))
+			return false;
+		if(!chunk.Blocks)
+		{
+			WorldChunk uniform;
+			uniform.Fill(chunk.Uniform);
+			return SameBlocks(uniform, expected);
+		}
+		return SameBlocks(*chunk.Blocks, expected);
+	}
+
+	void CheckWorldFile(CheckLog& log)
+	{
+		const std::string prefix = "CheckWorld";
+		const std::uint32_t seed = 47;
+		DeleteWorld(prefix);
+
+		// A few blocks changed in a generated chunk are stored as a delta, which patches
+		// the generated chunk back into the edited one.  An unchanged chunk is an empty
+		// delta.
+		WorldChunk generated, edited;
+		GenerateTerrainChunk(seed, 0, 0, 0, generated);
+		edited = generated;
+		edited.Set(1, 2, 3, BlockType_Emerald);
+		edited.Set(5, 0, 9, BlockType_Air);
+		edited.Set(WorldChunk::Dims::SizeX - 1, TerrainDepth, 0, BlockType_Stone);
+
+		std::vector<std::uint8_t> encoded;
+		BLEND_CHECK(EncodeChunkDelta(edited, generated, encoded) == ChunkCodec_Delta && !encoded.empty());
+		WorldChunk decoded = generated;
+		BLEND_CHECK(DecodeChunk(ChunkCodec_Delta, encoded.data(), encoded.size(), decoded));
+		BLEND_CHECK(SameBlocks(decoded, edited));
+		encoded.clear();
+		BLEND_CHECK(EncodeChunkDelta(generated, generated, encoded) == ChunkCodec_Delta && encoded.empty());
+
+		// Saved, only the edited chunk is in its region, and both chunks load as they
+		// were.
+		World world;
+		GenerateTerrain(world, (std::int32_t)(2 * WorldChunk::Dims::SizeX), seed);
+		world.Set(1, 2, 3, BlockType_Emerald);
+		world.Set(5, 0, 9, BlockType_Air);
+		world.Set(WorldChunk::Dims::SizeX - 1, TerrainDepth, 0, BlockType_Stone);
+		BLEND_CHECK(SaveWorld(world, prefix, seed));
+
+		RegionFile region;
+		BLEND_CHECK(region.Open(RegionPath(prefix, 0, 0, 0), false));
+		BLEND_CHECK(region.HasChunk(0, 0) && !region.HasChunk(1, 0));
+		region.Close();
+		WorldChunk neighbour;
+		GenerateTerrainChunk(seed, 1, 0, 0, neighbour);
+		BLEND_CHECK(LoadsAs(prefix, seed, 0, 0, 0, edited));
+		BLEND_CHECK(LoadsAs(prefix, seed, 1, 0, 0, neighbour));
+
+		World loaded;
+		BLEND_CHECK(LoadWorld(loaded, prefix));
+		BLEND_CHECK(SameBlocks(loaded.GetChunk(0, 0, 0), edited));
+
+		// Edited back to what it was generated as, the chunk's delta is empty and saving
+		// it erases it from the region.
+		world.Set(1, 2, 3, generated.Get(1, 2, 3));
+		world.Set(5, 0, 9, generated.Get(5, 0, 9));
+		world.Set(WorldChunk::Dims::SizeX - 1, TerrainDepth, 0, generated.Get(WorldChunk::Dims::SizeX - 1, TerrainDepth, 0));
+		BLEND_CHECK(SaveChunk(world, prefix, seed, 0, 0, 0));
+		BLEND_CHECK(region.Open(RegionPath(prefix, 0, 0, 0), false));
+		BLEND_CHECK(!region.HasChunk(0, 0));
+		region.Close();
+		BLEND_CHECK(LoadsAs(prefix, seed, 0, 0, 0, generated));
+
+		// The level records the generator, and a save made against another one does not
+		// load.
+		LevelInfo level;
+		BLEND_CHECK(ReadLevel(prefix, level));
+		BLEND_CHECK(level.ChunksX == 2 && level.ChunksZ == 2 && level.Seed == seed && level.Generator == TerrainVersion);
+		level.Generator = TerrainVersion + 1;
+		BLEND_CHECK(WriteLevel(prefix, level));
+		BLEND_CHECK(!LoadWorld(loaded, prefix));
+
+		// Nor does one from before the generator was recorded, though its level still
+		// reads, so deleting the world finds its regions.
+		BLEND_CHECK(WriteOldLevel(prefix, level));
+		BLEND_CHECK(ReadLevel(prefix, level) && level.Generator == 0 && level.ChunksX == 2);
+		BLEND_CHECK(!LoadWorld(loaded, prefix));
+		DeleteWorld(prefix);
+		BLEND_CHECK(!region.Open(RegionPath(prefix, 0, 0, 0), false));
+		BLEND_CHECK(!ReadLevel(prefix, level));
+	}
+
+	#undef BLEND_CHECK
+}
+
+std::vector<std::string> RunCpuChecks()
+{
+	CheckLog log;
+	CheckRadixSort(log);
+	CheckSortKeys(log);
+	CheckDrawStateCache(log);
+	CheckLinearAllocator(log);
+	CheckUploadArena(log);
+	CheckSplitDrawRanges(log);
+	CheckParallelRecorder(log);
+	CheckBlockCulling(log);
+	CheckSnapshotHash(log);
+	CheckMorton(log);
+	CheckWorldEdits(log);
+	CheckChunkCodec(log);
+	CheckRegionFile(log);
+	CheckWorldFile(log);
+	return std::move(log.Failures());
+}
@@ -0,0 +1,22 @@
+//***************************************************************************************
+// Checks.h
+//
+// Correctness checks for the CPU side kernels whose results are easy to get subtly
+// wrong: the render queue's keys and radix sort, the linear allocator and upload
+// arena, the split of a frame's draws into recording ranges, block culling, the
+// snapshot hash the mesh cache trusts, Morton coding with and without BMI2, the box
+// edits against the same edits made block by block, and the chunk codec, region
+// files and level file of the save.  Like the benchmarks they need neither a device
+// nor a window.
+// BlendHeadless runs them, and so does BlendApp at startup when built with
+// BLEND_BENCHMARKS defined.
+//***************************************************************************************
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Runs every check and returns a message for each one that failed, naming the
+// condition and where it is.  Empty when everything passed.
+std::vector<std::string> RunCpuChecks();
@@ -0,0 +1,190 @@
+//***************************************************************************************
+// Chunk.h
+//
+// Block storage for a box of the world whose size is fixed at compile time.  All the
+// index math is constexpr on the template sizes, so for power of two sizes the
+// compiler turns linearization into shifts, bounds tests into one mask test and can
+// unroll the inner loops.  The same kernels then run on 16x16x16, 32x32x32 or column
+// shaped chunks without being written twice.
+//
+// Blocks are stored row-major by default, or in Morton order for cubic chunks, which
+// keeps the neighbours that meshing, lighting and flood fills visit closer together.
+// Kernels that step between neighbours through Neighbour() run on either.
+//***************************************************************************************
+
+#pragma once
+
+#include "Morton.h"
+
+#include <cstdint>
+#include <cstring>
+
+enum BlockType : std::uint8_t
+{
+	BlockType_Air = 0,
+	BlockType_BedRock,
+	BlockType_Stone,
+	BlockType_Emerald,
+	BlockType_Dirt,
+	BlockType_Grass,
+
+	BlockType_Count
+};
+
+// Whether a block is solid, and whether it stops sky light.  Every block but air does
+// both for now; they are separate so glass, leaves or water can do one and not the
+// other.
+constexpr bool BlockIsSolid(BlockType type) { return type != BlockType_Air; }
+constexpr bool BlockBlocksLight(BlockType type) { return type != BlockType_Air; }
+
+// The six face neighbours of a block.
+enum BlockFace : std::uint32_t
+{
+	BlockFace_PosX = 0,
+	BlockFace_NegX,
+	BlockFace_PosY,
+	BlockFace_NegY,
+	BlockFace_PosZ,
+	BlockFace_NegZ,
+
+	BlockFace_Count
+};
+
+constexpr std::int32_t BlockFaceStepX(BlockFace face) { return face == BlockFace_PosX ? 1 : face == BlockFace_NegX ? -1 : 0; }
+constexpr std::int32_t BlockFaceStepY(BlockFace face) { return face == BlockFace_PosY ? 1 : face == BlockFace_NegY ? -1 : 0; }
+constexpr std::int32_t BlockFaceStepZ(BlockFace face) { return face == BlockFace_PosZ ? 1 : face == BlockFace_NegZ ? -1 : 0; }
+
+constexpr bool IsPowerOfTwo(std::uint32_t value) { return value != 0 && (value & (value - 1)) == 0; }
+
+// Row-major block order: x varies fastest, then z, then y, so each horizontal layer is
+// contiguous.  Works for any size.
+template<std::uint32_t SX, std::uint32_t SY, std::uint32_t SZ>
+struct LinearLayout
+{
+	static constexpr std::uint32_t Index(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+	{
+		return x + SX * (z + SZ * y);
+	}
+
+	static constexpr std::uint32_t X(std::uint32_t index) { return index % SX; }
+	static constexpr std::uint32_t Y(std::uint32_t index) { return index / (SX * SZ); }
+	static constexpr std::uint32_t Z(std::uint32_t index) { return index / SX % SZ; }
+
+	// Index step to the neighbour across face, the same for every block.
+	static constexpr std::int32_t Offset(BlockFace face)
+	{
+		return BlockFaceStepX(face) + std::int32_t(SX) * (BlockFaceStepZ(face) + std::int32_t(SZ) * BlockFaceStepY(face));
+	}
+
+	static constexpr std::uint32_t Neighbour(std::uint32_t index, BlockFace face)
+	{
+		return index + Offset(face);
+	}
+};
+
+// Z-order block order, see Morton.h.  Only for cubes with a power of two side, so the
+// codes fill the block array with no gaps.
+template<std::uint32_t SX, std::uint32_t SY, std::uint32_t SZ>
+struct MortonLayout
+{
+	static_assert(SX == SY && SY == SZ && IsPowerOfTwo(SX) && SX <= 1024,
+		"Morton order needs a cube with a power of two side of at most 1024.");
+
+	static std::uint32_t Index(std::uint32_t x, std::uint32_t y, std::uint32_t z) { return MortonEncode(x, y, z); }
+
+	static std::uint32_t X(std::uint32_t index) { return MortonDecodeX(index); }
+	static std::uint32_t Y(std::uint32_t index) { return MortonDecodeY(index); }
+	static std::uint32_t Z(std::uint32_t index) { return MortonDecodeZ(index); }
+
+	static std::uint32_t Neighbour(std::uint32_t index, BlockFace face)
+	{
+		switch(face)
+		{
+		case BlockFace_PosX: return MortonIncrement(index, MortonMaskX);
+		case BlockFace_NegX: return MortonDecrement(index, MortonMaskX);
+		case BlockFace_PosY: return MortonIncrement(index, MortonMaskY);
+		case BlockFace_NegY: return MortonDecrement(index, MortonMaskY);
+		case BlockFace_PosZ: return MortonIncrement(index, MortonMaskZ);
+		default:             return MortonDecrement(index, MortonMaskZ);
+		}
+	}
+};
+
+// Index math for a chunk of SX x SY x SZ blocks stored in the order of Layout.
+template<std::uint32_t SX, std::uint32_t SY, std::uint32_t SZ,
+	template<std::uint32_t, std::uint32_t, std::uint32_t> class Layout = LinearLayout>
+struct ChunkDims
+{
+	typedef Layout<SX, SY, SZ> Order;
+
+	static const std::uint32_t SizeX = SX;
+	static const std::uint32_t SizeY = SY;
+	static const std::uint32_t SizeZ = SZ;
+	static const std::uint32_t Volume = SX * SY * SZ;
+	static const bool PowerOfTwo = IsPowerOfTwo(SX) && IsPowerOfTwo(SY) && IsPowerOfTwo(SZ);
+
+	static constexpr std::uint32_t Index(std::uint32_t x, std::uint32_t y, std::uint32_t z) { return Order::Index(x, y, z); }
+
+	static constexpr std::uint32_t X(std::uint32_t index) { return Order::X(index); }
+	static constexpr std::uint32_t Y(std::uint32_t index) { return Order::Y(index); }
+	static constexpr std::uint32_t Z(std::uint32_t index) { return Order::Z(index); }
+
+	// Whether x, y, z is inside the chunk.  Signed, so a step off the low edge is caught
+	// too; for power of two sizes that is one mask test for all three axes.
+	static constexpr bool Contains(std::int32_t x, std::int32_t y, std::int32_t z)
+	{
+		return PowerOfTwo ?
+			((x & ~std::int32_t(SX - 1)) | (y & ~std::int32_t(SY - 1)) | (z & ~std::int32_t(SZ - 1))) == 0 :
+			(std::uint32_t)x < SX && (std::uint32_t)y < SY && (std::uint32_t)z < SZ;
+	}
+
+	// Index of the neighbour across face.  Only valid when that neighbour is inside.
+	static constexpr std::uint32_t Neighbour(std::uint32_t index, BlockFace face) { return Order::Neighbour(index, face); }
+};
+
+template<std::uint32_t SX, std::uint32_t SY, std::uint32_t SZ, template<std::uint32_t, std::uint32_t, std::uint32_t> class Layout>
+const std::uint32_t ChunkDims<SX, SY, SZ, Layout>::SizeX;
+template<std::uint32_t SX, std::uint32_t SY, std::uint32_t SZ, template<std::uint32_t, std::uint32_t, std::uint32_t> class Layout>
+const std::uint32_t ChunkDims<SX, SY, SZ, Layout>::SizeY;
+template<std::uint32_t SX, std::uint32_t SY, std::uint32_t SZ, template<std::uint32_t, std::uint32_t, std::uint32_t> class Layout>
+const std::uint32_t ChunkDims<SX, SY, SZ, Layout>::SizeZ;
+template<std::uint32_t SX, std::uint32_t SY, std::uint32_t SZ, template<std::uint32_t, std::uint32_t, std::uint32_t> class Layout>
+const std::uint32_t ChunkDims<SX, SY, SZ, Layout>::Volume;
+
+// One block type per byte, all air to begin with, in the order of Layout.
+template<std::uint32_t SX, std::uint32_t SY, std::uint32_t SZ,
+	template<std::uint32_t, std::uint32_t, std::uint32_t> class Layout = LinearLayout>
+class Chunk
+{
+public:
+	typedef ChunkDims<SX, SY, SZ, Layout> Dims;
+
+	Chunk()
+	{
+		Fill(BlockType_Air);
+	}
+
+	BlockType Get(std::uint32_t x, std::uint32_t y, std::uint32_t z)const { return mBlocks[Dims::Index(x, y, z)]; }
+	void Set(std::uint32_t x, std::uint32_t y, std::uint32_t z, BlockType type) { mBlocks[Dims::Index(x, y, z)] = type; }
+
+	BlockType operator[](std::uint32_t index)const { return mBlocks[index]; }
+	BlockType& operator[](std::uint32_t index) { return mBlocks[index]; }
+
+	void Fill(BlockType type)
+	{
+		std::memset(mBlocks, type, sizeof(mBlocks));
+	}
+
+	// Every block equals the first exactly when the blocks equal themselves shifted
+	// by one.
+	bool IsUniform()const
+	{
+		return std::memcmp(mBlocks, mBlocks + 1, Dims::Volume - 1) == 0;
+	}
+
+	const BlockType* Data()const { return mBlocks; }
+	BlockType* Data() { return mBlocks; }
+
+private:
+	BlockType mBlocks[Dims::Volume];
+};
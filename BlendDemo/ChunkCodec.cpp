@@ -0,0 +1,232 @@
+//***************************************************************************************
+// ChunkCodec.cpp
+//***************************************************************************************
+
+#include "ChunkCodec.h"
+
+#include <cstring>
+
+namespace
+{
+	// Each run starts with a token byte: the block type in the low four bits and the run
+	// length, 1 to 15, in the high four.  A length of zero means a longer run, whose
+	// length less 16 follows as a little-endian base 128 varint.  A delta is a list of
+	// runs, each after a varint count of the unchanged blocks before it.
+	static_assert(BlockType_Count <= 16, "Block types must fit the low four bits of a run token.");
+
+	const std::uint32_t ShortRunMax = 15;
+	const std::uint32_t LongRunMin = ShortRunMax + 1;
+
+	void WriteVarint(std::vector<std::uint8_t>& out, std::uint32_t value)
+	{
+		while(value >= 0x80)
+		{
+			out.push_back(std::uint8_t(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(std::uint8_t(value));
+	}
+
+	bool ReadVarint(const std::uint8_t* data, std::size_t size, std::size_t& at, std::uint32_t& value)
+	{
+		value = 0;
+		for(std::uint32_t shift = 0; ; shift += 7)
+		{
+			if(at >= size || shift > 28)
+				return false;
+
+			std::uint8_t byte = data[at++];
+			value |= std::uint32_t(byte & 0x7f) << shift;
+			if((byte & 0x80) == 0)
+				return true;
+		}
+	}
+
+	void WriteRun(std::vector<std::uint8_t>& out, BlockType type, std::uint32_t run)
+	{
+		if(run <= ShortRunMax)
+		{
+			out.push_back(std::uint8_t(type | (run << 4)));
+			return;
+		}
+
+		out.push_back(std::uint8_t(type));
+		WriteVarint(out, run - LongRunMin);
+	}
+
+	// Reads the run at data[at], moving at past it.  Returns false when the data ends
+	// early or the run is malformed.
+	bool ReadRun(const std::uint8_t* data, std::size_t size, std::size_t& at, BlockType& type, std::uint32_t& run)
+	{
+		if(at >= size)
+			return false;
+
+		std::uint8_t token = data[at++];
+		type = BlockType(token & 0x0f);
+		if(type >= BlockType_Count)
+			return false;
+
+		run = token >> 4;
+		if(run != 0)
+			return true;
+
+		std::uint32_t rest;
+		if(!ReadVarint(data, size, at, rest))
+			return false;
+
+		run = rest + LongRunMin;
+		return true;
+	}
+}
+
+ChunkCodec EncodeChunk(const WorldChunk& chunk, std::vector<std::uint8_t>& out)
+{
+	const std::uint32_t volume = WorldChunk::Dims::Volume;
+	const BlockType* blocks = chunk.Data();
+	const std::size_t start = out.size();
+
+	std::uint32_t at = 0;
+	while(at < volume)
+	{
+		BlockType type = blocks[at];
+		std::uint32_t end = at + 1;
+		while(end < volume && blocks[end] == type)
+			++end;
+
+		WriteRun(out, type, end - at);
+		at = end;
+
+		// Noise that will not compress goes out raw.
+		if(out.size() - start >= volume)
+			break;
+	}
+
+	if(out.size() - start < volume)
+		return ChunkCodec_Rle;
+
+	out.resize(start);
+	out.insert(out.end(), blocks, blocks + volume);
+	return ChunkCodec_Raw;
+}
+
+ChunkCodec EncodeChunkDelta(const WorldChunk& chunk, const WorldChunk& base, std::vector<std::uint8_t>& out)
+{
+	const std::uint32_t volume = WorldChunk::Dims::Volume;
+	const BlockType* blocks = chunk.Data();
+	const BlockType* baseBlocks = base.Data();
+	const std::size_t start = out.size();
+
+	// The delta has to beat the chunk's own encoding, so that is made first and the
+	// delta given up as soon as it is as long.
+	ChunkCodec whole = EncodeChunk(chunk, out);
+	const std::size_t limit = out.size() - start;
+	const std::size_t deltaStart = out.size();
+
+	std::uint32_t at = 0;
+	std::uint32_t unchangedFrom = 0;
+	while(at < volume && out.size() - deltaStart < limit)
+	{
+		if(blocks[at] == baseBlocks[at])
+		{
+			++at;
+			continue;
+		}
+
+		BlockType type = blocks[at];
+		std::uint32_t end = at + 1;
+		while(end < volume && blocks[end] == type && baseBlocks[end] != type)
+			++end;
+
+		WriteVarint(out, at - unchangedFrom);
+		WriteRun(out, type, end - at);
+		at = end;
+		unchangedFrom = end;
+	}
+
+	if(at < volume || out.size() - deltaStart >= limit)
+	{
+		out.resize(deltaStart);
+		return whole;
+	}
+
+	out.erase(out.begin() + start, out.begin() + deltaStart);
+	return ChunkCodec_Delta;
+}
+
+bool DecodeChunk(ChunkCodec codec, const std::uint8_t* data, std::size_t size, WorldChunk& chunk)
+{
+	const std::uint32_t volume = WorldChunk::Dims::Volume;
+	BlockType* blocks = chunk.Data();
+
+	if(codec == ChunkCodec_Raw)
+	{
+		if(size != volume)
+			return false;
+
+		for(std::uint32_t i = 0; i < volume; ++i)
+		{
+			if(data[i] >= BlockType_Count)
+				return false;
+		}
+
+		std::memcpy(blocks, data, volume);
+		return true;
+	}
+
+	if(codec == ChunkCodec_Delta)
+	{
+		std::size_t at = 0;
+		std::uint32_t filled = 0;
+		while(at < size)
+		{
+			std::uint32_t unchanged;
+			BlockType type;
+			std::uint32_t run;
+			if(!ReadVarint(data, size, at, unchanged) || unchanged > volume - filled)
+				return false;
+			filled += unchanged;
+			if(!ReadRun(data, size, at, type, run) || run > volume - filled)
+				return false;
+
+			std::memset(blocks + filled, type, run);
+			filled += run;
+		}
+		return true;
+	}
+
+	if(codec != ChunkCodec_Rle)
+		return false;
+
+	std::size_t at = 0;
+	std::uint32_t filled = 0;
+	while(filled < volume)
+	{
+		BlockType type;
+		std::uint32_t run;
+		if(!ReadRun(data, size, at, type, run) || run > volume - filled)
+			return false;
+
+		std::memset(blocks + filled, type, run);
+		filled += run;
+	}
+
+	return at == size;
+}
+
+bool EncodedChunkUniform(ChunkCodec codec, const std::uint8_t* data, std::size_t size, BlockType& type)
+{
+	const std::uint32_t volume = WorldChunk::Dims::Volume;
+
+	if(codec == ChunkCodec_Raw)
+	{
+		if(size != volume || data[0] >= BlockType_Count)
+			return false;
+
+		type = BlockType(data[0]);
+		return std::memcmp(data, data + 1, volume - 1) == 0;
+	}
+
+	std::size_t at = 0;
+	std::uint32_t run;
+	return codec == ChunkCodec_Rle && ReadRun(data, size, at, type, run) && run == volume && at == size;
+}
@@ -0,0 +1,53 @@
+//***************************************************************************************
+// ChunkCodec.h
+//
+// Compression of chunk blocks for saving.  Chunks hold a handful of block types in
+// long runs: whole layers of stone, air above the ground, a few scattered ores.  The
+// codec is a run-length code over the block order with the type and a short run in
+// one byte, so a uniform chunk is three bytes, a layered one a few dozen, and decoding
+// is a memset per run.  Chunks too noisy to shrink are stored raw.
+//
+// A chunk that can be made again, such as generated terrain, can instead be coded as a
+// delta against what it was made from: only the runs of blocks that differ, each
+// after the count of blocks it skips.  A few edits to a chunk cost a few bytes.
+//***************************************************************************************
+
+#pragma once
+
+#include "World.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum ChunkCodec : std::uint8_t
+{
+	ChunkCodec_Raw = 0,
+	ChunkCodec_Rle,
+	ChunkCodec_Delta,
+
+	// Not blocks but a chunk's cached mesh, found only in the mesh cache's regions; see
+	// MeshCache.h.  The functions here reject it.
+	ChunkCodec_Mesh,
+
+	ChunkCodec_Count
+};
+
+// Appends chunk to out, run-length coded, or raw when that is no bigger.  Returns the
+// codec used.
+ChunkCodec EncodeChunk(const WorldChunk& chunk, std::vector<std::uint8_t>& out);
+
+// Appends the blocks of chunk that differ from base to out as a delta, or chunk whole
+// as EncodeChunk does when the delta would be no smaller.  Returns the codec used.  An
+// empty delta means chunk equals base.
+ChunkCodec EncodeChunkDelta(const WorldChunk& chunk, const WorldChunk& base, std::vector<std::uint8_t>& out);
+
+// Decodes size bytes written by EncodeChunk or EncodeChunkDelta with codec into chunk.
+// A delta is applied to chunk as it is, which must hold the blocks of its base.
+// Returns false, with chunk in an unspecified state, when the data is corrupt.
+bool DecodeChunk(ChunkCodec codec, const std::uint8_t* data, std::size_t size, WorldChunk& chunk);
+
+// Whether size bytes of encoded data hold a chunk of one block type, and which, so
+// loading can point the chunk at the world's shared chunk without decoding it.  Always
+// false for a delta.
+bool EncodedChunkUniform(ChunkCodec codec, const std::uint8_t* data, std::size_t size, BlockType& type);
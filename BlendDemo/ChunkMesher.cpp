@@ -0,0 +1,191 @@
+//***************************************************************************************
+// ChunkMesher.cpp
+//***************************************************************************************
+
+#include "ChunkMesher.h"
+#include "MeshCache.h"
+
+#include <cassert>
+
+namespace
+{
+	typedef WorldChunk::Dims Dims;
+	typedef PaddedChunkDims Padded;
+}
+
+void MeshChunkCells(const ChunkSnapshot& snapshot, std::vector<MeshCell>& out)
+{
+	// Every interior block of the snapshot has all six neighbours in the buffer, so
+	// the neighbours are fixed offsets with no bounds tests.
+	const std::int32_t stepX = (std::int32_t)(Padded::Index(1, 0, 0) - Padded::Index(0, 0, 0));
+	const std::int32_t stepY = (std::int32_t)(Padded::Index(0, 1, 0) - Padded::Index(0, 0, 0));
+	const std::int32_t stepZ = (std::int32_t)(Padded::Index(0, 0, 1) - Padded::Index(0, 0, 0));
+
+	const BlockType* blocks = snapshot.Blocks;
+	for(std::uint32_t y = 0; y < Dims::SizeY; ++y)
+	{
+		for(std::uint32_t z = 0; z < Dims::SizeZ; ++z)
+		{
+			const BlockType* row = blocks + Padded::Index(1, y + 1, z + 1);
+			for(std::uint32_t x = 0; x < Dims::SizeX; ++x)
+			{
+				const BlockType* block = row + x;
+				if(*block == BlockType_Air)
+					continue;
+
+				bool exposed =
+					(block[-stepX] == BlockType_Air) | (block[stepX] == BlockType_Air) |
+					(block[-stepY] == BlockType_Air) | (block[stepY] == BlockType_Air) |
+					(block[-stepZ] == BlockType_Air) | (block[stepZ] == BlockType_Air);
+
+				if(exposed)
+					out.push_back(MakeMeshCell(x, y, z, *block));
+			}
+		}
+	}
+}
+
+void ExpandMeshCells(const MeshCell* cells, std::size_t count, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz,
+	const float origin[3], const std::uint32_t blockIds[BlockType_Count], BlockInstanceList& out)
+{
+	const float baseX = origin[0] + (float)(cx * Dims::SizeX);
+	const float baseY = origin[1] + (float)(cy * Dims::SizeY);
+	const float baseZ = origin[2] + (float)(cz * Dims::SizeZ);
+
+	// Sized once and written through pointers rather than four push_backs a cell.
+	std::size_t first = out.Size();
+	out.X.resize(first + count);
+	out.Y.resize(first + count);
+	out.Z.resize(first + count);
+	out.BlockAndFlags.resize(first + count);
+
+	float* x = out.X.data() + first;
+	float* y = out.Y.data() + first;
+	float* z = out.Z.data() + first;
+	std::uint32_t* blockAndFlags = out.BlockAndFlags.data() + first;
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		MeshCell cell = cells[i];
+		x[i] = baseX + (float)(cell & 0xf);
+		y[i] = baseY + (float)(cell >> 8 & 0xf);
+		z[i] = baseZ + (float)(cell >> 4 & 0xf);
+		blockAndFlags[i] = PackBlockAndFlags(blockIds[cell >> 12], BlockInstanceFlag_None);
+	}
+}
+
+void MeshChunk(const ChunkSnapshot& snapshot, const float origin[3], const std::uint32_t blockIds[BlockType_Count],
+	BlockInstanceList& out)
+{
+	thread_local std::vector<MeshCell> cells;
+	cells.clear();
+	MeshChunkCells(snapshot, cells);
+	ExpandMeshCells(cells.data(), cells.size(), snapshot.ChunkX, snapshot.ChunkY, snapshot.ChunkZ, origin, blockIds, out);
+}
+
+std::size_t WorldMesh::Update(World& world, const float origin[3], const std::uint32_t blockIds[BlockType_Count],
+	std::vector<ChunkCoord>* meshed)
+{
+	std::size_t chunkCount = (std::size_t)world.ChunksX() * world.ChunksY() * world.ChunksZ();
+	if(mChunks.size() != chunkCount || mChunksX != world.ChunksX() || mChunksZ != world.ChunksZ())
+	{
+		// A resized world starts out all dirty, so every chunk is meshed below.
+		mChunks.assign(chunkCount, BlockInstanceList());
+		mShown.assign(chunkCount, false);
+		mChunksX = world.ChunksX();
+		mChunksZ = world.ChunksZ();
+	}
+
+	std::size_t count = 0;
+	ChunkSnapshot& snapshot = ThreadChunkSnapshot();
+	world.FlushDirtyChunks([&](std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)
+	{
+		ChunkCoord chunk = { cx, cy, cz };
+		std::size_t index = ChunkIndex(chunk);
+		BlockInstanceList& mesh = mChunks[index];
+		mesh.Clear();
+
+		TakeChunkSnapshot(world, cx, cy, cz, snapshot);
+		if(mCache != nullptr)
+		{
+			std::uint64_t hash = HashChunkSnapshot(snapshot);
+			if(!mCache->Find(chunk, hash, mCells))
+			{
+				MeshChunkCells(snapshot, mCells);
+				mCache->Store(chunk, hash, mCells);
+			}
+			ExpandMeshCells(mCells.data(), mCells.size(), cx, cy, cz, origin, blockIds, mesh);
+		}
+		else
+		{
+			MeshChunk(snapshot, origin, blockIds, mesh);
+		}
+		mShown[index] = true;
+		if(meshed != nullptr)
+			meshed->push_back(chunk);
+		count++;
+	});
+	return count;
+}
+
+void WorldMesh::Gather(BlockInstanceList& out)const
+{
+	std::size_t count = 0;
+	for(std::size_t i = 0; i < mChunks.size(); ++i)
+	{
+		if(mShown[i])
+			count += mChunks[i].Size();
+	}
+
+	out.Clear();
+	out.Reserve(count);
+	for(std::size_t i = 0; i < mChunks.size(); ++i)
+	{
+		if(!mShown[i])
+			continue;
+
+		const BlockInstanceList& mesh = mChunks[i];
+		out.X.insert(out.X.end(), mesh.X.begin(), mesh.X.end());
+		out.Y.insert(out.Y.end(), mesh.Y.begin(), mesh.Y.end());
+		out.Z.insert(out.Z.end(), mesh.Z.begin(), mesh.Z.end());
+		out.BlockAndFlags.insert(out.BlockAndFlags.end(), mesh.BlockAndFlags.begin(), mesh.BlockAndFlags.end());
+	}
+}
+
+void WorldMesh::Show(const ChunkCoord& chunk, bool shown)
+{
+	mShown[ChunkIndex(chunk)] = shown;
+}
+
+void WorldMesh::Drop(const ChunkCoord& chunk)
+{
+	std::size_t index = ChunkIndex(chunk);
+	mChunks[index].Release();
+	mShown[index] = false;
+}
+
+std::size_t WorldMesh::ChunkIndex(const ChunkCoord& chunk)const
+{
+	assert(chunk.X < mChunksX && chunk.Z < mChunksZ);
+	std::size_t index = chunk.X + (std::size_t)mChunksX * (chunk.Z + (std::size_t)mChunksZ * chunk.Y);
+	assert(index < mChunks.size());
+	return index;
+}
+
+void MeshWorld(const World& world, const float origin[3], const std::uint32_t blockIds[BlockType_Count],
+	BlockInstanceList& out)
+{
+	out.Clear();
+
+	ChunkSnapshot& snapshot = ThreadChunkSnapshot();
+	for(std::uint32_t cy = 0; cy < world.ChunksY(); ++cy)
+	{
+		for(std::uint32_t cz = 0; cz < world.ChunksZ(); ++cz)
+		{
+			for(std::uint32_t cx = 0; cx < world.ChunksX(); ++cx)
+			{
+				TakeChunkSnapshot(world, cx, cy, cz, snapshot);
+				MeshChunk(snapshot, origin, blockIds, out);
+			}
+		}
+	}
+}
@@ -0,0 +1,93 @@
+//***************************************************************************************
+// ChunkMesher.h
+//
+// Turns a chunk snapshot into the block instances the terrain layer draws: one
+// instance per solid block with at least one face against air.  Blocks buried on every
+// side can never be seen, so they are left out.
+//***************************************************************************************
+
+#pragma once
+
+#include "ChunkSnapshot.h"
+#include "BlockInstances.h"
+
+// Bumped whenever the mesher's output, or the snapshot hash a cached mesh is found by,
+// changes, so cached meshes made by an older one are not used.
+const std::uint32_t MesherVersion = 2;
+
+// An exposed block in a chunk's own coordinates: x in bits 0-3, z in bits 4-7, y in
+// bits 8-11 and the block type in bits 12-15.  The chunk's place in the world and the
+// block ids are applied when cells are expanded into instances, so cells can be cached
+// and reused whatever those are.
+typedef std::uint16_t MeshCell;
+
+static_assert(WorldChunk::Dims::SizeX == 16 && WorldChunk::Dims::SizeY == 16 && WorldChunk::Dims::SizeZ == 16,
+	"Mesh cells hold four bits per axis.");
+static_assert(BlockType_Count <= 16, "Mesh cells hold four bits of block type.");
+
+inline MeshCell MakeMeshCell(std::uint32_t x, std::uint32_t y, std::uint32_t z, BlockType type)
+{
+	return MeshCell(x | z << 4 | y << 8 | std::uint32_t(type) << 12);
+}
+
+// Appends a cell for every exposed block of snapshot to out, y slowest and x fastest.
+void MeshChunkCells(const ChunkSnapshot& snapshot, std::vector<MeshCell>& out);
+
+// Adds an instance to out for each of count cells of chunk cx, cy, cz, placed and
+// given block ids as MeshChunk does.
+void ExpandMeshCells(const MeshCell* cells, std::size_t count, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz,
+	const float origin[3], const std::uint32_t blockIds[BlockType_Count], BlockInstanceList& out);
+
+// Adds an instance for every exposed block of snapshot to out.  An instance's position
+// is the block's world block coordinates plus origin, and its block id is
+// blockIds[type].
+void MeshChunk(const ChunkSnapshot& snapshot, const float origin[3], const std::uint32_t blockIds[BlockType_Count],
+	BlockInstanceList& out);
+
+// Snapshots and meshes every chunk of world into out, which is cleared first.
+void MeshWorld(const World& world, const float origin[3], const std::uint32_t blockIds[BlockType_Count],
+	BlockInstanceList& out);
+
+class MeshCache;
+
+// The mesh of every chunk of a world, kept per chunk so that after an edit only the
+// chunks the world marked dirty are meshed again.  A chunk can be hidden, leaving it
+// out of the gathered instances while keeping its mesh, or dropped, freeing the mesh
+// until the chunk is next dirty.  With a MeshCache, chunks whose snapshot the cache
+// has a mesh for are not meshed at all.
+class WorldMesh
+{
+public:
+	// Reads and writes meshes through cache, which has to stay alive while it is set, or
+	// through none when it is null.
+	void SetCache(MeshCache* cache) { mCache = cache; }
+
+	// Meshes the world's dirty chunks, flushing them and showing them again, and returns
+	// how many there were.  Appends their coordinates to meshed when it is given.
+	std::size_t Update(World& world, const float origin[3], const std::uint32_t blockIds[BlockType_Count],
+		std::vector<ChunkCoord>* meshed = nullptr);
+
+	// Every shown chunk's instances, one chunk after another, into out, which is cleared
+	// first.
+	void Gather(BlockInstanceList& out)const;
+
+	void Show(const ChunkCoord& chunk, bool shown);
+	bool IsShown(const ChunkCoord& chunk)const { return mShown[ChunkIndex(chunk)]; }
+
+	// Frees the chunk's instances and hides it.
+	void Drop(const ChunkCoord& chunk);
+
+	const BlockInstanceList& ChunkMesh(const ChunkCoord& chunk)const { return mChunks[ChunkIndex(chunk)]; }
+
+private:
+	std::size_t ChunkIndex(const ChunkCoord& chunk)const;
+
+	// Indexed like the world's chunks.
+	std::vector<BlockInstanceList> mChunks;
+	std::vector<bool> mShown;
+	std::uint32_t mChunksX = 0;
+	std::uint32_t mChunksZ = 0;
+
+	MeshCache* mCache = nullptr;
+	std::vector<MeshCell> mCells;
+};
@@ -0,0 +1,158 @@
+//***************************************************************************************
+// ChunkResidency.cpp
+//***************************************************************************************
+
+#include "ChunkResidency.h"
+
+#include <algorithm>
+#include <cassert>
+
+std::size_t ResidencyStats::TotalBytes()const
+{
+	std::size_t total = 0;
+	for(std::uint32_t tier = 0; tier < ResidencyTier_Count; ++tier)
+		total += Bytes[tier];
+	return total;
+}
+
+float ResidencyStats::HitRate(ResidencyTier tier)const
+{
+	std::uint64_t uses = Hits[tier] + Misses[tier];
+	return uses > 0 ? (float)Hits[tier] / (float)uses : 1.0f;
+}
+
+ChunkResidency::ChunkResidency(std::uint32_t chunksX, std::uint32_t chunksY, std::uint32_t chunksZ, std::size_t budget) :
+	mChunksX(chunksX),
+	mChunksY(chunksY),
+	mChunksZ(chunksZ),
+	mBudget(budget),
+	mSlots((std::size_t)chunksX * chunksY * chunksZ)
+{
+}
+
+void ChunkResidency::Hold(const ChunkCoord& chunk, ResidencyTier tier, std::size_t bytes)
+{
+	Slot& slot = mSlots[ChunkIndex(chunk)];
+	mStats.Bytes[tier] -= slot.Bytes[tier];
+	mStats.Bytes[tier] += bytes;
+	slot.Bytes[tier] = bytes;
+	slot.Held |= 1 << tier;
+}
+
+void ChunkResidency::Release(const ChunkCoord& chunk, ResidencyTier tier)
+{
+	Slot& slot = mSlots[ChunkIndex(chunk)];
+	mStats.Bytes[tier] -= slot.Bytes[tier];
+	slot.Bytes[tier] = 0;
+	slot.Held &= ~(1 << tier);
+}
+
+bool ChunkResidency::Holds(const ChunkCoord& chunk, ResidencyTier tier)const
+{
+	return (mSlots[ChunkIndex(chunk)].Held & (1 << tier)) != 0;
+}
+
+void ChunkResidency::BeginFrame()
+{
+	++mFrame;
+}
+
+void ChunkResidency::Pin(const float centre[3], float radius)
+{
+	ForEachChunkInSphere(centre, radius, mChunksX, mChunksY, mChunksZ, [&](const ChunkCoord& chunk)
+	{
+		mSlots[ChunkIndex(chunk)].PinnedIn = mFrame;
+	});
+}
+
+void ChunkResidency::Use(const float eye[3], float radius, std::vector<ChunkCoord>& missing)
+{
+	const std::uint8_t allTiers = (1 << ResidencyTier_Count) - 1;
+	ForEachChunkInSphere(eye, radius, mChunksX, mChunksY, mChunksZ, [&](const ChunkCoord& chunk)
+	{
+		Slot& slot = mSlots[ChunkIndex(chunk)];
+		if(slot.LastUse == 0 || slot.LastUse + 1 < mFrame)
+		{
+			for(std::uint32_t tier = 0; tier < ResidencyTier_Count; ++tier)
+			{
+				if(slot.Held & (1 << tier))
+					mStats.Hits[tier]++;
+				else
+					mStats.Misses[tier]++;
+			}
+		}
+
+		slot.LastUse = mFrame;
+		if(slot.Held != allTiers)
+			missing.push_back(chunk);
+	});
+}
+
+std::size_t ChunkResidency::Evict(std::vector<ResidencyEviction>& evicted)
+{
+	std::size_t total = mStats.TotalBytes();
+	for(std::uint32_t tier = 0; tier < ResidencyTier_Count && total > mBudget; ++tier)
+	{
+		// Giving up a tier gives up the ones below it, so a candidate frees all of them.
+		// Those that would free nothing are left alone rather than loaded again later
+		// for no gain.
+		mCandidates.clear();
+		for(std::size_t i = 0; i < mSlots.size(); ++i)
+		{
+			const Slot& slot = mSlots[i];
+			if(!(slot.Held & (1 << tier)) || slot.LastUse == mFrame || slot.PinnedIn == mFrame)
+				continue;
+
+			std::size_t bytes = 0;
+			for(std::uint32_t below = 0; below <= tier; ++below)
+				bytes += slot.Bytes[below];
+			if(bytes > 0)
+				mCandidates.push_back((std::uint32_t)i);
+		}
+
+		std::sort(mCandidates.begin(), mCandidates.end(), [this](std::uint32_t a, std::uint32_t b)
+		{
+			return mSlots[a].LastUse < mSlots[b].LastUse || (mSlots[a].LastUse == mSlots[b].LastUse && a < b);
+		});
+
+		for(std::uint32_t index : mCandidates)
+		{
+			if(total <= mBudget)
+				break;
+
+			ChunkCoord chunk = ChunkAt(index);
+			for(std::uint32_t below = 0; below <= tier; ++below)
+			{
+				if(!(mSlots[index].Held & (1 << below)))
+					continue;
+
+				total -= mSlots[index].Bytes[below];
+				Release(chunk, (ResidencyTier)below);
+				mStats.Evictions[below]++;
+				evicted.push_back({ chunk, (ResidencyTier)below });
+			}
+		}
+	}
+
+	return total > mBudget ? total - mBudget : 0;
+}
+
+void ChunkResidency::EndFrame()
+{
+	mStats.PeakBytes = std::max(mStats.PeakBytes, mStats.TotalBytes());
+}
+
+std::size_t ChunkResidency::ChunkIndex(const ChunkCoord& chunk)const
+{
+	assert(chunk.X < mChunksX && chunk.Y < mChunksY && chunk.Z < mChunksZ);
+	return chunk.X + (std::size_t)mChunksX * (chunk.Z + (std::size_t)mChunksZ * chunk.Y);
+}
+
+ChunkCoord ChunkResidency::ChunkAt(std::size_t index)const
+{
+	ChunkCoord chunk;
+	chunk.X = (std::uint32_t)(index % mChunksX);
+	chunk.Z = (std::uint32_t)(index / mChunksX % mChunksZ);
+	chunk.Y = (std::uint32_t)(index / ((std::size_t)mChunksX * mChunksZ));
+	return chunk;
+}
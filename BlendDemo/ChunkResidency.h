@@ -0,0 +1,128 @@
+//***************************************************************************************
+// ChunkResidency.h
+//
+// Keeps what a long session holds for its chunks under a memory budget.  A chunk
+// costs memory in three tiers: its instances in the terrain layer the GPU draws, the
+// mesh on the CPU they are gathered from, and its blocks.  The caller reports what
+// each chunk holds as it loads and meshes them, and every frame marks the chunks in
+// use around the camera and pins those near the player.  When the total is over
+// budget, the least recently used chunks that are neither in use nor pinned give up
+// their GPU mesh first, then their CPU mesh, and only then their blocks, which the
+// caller writes back to disk when they were changed.
+//
+// The chunks are ordered by the frame they were last in use, a true LRU order, and
+// the candidates are only sorted on frames that are over budget.
+//***************************************************************************************
+
+#pragma once
+
+#include "World.h"
+
+#include <cstdint>
+#include <vector>
+
+enum ResidencyTier : std::uint32_t
+{
+	// The chunk's instances in the terrain layer, packed into every frame's upload.
+	ResidencyTier_GpuMesh = 0,
+
+	// The chunk's meshed instances, kept to gather the terrain layer from.
+	ResidencyTier_CpuMesh,
+
+	// The chunk's blocks, and anything the caller built from them that goes with them.
+	ResidencyTier_Blocks,
+
+	ResidencyTier_Count
+};
+
+struct ResidencyStats
+{
+	// A chunk coming back into use is a hit for every tier it still holds and a miss
+	// for the rest, which have to be loaded or meshed again.
+	std::uint64_t Hits[ResidencyTier_Count] = {};
+	std::uint64_t Misses[ResidencyTier_Count] = {};
+
+	std::uint64_t Evictions[ResidencyTier_Count] = {};
+
+	// What the chunks hold now, and the most they held at the end of a frame.
+	std::size_t Bytes[ResidencyTier_Count] = {};
+	std::size_t PeakBytes = 0;
+
+	std::size_t TotalBytes()const;
+
+	// Hits over hits and misses, or 1 before any chunk was used.
+	float HitRate(ResidencyTier tier)const;
+};
+
+// One tier of one chunk to give up, as chosen by ChunkResidency::Evict.
+struct ResidencyEviction
+{
+	ChunkCoord Chunk;
+	ResidencyTier Tier;
+};
+
+class ChunkResidency
+{
+public:
+	ChunkResidency() = default;
+	ChunkResidency(std::uint32_t chunksX, std::uint32_t chunksY, std::uint32_t chunksZ, std::size_t budget);
+
+	std::size_t Budget()const { return mBudget; }
+	void SetBudget(std::size_t bytes) { mBudget = bytes; }
+
+	// Records that chunk holds bytes in tier, replacing what it held there before.  A
+	// chunk can hold a tier at no cost, such as the mesh of a chunk of air.
+	void Hold(const ChunkCoord& chunk, ResidencyTier tier, std::size_t bytes);
+	void Release(const ChunkCoord& chunk, ResidencyTier tier);
+	bool Holds(const ChunkCoord& chunk, ResidencyTier tier)const;
+
+	// Starts a frame.  Chunks pinned in the last frame are pinned no longer.
+	void BeginFrame();
+
+	// Keeps the chunks within radius blocks of centre from being evicted this frame.
+	void Pin(const float centre[3], float radius);
+
+	// Marks the chunks within radius blocks of eye in use this frame, counting hits and
+	// misses for those that were not in use the frame before, and appends to missing
+	// every chunk in use that does not hold all three tiers.
+	void Use(const float eye[3], float radius, std::vector<ChunkCoord>& missing);
+
+	// When over budget, releases tiers of chunks neither in use this frame nor pinned
+	// until it is not, and appends them to evicted in the order to give them up: a
+	// chunk's lower tiers always come before a higher one, as a mesh is no use without
+	// what it was made from.  Returns how many bytes are still over budget.
+	std::size_t Evict(std::vector<ResidencyEviction>& evicted);
+
+	// Ends the frame, recording the peak.
+	void EndFrame();
+
+	const ResidencyStats& Stats()const { return mStats; }
+
+private:
+	struct Slot
+	{
+		std::size_t Bytes[ResidencyTier_Count] = {};
+		std::uint64_t LastUse = 0;
+		std::uint64_t PinnedIn = 0;
+		std::uint8_t Held = 0;
+	};
+
+	std::size_t ChunkIndex(const ChunkCoord& chunk)const;
+	ChunkCoord ChunkAt(std::size_t index)const;
+
+	std::uint32_t mChunksX = 0;
+	std::uint32_t mChunksY = 0;
+	std::uint32_t mChunksZ = 0;
+	std::size_t mBudget = 0;
+
+	// Frames count from one, so a LastUse or PinnedIn of zero is never the current frame.
+	std::uint64_t mFrame = 0;
+
+	// Indexed like the world's chunks.
+	std::vector<Slot> mSlots;
+
+	ResidencyStats mStats;
+
+	// Kept to save an allocation every frame that is over budget.
+	std::vector<std::uint32_t> mCandidates;
+};
@@ -0,0 +1,86 @@
+//***************************************************************************************
+// ChunkSnapshot.cpp
+//***************************************************************************************
+
+#include "ChunkSnapshot.h"
+
+#include <cstring>
+
+namespace
+{
+	typedef WorldChunk::Dims Dims;
+	typedef PaddedChunkDims Padded;
+
+	static_assert(Dims::Index(1, 0, 0) == 1 && Padded::Index(1, 0, 0) == 1,
+		"Snapshots copy whole rows, so x has to be contiguous in both layouts.");
+}
+
+void TakeChunkSnapshot(const World& world, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, ChunkSnapshot& snapshot)
+{
+	snapshot.ChunkX = cx;
+	snapshot.ChunkY = cy;
+	snapshot.ChunkZ = cz;
+
+	const std::int32_t baseX = (std::int32_t)(cx * Dims::SizeX);
+	const std::int32_t baseY = (std::int32_t)(cy * Dims::SizeY);
+	const std::int32_t baseZ = (std::int32_t)(cz * Dims::SizeZ);
+
+	for(std::uint32_t py = 0; py < Padded::SizeY; ++py)
+	{
+		std::int32_t y = baseY + (std::int32_t)py - 1;
+		for(std::uint32_t pz = 0; pz < Padded::SizeZ; ++pz)
+		{
+			std::int32_t z = baseZ + (std::int32_t)pz - 1;
+			BlockType* row = snapshot.Blocks + Padded::Index(0, py, pz);
+
+			if((std::uint32_t)y >= world.SizeY() || (std::uint32_t)z >= world.SizeZ())
+			{
+				std::memset(row, BlockType_Air, Padded::SizeX);
+				continue;
+			}
+
+			// The middle of the row is one row of the chunk in x; only its two ends come
+			// from the chunks either side.
+			const WorldChunk& chunk = world.GetChunk(cx, y / Dims::SizeY, z / Dims::SizeZ);
+			std::memcpy(row + 1, chunk.Data() + Dims::Index(0, y % Dims::SizeY, z % Dims::SizeZ), Dims::SizeX);
+
+			row[0] = world.Get(baseX - 1, y, z);
+			row[Padded::SizeX - 1] = world.Get(baseX + (std::int32_t)Dims::SizeX, y, z);
+		}
+	}
+}
+
+std::uint64_t HashChunkSnapshot(const ChunkSnapshot& snapshot)
+{
+	static_assert(Padded::Volume % 8 == 0, "The hash reads whole eight block words.");
+
+	// MurmurHash64A.  A multiply only carries a change upwards, so each word is folded
+	// back down with a shift before it is mixed in; otherwise a change in a word's top
+	// byte could only reach the top byte of the hash, where two of them often cancel.
+	const std::uint64_t m = 0xc6a4a7935bd1e995ull;
+	const int r = 47;
+
+	std::uint64_t hash = 0x9e3779b97f4a7c15ull ^ (Padded::Volume * m);
+	for(std::uint32_t i = 0; i < Padded::Volume; i += 8)
+	{
+		std::uint64_t word;
+		std::memcpy(&word, snapshot.Blocks + i, sizeof(word));
+		word *= m;
+		word ^= word >> r;
+		word *= m;
+
+		hash ^= word;
+		hash *= m;
+	}
+
+	hash ^= hash >> r;
+	hash *= m;
+	hash ^= hash >> r;
+	return hash;
+}
+
+ChunkSnapshot& ThreadChunkSnapshot()
+{
+	thread_local ChunkSnapshot snapshot;
+	return snapshot;
+}
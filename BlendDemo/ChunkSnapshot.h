@@ -0,0 +1,40 @@
+//***************************************************************************************
+// ChunkSnapshot.h
+//
+// A copy of one world chunk plus a one block apron taken from its 26 neighbours, in a
+// single contiguous 18x18x18 buffer.  Kernels that look at a block's neighbours, such
+// as meshing, ambient occlusion and lighting, read only the snapshot: the apron means
+// every neighbour of an interior block is in the buffer, so their inner loops need no
+// bounds tests or chunk lookups.  A snapshot is also a private copy, so a worker can
+// keep reading it while the main thread edits the world.
+//***************************************************************************************
+
+#pragma once
+
+#include "World.h"
+
+typedef ChunkDims<WorldChunk::Dims::SizeX + 2, WorldChunk::Dims::SizeY + 2, WorldChunk::Dims::SizeZ + 2> PaddedChunkDims;
+
+struct ChunkSnapshot
+{
+	// The chunk's block x, y, z is at padded x + 1, y + 1, z + 1.  Blocks outside the
+	// world are air.
+	BlockType Blocks[PaddedChunkDims::Volume];
+
+	// Chunk coordinates of the chunk taken.
+	std::uint32_t ChunkX = 0;
+	std::uint32_t ChunkY = 0;
+	std::uint32_t ChunkZ = 0;
+};
+
+// Copies chunk cx, cy, cz of world and its apron into snapshot.
+void TakeChunkSnapshot(const World& world, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, ChunkSnapshot& snapshot);
+
+// A 64-bit hash of every block of snapshot, apron included, so it changes with anything
+// a kernel reading the snapshot could see.  Every bit of the hash depends on every
+// block, so edits anywhere are as unlikely as each other to collide.
+std::uint64_t HashChunkSnapshot(const ChunkSnapshot& snapshot);
+
+// A snapshot owned by the calling thread, for workers that take one chunk at a time.
+// Reused by every call on the same thread.
+ChunkSnapshot& ThreadChunkSnapshot();
@@ -0,0 +1,212 @@
+//***************************************************************************************
+// ChunkStreamer.cpp
+//***************************************************************************************
+
+#include "ChunkStreamer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	typedef WorldChunk::Dims Dims;
+}
+
+ChunkStreamer::ChunkStreamer(const std::string& prefix, std::uint32_t seed,
+	std::uint32_t chunksX, std::uint32_t chunksY, std::uint32_t chunksZ, unsigned threadCount) :
+	mPrefix(prefix),
+	mSeed(seed),
+	mChunksX(chunksX),
+	mChunksY(chunksY),
+	mChunksZ(chunksZ),
+	mStates((std::size_t)chunksX * chunksY * chunksZ, ChunkState_Unloaded),
+	mCollected(mStates.size()),
+	mDamaged(mStates.size(), false)
+{
+	assert(threadCount > 0);
+	for(unsigned i = 0; i < threadCount; ++i)
+		mThreads.emplace_back(&ChunkStreamer::WorkerMain, this);
+}
+
+ChunkStreamer::~ChunkStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mWake.notify_all();
+
+	for(std::thread& thread : mThreads)
+		thread.join();
+}
+
+void ChunkStreamer::Request(const float eye[3], const float look[3], float radius)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// Queued chunks that are still wanted get a new priority; the rest go back to
+		// unloaded.  Chunks a worker already has are not in the queue and are kept.
+		std::size_t kept = 0;
+		for(Job& job : mQueue)
+		{
+			if(ChunkInSphere(job.Chunk, eye, radius))
+			{
+				job.Priority = Priority(job.Chunk, eye, look);
+				mQueue[kept++] = job;
+			}
+			else
+			{
+				mStates[ChunkIndex(job.Chunk.X, job.Chunk.Y, job.Chunk.Z)] = ChunkState_Unloaded;
+			}
+		}
+		mQueue.resize(kept);
+
+		ForEachChunkInSphere(eye, radius, mChunksX, mChunksY, mChunksZ, [&](const ChunkCoord& chunk)
+		{
+			ChunkState& state = mStates[ChunkIndex(chunk.X, chunk.Y, chunk.Z)];
+			if(state != ChunkState_Unloaded)
+				return;
+
+			state = ChunkState_Queued;
+			mQueue.push_back({ chunk, Priority(chunk, eye, look) });
+		});
+
+		std::sort(mQueue.begin(), mQueue.end(), [](const Job& a, const Job& b)
+		{
+			return a.Priority > b.Priority;
+		});
+	}
+
+	mWake.notify_all();
+}
+
+std::size_t ChunkStreamer::Collect(World& world, std::vector<ChunkCoord>& placed, std::vector<ChunkCoord>* damaged)
+{
+	std::vector<Completed> completed;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		completed.swap(mCompleted);
+	}
+
+	for(const Completed& done : completed)
+	{
+		const ChunkCoord& c = done.Chunk;
+		PlaceChunk(world, c.X, c.Y, c.Z, done.Blocks);
+		world.RefreshSurface(c.X, c.Z);
+		world.MarkDirty(MakeBlockBox(
+			c.X * Dims::SizeX, c.Y * Dims::SizeY, c.Z * Dims::SizeZ,
+			(c.X + 1) * Dims::SizeX, (c.Y + 1) * Dims::SizeY, (c.Z + 1) * Dims::SizeZ));
+
+		std::size_t index = ChunkIndex(c.X, c.Y, c.Z);
+		mStates[index] = ChunkState_Resident;
+		mCollected[index] = world.ShareChunk(c.X, c.Y, c.Z);
+		mDamaged[index] = done.Damaged;
+		placed.push_back(c);
+
+		if(done.Damaged)
+		{
+			++mLoadFailures;
+			if(damaged != nullptr)
+				damaged->push_back(c);
+		}
+	}
+
+	return completed.size();
+}
+
+bool ChunkStreamer::Unload(World& world, const ChunkCoord& chunk)
+{
+	std::size_t index = ChunkIndex(chunk.X, chunk.Y, chunk.Z);
+	assert(mStates[index] == ChunkState_Resident);
+
+	if(mDamaged[index] || world.ShareChunk(chunk.X, chunk.Y, chunk.Z) != mCollected[index])
+	{
+		if(!SaveChunk(world, mPrefix, mSeed, chunk.X, chunk.Y, chunk.Z))
+			return false;
+		mRegionWrites.fetch_add(1, std::memory_order_release);
+	}
+
+	world.FillChunk(chunk.X, chunk.Y, chunk.Z, BlockType_Air);
+	world.RefreshSurface(chunk.X, chunk.Z);
+
+	mStates[index] = ChunkState_Unloaded;
+	mCollected[index].reset();
+	mDamaged[index] = false;
+	return true;
+}
+
+std::size_t ChunkStreamer::Pending()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mQueue.size() + mInFlight + mCompleted.size();
+}
+
+bool ChunkStreamer::IsResident(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)const
+{
+	return mStates[ChunkIndex(cx, cy, cz)] == ChunkState_Resident;
+}
+
+void ChunkStreamer::WorkerMain()
+{
+	// Mappings are per thread, so reads need no locking.
+	RegionMapCache regions(mPrefix, RegionAccess_Random);
+	std::uint32_t regionWrites = 0;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	for(;;)
+	{
+		mWake.wait(lock, [this] { return mQuit || !mQueue.empty(); });
+		if(mQuit)
+			return;
+
+		Job job = mQueue.back();
+		mQueue.pop_back();
+		++mInFlight;
+		lock.unlock();
+
+		// A region written since the last job may have grown or been created, and a
+		// mapping, or a file remembered as missing, would not show it.
+		std::uint32_t writes = mRegionWrites.load(std::memory_order_acquire);
+		if(writes != regionWrites)
+		{
+			regions.Clear();
+			regionWrites = writes;
+		}
+
+		// A stored chunk that does not decode is generated again rather than left out,
+		// and marked so Collect reports it.
+		Completed done;
+		done.Chunk = job.Chunk;
+		if(!LoadChunk(regions, mSeed, job.Chunk.X, job.Chunk.Y, job.Chunk.Z, done.Blocks))
+		{
+			GenerateChunk(mSeed, job.Chunk.X, job.Chunk.Y, job.Chunk.Z, done.Blocks);
+			done.Damaged = true;
+		}
+
+		lock.lock();
+		--mInFlight;
+		mCompleted.push_back(std::move(done));
+	}
+}
+
+std::size_t ChunkStreamer::ChunkIndex(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)const
+{
+	assert(cx < mChunksX && cy < mChunksY && cz < mChunksZ);
+	return cx + (std::size_t)mChunksX * (cz + (std::size_t)mChunksZ * cy);
+}
+
+float ChunkStreamer::Priority(const ChunkCoord& chunk, const float eye[3], const float look[3])
+{
+	float dx = (chunk.X + 0.5f) * Dims::SizeX - eye[0];
+	float dy = (chunk.Y + 0.5f) * Dims::SizeY - eye[1];
+	float dz = (chunk.Z + 0.5f) * Dims::SizeZ - eye[2];
+	float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+	if(distance <= 0.0f)
+		return 0.0f;
+
+	// Ahead counts the distance as it is, to the side half as far again, behind twice.
+	float facing = (dx * look[0] + dy * look[1] + dz * look[2]) / distance;
+	return distance * (1.5f - 0.5f * facing);
+}
@@ -0,0 +1,133 @@
+//***************************************************************************************
+// ChunkStreamer.h
+//
+// Brings a world's chunks in around the camera without holding up the frame.  Each
+// frame the main loop declares the chunks it wants, those within a radius of the eye,
+// and background threads read them from the save or generate them, nearest first and
+// those ahead of the camera before those behind.  The queue is re-sorted with every
+// declaration, so a camera that turns or moves gets what it now looks at next, and
+// chunks that fell out of range before their turn are dropped.  Finished chunks wait
+// in a completion queue until the main loop collects them into the world.
+//
+// A stored chunk that does not decode is generated again so the world has no hole, but
+// it is reported as damaged rather than passed off as one that was never stored, and
+// unloading it writes it back over the damaged record.
+//
+// The threads are the streamer's own: WorkerPool runs batches that the caller waits
+// for, and this work is meant to outlast the frame that asked for it.
+//***************************************************************************************
+
+#pragma once
+
+#include "WorldFile.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ChunkStreamer
+{
+public:
+	// Streams the chunks of the save at prefix, which are generated from seed when they
+	// are not stored, into a world of chunksX x chunksY x chunksZ chunks.
+	ChunkStreamer(const std::string& prefix, std::uint32_t seed,
+		std::uint32_t chunksX, std::uint32_t chunksY, std::uint32_t chunksZ, unsigned threadCount);
+	ChunkStreamer(const ChunkStreamer&) = delete;
+	ChunkStreamer& operator=(const ChunkStreamer&) = delete;
+	~ChunkStreamer();
+
+	// Wants every chunk whose centre is within radius blocks of eye, in world block
+	// coordinates, and re-sorts the queue for eye and the unit vector look.
+	void Request(const float eye[3], const float look[3], float radius);
+
+	// Puts the chunks finished since the last call into world, refreshes their column
+	// tops, marks them and their neighbours dirty and appends their coordinates to
+	// placed.  Those among them whose stored blocks did not decode, and were generated
+	// again instead, are also appended to damaged when it is not null.  Returns how many
+	// chunks were placed.
+	std::size_t Collect(World& world, std::vector<ChunkCoord>& placed, std::vector<ChunkCoord>* damaged = nullptr);
+
+	// Takes a resident chunk back out of world, leaving air and refreshed column tops.
+	// When its blocks changed since it was collected, or it was damaged, they are first
+	// written to the save, where the workers find them the next time the chunk is wanted;
+	// neighbours are not marked dirty.  Returns false, keeping the chunk, when they cannot
+	// be written.
+	bool Unload(World& world, const ChunkCoord& chunk);
+
+	// Chunks queued or being loaded.
+	std::size_t Pending()const;
+
+	// Chunks collected so far whose stored blocks did not decode.
+	std::size_t LoadFailures()const { return mLoadFailures; }
+
+	bool IsResident(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)const;
+
+private:
+	enum ChunkState : std::uint8_t
+	{
+		ChunkState_Unloaded = 0,
+		ChunkState_Queued,
+		ChunkState_Resident
+	};
+
+	struct Job
+	{
+		ChunkCoord Chunk;
+		float Priority;
+	};
+
+	struct Completed
+	{
+		ChunkCoord Chunk;
+		LoadedChunk Blocks;
+
+		// The stored blocks did not decode, so Blocks were generated instead.
+		bool Damaged = false;
+	};
+
+	void WorkerMain();
+
+	std::size_t ChunkIndex(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)const;
+
+	// Smaller is sooner: the distance from eye to the chunk's centre, up to twice as far
+	// for chunks behind the camera.
+	static float Priority(const ChunkCoord& chunk, const float eye[3], const float look[3]);
+
+	std::string mPrefix;
+	std::uint32_t mSeed;
+	std::uint32_t mChunksX;
+	std::uint32_t mChunksY;
+	std::uint32_t mChunksZ;
+
+	// Main thread only, indexed like the world's chunks.  A chunk is Queued from the
+	// moment it is wanted until it is collected, even while a worker has it.
+	std::vector<ChunkState> mStates;
+
+	// The storage each resident chunk was collected with, main thread only.  Edits copy
+	// the storage, so a chunk whose storage is no longer this one was changed.
+	std::vector<std::shared_ptr<const WorldChunk>> mCollected;
+
+	// Resident chunks collected as damaged, main thread only.  Unload writes them back
+	// even when unchanged, so the damaged record does not outlive them.
+	std::vector<bool> mDamaged;
+	std::size_t mLoadFailures = 0;
+
+	// Bumped whenever Unload writes a region, so workers drop mappings that may be stale.
+	std::atomic<std::uint32_t> mRegionWrites{ 0 };
+
+	mutable std::mutex mMutex;
+	std::condition_variable mWake;
+
+	// Sorted so the chunk to load next is at the back.
+	std::vector<Job> mQueue;
+	std::vector<Completed> mCompleted;
+	std::size_t mInFlight = 0;
+	bool mQuit = false;
+
+	std::vector<std::thread> mThreads;
+};
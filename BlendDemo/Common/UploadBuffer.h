@@ -55,6 +55,18 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Start of the mapped memory, for callers that fill many elements at once.
+    // Elements are ElementByteSize() bytes apart.
+    BYTE* MappedData()const
+    {
+        return mMappedData;
+    }
+
+    UINT ElementByteSize()const
+    {
+        return mElementByteSize;
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
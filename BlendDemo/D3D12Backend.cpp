@@ -0,0 +1,234 @@
+//***************************************************************************************
+// D3D12Backend.cpp
+//***************************************************************************************
+
+#include "D3D12Backend.h"
+#include "IndirectArgs.h"
+
+D3D12RenderDevice::D3D12RenderDevice(ID3D12Device* device, ID3D12GraphicsCommandList* uploadCmdList)
+	: mDevice(device), mUploadCmdList(uploadCmdList)
+{
+}
+
+D3D12RenderDevice::~D3D12RenderDevice()
+{
+	for(auto& buffer : mBuffers)
+	{
+		if(buffer.Mapped != nullptr)
+			buffer.Resource->Unmap(0, nullptr);
+	}
+}
+
+void D3D12RenderDevice::ReleaseUploads()
+{
+	mPendingUploads.clear();
+}
+
+void D3D12RenderDevice::SetPipeline(std::uint32_t pipeline, ID3D12PipelineState* pso)
+{
+	if(pipeline >= mPipelines.size())
+		mPipelines.resize(pipeline + 1, nullptr);
+
+	mPipelines[pipeline] = pso;
+}
+
+void D3D12RenderDevice::SetTextureHeap(D3D12_GPU_DESCRIPTOR_HANDLE heapStart, UINT descriptorSize)
+{
+	mTextureHeapStart = heapStart;
+	mDescriptorSize = descriptorSize;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE D3D12RenderDevice::Texture(std::uint32_t index)const
+{
+	CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mTextureHeapStart);
+	tex.Offset(index, mDescriptorSize);
+	return tex;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS D3D12RenderDevice::Address(BufferHandle buffer, std::uint32_t element)const
+{
+	const Buffer& b = mBuffers[buffer];
+	return b.Resource->GetGPUVirtualAddress() + (UINT64)element * b.Stride;
+}
+
+D3D12_VERTEX_BUFFER_VIEW D3D12RenderDevice::VertexBufferView(BufferHandle buffer)const
+{
+	const Buffer& b = mBuffers[buffer];
+
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	vbv.BufferLocation = b.Resource->GetGPUVirtualAddress();
+	vbv.StrideInBytes = b.Stride;
+	vbv.SizeInBytes = b.Stride * b.Desc.ElementCount;
+	return vbv;
+}
+
+D3D12_INDEX_BUFFER_VIEW D3D12RenderDevice::IndexBufferView(BufferHandle buffer)const
+{
+	const Buffer& b = mBuffers[buffer];
+
+	D3D12_INDEX_BUFFER_VIEW ibv;
+	ibv.BufferLocation = b.Resource->GetGPUVirtualAddress();
+	ibv.Format = b.Desc.ElementByteSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	ibv.SizeInBytes = b.Stride * b.Desc.ElementCount;
+	return ibv;
+}
+
+std::uint32_t D3D12RenderDevice::ElementStride(BufferHandle buffer)const
+{
+	return mBuffers[buffer].Stride;
+}
+
+std::uint32_t D3D12RenderDevice::ElementCount(BufferHandle buffer)const
+{
+	return mBuffers[buffer].Desc.ElementCount;
+}
+
+BufferHandle D3D12RenderDevice::OnCreateBuffer(const BufferDesc& desc, const void* initialData)
+{
+	Buffer buffer;
+	buffer.Desc = desc;
+
+	// Constant buffer elements need to be multiples of 256 bytes.
+	buffer.Stride = desc.Usage == BufferUsage::Constant ?
+		d3dUtil::CalcConstantBufferByteSize(desc.ElementByteSize) : desc.ElementByteSize;
+
+	UINT64 byteSize = (UINT64)buffer.Stride * desc.ElementCount;
+
+	if(desc.CpuWritable)
+	{
+		ThrowIfFailed(mDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&buffer.Resource)));
+
+		// Left mapped for the life of the buffer; the frame resource fences keep the
+		// CPU from writing while the GPU still reads.
+		ThrowIfFailed(buffer.Resource->Map(0, nullptr, reinterpret_cast<void**>(&buffer.Mapped)));
+
+		if(initialData != nullptr)
+		{
+			for(UINT i = 0; i < desc.ElementCount; ++i)
+				memcpy(buffer.Mapped + (UINT64)i * buffer.Stride, (const BYTE*)initialData + (UINT64)i * desc.ElementByteSize, desc.ElementByteSize);
+		}
+	}
+	else
+	{
+		// Only vertex, index and structured data is uploaded once, none of which is padded.
+		Microsoft::WRL::ComPtr<ID3D12Resource> upload;
+		buffer.Resource = d3dUtil::CreateDefaultBuffer(mDevice, mUploadCmdList, initialData, byteSize, upload);
+		mPendingUploads.push_back(upload);
+	}
+
+	mBuffers.push_back(buffer);
+	return (BufferHandle)(mBuffers.size() - 1);
+}
+
+void D3D12RenderDevice::OnGrowBuffer(BufferHandle buffer, std::uint32_t elementCount)
+{
+	Buffer& b = mBuffers[buffer];
+	assert(b.Mapped != nullptr);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer((UINT64)b.Stride * elementCount),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&resource)));
+
+	BYTE* mapped = nullptr;
+	ThrowIfFailed(resource->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
+
+	// Both are upload heap memory, so the live elements are moved with a plain copy.
+	memcpy(mapped, b.Mapped, (size_t)b.Stride * b.Desc.ElementCount);
+
+	// The caller made sure the GPU is done with the old resource, so it goes right away.
+	b.Resource->Unmap(0, nullptr);
+	b.Resource = resource;
+	b.Mapped = mapped;
+	b.Desc.ElementCount = elementCount;
+}
+
+std::uint8_t* D3D12RenderDevice::OnMapElements(BufferHandle buffer, std::uint32_t first)
+{
+	Buffer& b = mBuffers[buffer];
+	assert(b.Mapped != nullptr);
+	return b.Mapped + (UINT64)first * b.Stride;
+}
+
+D3D12RenderContext::D3D12RenderContext(const D3D12RenderDevice& device, ID3D12GraphicsCommandList* cmdList)
+	: mDevice(device), mCmdList(cmdList)
+{
+}
+
+void D3D12RenderContext::OnSetPipeline(std::uint32_t pipeline)
+{
+	mCmdList->SetPipelineState(mDevice.Pipeline(pipeline));
+}
+
+void D3D12RenderContext::OnSetGeometry(BufferHandle vertices, BufferHandle indices)
+{
+	D3D12_VERTEX_BUFFER_VIEW vbv = mDevice.VertexBufferView(vertices);
+	D3D12_INDEX_BUFFER_VIEW ibv = mDevice.IndexBufferView(indices);
+
+	mCmdList->IASetVertexBuffers(0, 1, &vbv);
+	mCmdList->IASetIndexBuffer(&ibv);
+}
+
+void D3D12RenderContext::OnSetTopology(PrimitiveTopology topology)
+{
+	mCmdList->IASetPrimitiveTopology(ToD3DTopology(topology));
+}
+
+void D3D12RenderContext::OnSetTextureTable(std::uint32_t slot, std::uint32_t firstTexture)
+{
+	mCmdList->SetGraphicsRootDescriptorTable(slot, mDevice.Texture(firstTexture));
+}
+
+void D3D12RenderContext::OnSetConstantBuffer(std::uint32_t slot, BufferHandle buffer, std::uint32_t element)
+{
+	mCmdList->SetGraphicsRootConstantBufferView(slot, mDevice.Address(buffer, element));
+}
+
+void D3D12RenderContext::OnSetShaderResource(std::uint32_t slot, BufferHandle buffer, std::uint32_t element)
+{
+	mCmdList->SetGraphicsRootShaderResourceView(slot, mDevice.Address(buffer, element));
+}
+
+void D3D12RenderContext::OnDrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex,
+	std::int32_t baseVertex, std::uint32_t startInstance)
+{
+	mCmdList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void D3D12RenderContext::OnDrawIndirect(BufferHandle args, std::uint32_t firstRecord, std::uint32_t recordCount)
+{
+	mCmdList->ExecuteIndirect(mDevice.IndirectSignature(), recordCount,
+		mDevice.Resource(args), (UINT64)firstRecord * sizeof(IndirectDrawArgs), nullptr, 0);
+}
+
+PrimitiveTopology ToPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+	switch(topology)
+	{
+	case D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP: return PrimitiveTopology::TriangleStrip;
+	case D3D_PRIMITIVE_TOPOLOGY_LINELIST:      return PrimitiveTopology::LineList;
+	case D3D_PRIMITIVE_TOPOLOGY_POINTLIST:     return PrimitiveTopology::PointList;
+	default:                                   return PrimitiveTopology::TriangleList;
+	}
+}
+
+D3D12_PRIMITIVE_TOPOLOGY ToD3DTopology(PrimitiveTopology topology)
+{
+	switch(topology)
+	{
+	case PrimitiveTopology::TriangleStrip: return D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+	case PrimitiveTopology::LineList:      return D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+	case PrimitiveTopology::PointList:     return D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+	default:                               return D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	}
+}
@@ -0,0 +1,102 @@
+//***************************************************************************************
+// D3D12Backend.h
+//
+// RenderDevice and RenderContext on top of Direct3D 12.  Handles index tables held by
+// the device; a context records into a command list owned by the caller.
+//***************************************************************************************
+
+#pragma once
+
+#include <vector>
+#include "Common/d3dUtil.h"
+#include "RenderBackend.h"
+
+class D3D12RenderDevice : public RenderDevice
+{
+public:
+	// Buffers that are not CPU writable are filled with copies recorded on uploadCmdList.
+	// The list has to be executed and finished before ReleaseUploads is called.
+	D3D12RenderDevice(ID3D12Device* device, ID3D12GraphicsCommandList* uploadCmdList);
+	D3D12RenderDevice(const D3D12RenderDevice& rhs) = delete;
+	D3D12RenderDevice& operator=(const D3D12RenderDevice& rhs) = delete;
+	~D3D12RenderDevice();
+
+	// Frees the intermediate upload buffers once the copies have run.
+	void ReleaseUploads();
+
+	// Pipelines are referred to by id; the id is usually fixed and the PSO behind it
+	// swapped, as when toggling wireframe.
+	void SetPipeline(std::uint32_t pipeline, ID3D12PipelineState* pso);
+	ID3D12PipelineState* Pipeline(std::uint32_t pipeline)const { return mPipelines[pipeline]; }
+
+	// Textures are referred to by their index in the shader visible SRV heap.
+	void SetTextureHeap(D3D12_GPU_DESCRIPTOR_HANDLE heapStart, UINT descriptorSize);
+	D3D12_GPU_DESCRIPTOR_HANDLE Texture(std::uint32_t index)const;
+
+	// The command signature DrawIndirect submits IndirectDrawArgs records with.
+	void SetIndirectSignature(ID3D12CommandSignature* signature) { mIndirectSignature = signature; }
+	ID3D12CommandSignature* IndirectSignature()const { return mIndirectSignature; }
+
+	ID3D12Resource* Resource(BufferHandle buffer)const { return mBuffers[buffer].Resource.Get(); }
+	D3D12_GPU_VIRTUAL_ADDRESS Address(BufferHandle buffer, std::uint32_t element)const;
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView(BufferHandle buffer)const;
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView(BufferHandle buffer)const;
+
+	virtual std::uint32_t ElementStride(BufferHandle buffer)const override;
+	virtual std::uint32_t ElementCount(BufferHandle buffer)const override;
+
+protected:
+	virtual BufferHandle OnCreateBuffer(const BufferDesc& desc, const void* initialData)override;
+	virtual void OnGrowBuffer(BufferHandle buffer, std::uint32_t elementCount)override;
+	virtual std::uint8_t* OnMapElements(BufferHandle buffer, std::uint32_t first)override;
+
+private:
+	struct Buffer
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		BufferDesc Desc;
+		UINT Stride = 0;
+
+		// Persistently mapped for CPU writable buffers, null otherwise.
+		BYTE* Mapped = nullptr;
+	};
+
+	ID3D12Device* mDevice = nullptr;
+	ID3D12GraphicsCommandList* mUploadCmdList = nullptr;
+
+	std::vector<Buffer> mBuffers;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> mPendingUploads;
+	std::vector<ID3D12PipelineState*> mPipelines;
+
+	D3D12_GPU_DESCRIPTOR_HANDLE mTextureHeapStart = {};
+	UINT mDescriptorSize = 0;
+
+	ID3D12CommandSignature* mIndirectSignature = nullptr;
+};
+
+class D3D12RenderContext : public RenderContext
+{
+public:
+	D3D12RenderContext(const D3D12RenderDevice& device, ID3D12GraphicsCommandList* cmdList);
+
+	// For the frame setup the interface does not cover: barriers, clears, targets.
+	ID3D12GraphicsCommandList* CommandList()const { return mCmdList; }
+
+protected:
+	virtual void OnSetPipeline(std::uint32_t pipeline)override;
+	virtual void OnSetGeometry(BufferHandle vertices, BufferHandle indices)override;
+	virtual void OnSetTopology(PrimitiveTopology topology)override;
+	virtual void OnSetTextureTable(std::uint32_t slot, std::uint32_t firstTexture)override;
+	virtual void OnSetConstantBuffer(std::uint32_t slot, BufferHandle buffer, std::uint32_t element)override;
+	virtual void OnSetShaderResource(std::uint32_t slot, BufferHandle buffer, std::uint32_t element)override;
+	virtual void OnDrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex,
+		std::int32_t baseVertex, std::uint32_t startInstance)override;
+	virtual void OnDrawIndirect(BufferHandle args, std::uint32_t firstRecord, std::uint32_t recordCount)override;
+
+private:
+	const D3D12RenderDevice& mDevice;
+	ID3D12GraphicsCommandList* mCmdList = nullptr;
+};
+
+PrimitiveTopology ToPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology);
+D3D12_PRIMITIVE_TOPOLOGY ToD3DTopology(PrimitiveTopology topology);
@@ -0,0 +1,66 @@
+//***************************************************************************************
+// DirtyList.h
+//
+// Indices of the elements of one per-frame buffer that still have to be rewritten.
+// Each frame resource keeps its own list, so an element marked once is written once
+// into every frame resource, and a frame's update costs only what actually changed.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DirtyList
+{
+public:
+	// Sizes the list for elements [0, count).  New elements start out dirty.  Lists
+	// only grow, since a pending index past a shrunk end would be left behind.
+	void Resize(std::uint32_t count)
+	{
+		std::uint32_t oldCount = (std::uint32_t)mFlags.size();
+		if(count <= oldCount)
+			return;
+
+		mFlags.resize(count, 0);
+		for(std::uint32_t i = oldCount; i < count; ++i)
+			Mark(i);
+	}
+
+	// Marking an element that is already pending does nothing.
+	void Mark(std::uint32_t index)
+	{
+		if(mFlags[index] == 0)
+		{
+			mFlags[index] = 1;
+			mIndices.push_back(index);
+		}
+	}
+
+	void MarkAll()
+	{
+		for(std::uint32_t i = 0; i < (std::uint32_t)mFlags.size(); ++i)
+			Mark(i);
+	}
+
+	// Calls write(index) for every pending element, in the order they were marked, and
+	// empties the list.
+	template<typename WriteFn>
+	void Flush(WriteFn write)
+	{
+		for(std::uint32_t index : mIndices)
+		{
+			mFlags[index] = 0;
+			write(index);
+		}
+		mIndices.clear();
+	}
+
+	std::size_t Pending()const { return mIndices.size(); }
+	std::uint32_t Size()const { return (std::uint32_t)mFlags.size(); }
+
+private:
+	std::vector<std::uint8_t> mFlags;
+	std::vector<std::uint32_t> mIndices;
+};
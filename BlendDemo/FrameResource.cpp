@@ -1,20 +1,87 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount)
+namespace
+{
+    BufferHandle CreateFrameBuffer(RenderDevice& buffers, BufferUsage usage, UINT elementCount, UINT elementByteSize)
+    {
+        BufferDesc desc;
+        desc.Usage = usage;
+        desc.ElementCount = elementCount;
+        desc.ElementByteSize = elementByteSize;
+        desc.CpuWritable = true;
+        return buffers.CreateBuffer(desc, nullptr);
+    }
+}
+
+FrameResource::FrameResource(ID3D12Device* device, RenderDevice& buffers, UINT objectCount, UINT materialCount, UINT waveVertCount, UINT uploadArenaByteSize, UINT recordListCount, UINT indirectArgCount)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
 		IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
 
-  //  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
-    PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-    MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
-    ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+    RecordCmdListAllocs.resize(recordListCount);
+    for(UINT i = 0; i < recordListCount; ++i)
+    {
+        ThrowIfFailed(device->CreateCommandAllocator(
+            D3D12_COMMAND_LIST_TYPE_DIRECT,
+            IID_PPV_ARGS(RecordCmdListAllocs[i].GetAddressOf())));
+    }
+
+  //  FrameCB = CreateFrameBuffer(buffers, BufferUsage::Constant, 1, sizeof(FrameConstants));
+    ObjectCB = CreateFrameBuffer(buffers, BufferUsage::Constant, objectCount, sizeof(ObjectConstants));
+    MaterialBuffer = CreateFrameBuffer(buffers, BufferUsage::Structured, materialCount, sizeof(MaterialData));
+
+    WavesVB = CreateFrameBuffer(buffers, BufferUsage::Vertex, waveVertCount, sizeof(Vertex));
 
-    WavesVB = std::make_unique<UploadBuffer<Vertex>>(device, waveVertCount, false);
+    Arena = std::make_unique<UploadArena>(buffers, uploadArenaByteSize);
+    IndirectArgsBuffer = CreateFrameBuffer(buffers, BufferUsage::IndirectArgs, indirectArgCount, sizeof(IndirectDrawArgs));
+
+    DirtyObjects.Resize(objectCount);
+    DirtyMaterials.Resize(materialCount);
 }
 
 FrameResource::~FrameResource()
 {
 
+}
+
+void FrameResource::Resize(UINT objectCount, UINT materialCount)
+{
+    DirtyObjects.Resize(objectCount);
+    DirtyMaterials.Resize(materialCount);
+}
+
+void FrameResource::Grow(RenderDevice& buffers, UINT arenaByteSize)
+{
+    UINT objectCapacity = buffers.ElementCount(ObjectCB);
+    if(DirtyObjects.Size() > objectCapacity)
+    {
+        buffers.GrowBuffer(ObjectCB, GrowCapacity(objectCapacity, DirtyObjects.Size()));
+        Grows++;
+    }
+
+    UINT materialCapacity = buffers.ElementCount(MaterialBuffer);
+    if(DirtyMaterials.Size() > materialCapacity)
+    {
+        buffers.GrowBuffer(MaterialBuffer, GrowCapacity(materialCapacity, DirtyMaterials.Size()));
+        Grows++;
+    }
+
+    UINT arenaGrows = Arena->Grows();
+    Arena->Reset(arenaByteSize);
+    Grows += Arena->Grows() - arenaGrows;
+}
+
+FrameResourceUsage FrameResource::Usage(const RenderDevice& buffers)const
+{
+    FrameResourceUsage usage;
+    usage.Objects = DirtyObjects.Size();
+    usage.ObjectCapacity = buffers.ElementCount(ObjectCB);
+    usage.Materials = DirtyMaterials.Size();
+    usage.MaterialCapacity = buffers.ElementCount(MaterialBuffer);
+    usage.ArenaHighWater = Arena->Allocator().HighWater();
+    usage.ArenaCapacity = Arena->Allocator().Capacity();
+    usage.ArenaFailedAllocations = Arena->Allocator().FailedAllocations();
+    usage.Grows = Grows;
+    return usage;
 }
\ No newline at end of file
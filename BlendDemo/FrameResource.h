@@ -2,12 +2,43 @@
 
 #include "Common/d3dUtil.h"
 #include "Common/MathHelper.h"
-#include "Common/UploadBuffer.h"
+#include "BlockInstances.h"
+#include "IndirectArgs.h"
+#include "RenderBackend.h"
+#include "DirtyList.h"
+#include "UploadArena.h"
 
 struct ObjectConstants
 {
     DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
 	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+
+	// Index of the object's material in the frame's material buffer.
+	UINT MaterialIndex = 0;
+	UINT ObjPad0 = 0;
+	UINT ObjPad1 = 0;
+	UINT ObjPad2 = 0;
+};
+
+// TransformStore::WriteTransposed writes the two matrices as 32 packed floats.
+static_assert(offsetof(ObjectConstants, MaterialIndex) == 32 * sizeof(float), "ObjectConstants must start with World then TexTransform.");
+
+// One material in the frame's material buffer; matches MaterialData in the shaders.
+// Draws pick theirs by index, so no material is bound per draw.
+struct MaterialData
+{
+	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
+	float Roughness = 0.25f;
+
+	// Used in texture mapping.
+	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+
+	// Index of the diffuse texture in the SRV heap.
+	UINT DiffuseMapIndex = 0;
+	UINT MatPad0 = 0;
+	UINT MatPad1 = 0;
+	UINT MatPad2 = 0;
 };
 
 struct PassConstants
@@ -39,6 +70,10 @@ struct PassConstants
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
     // are spot lights for a maximum of MaxLights per object.
     Light Lights[MaxLights];
+
+    // Flattens the shadow items onto the ground along the main light.  The same for
+    // every shadow item, so it is built once per pass rather than per item.
+    DirectX::XMFLOAT4X4 ShadowTransform = MathHelper::Identity4x4();
 };
 
 struct Vertex
@@ -48,31 +83,80 @@ struct Vertex
 	DirectX::XMFLOAT2 TexC;
 };
 
+// How full a frame resource's buffers are, for spotting growth while profiling.
+// Object and material counts only ever go up, so they are their own high water mark.
+struct FrameResourceUsage
+{
+    UINT Objects = 0;
+    UINT ObjectCapacity = 0;
+    UINT Materials = 0;
+    UINT MaterialCapacity = 0;
+    UINT ArenaHighWater = 0;
+    UINT ArenaCapacity = 0;
+    UINT ArenaFailedAllocations = 0;
+    UINT Grows = 0;
+};
+
 // Stores the resources needed for the CPU to build the command lists
 // for a frame.  
 struct FrameResource
 {
 public:
     
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount);
+    FrameResource(ID3D12Device* device, RenderDevice& buffers, UINT objectCount, UINT materialCount, UINT waveVertCount, UINT uploadArenaByteSize, UINT recordListCount, UINT indirectArgCount);
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource();
 
+    // Records how many objects and materials are live.  The new ones start out dirty.
+    // Can be called at any time; the buffers themselves are only grown by Grow.
+    void Resize(UINT objectCount, UINT materialCount);
+
+    // Grows the buffers that are too small for the live objects and materials, keeping
+    // their contents, and resets the arena with room for at least arenaByteSize.  Only
+    // call once the fence says the GPU is done with this frame resource.  Each frame
+    // resource grows when it next comes round, so the others keep running meanwhile.
+    void Grow(RenderDevice& buffers, UINT arenaByteSize);
+
+    FrameResourceUsage Usage(const RenderDevice& buffers)const;
+
     // We cannot reset the allocator until the GPU is done processing the commands.
     // So each frame needs their own allocator.
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
+    // One allocator per command list the render queue is recorded into in parallel.
+    // Allocators are not free threaded, so each recording thread needs its own.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> RecordCmdListAllocs;
+
     // We cannot update a cbuffer until the GPU is done processing the commands
     // that reference it.  So each frame needs their own cbuffers.
-   // std::unique_ptr<UploadBuffer<FrameConstants>> FrameCB = nullptr;
-    std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
-    std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
-    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+    // The buffers are owned by the RenderDevice that created them.
+   // BufferHandle FrameCB = InvalidBuffer;
+    BufferHandle ObjectCB = InvalidBuffer;
+
+    // Every material, packed MaterialData elements in a structured buffer that the
+    // shaders index into.  Same per-frame rule as the cbuffers.
+    BufferHandle MaterialBuffer = InvalidBuffer;
 
     // We cannot update a dynamic vertex buffer until the GPU is done processing
     // the commands that reference it.  So each frame needs their own.
-    std::unique_ptr<UploadBuffer<Vertex>> WavesVB = nullptr;
+    BufferHandle WavesVB = InvalidBuffer;
+
+    // Data rewritten in full every frame, the pass constants and the instance records
+    // of the instanced block draws, is sub-allocated from here.  Reset at the start of
+    // the frame, once the fence says the GPU is done with the previous use.
+    std::unique_ptr<UploadArena> Arena;
+
+    // ExecuteIndirect records pointing into the frame's instance records, rebuilt from the culling results every frame.
+    BufferHandle IndirectArgsBuffer = InvalidBuffer;
+
+    // Elements of ObjectCB and MaterialBuffer that changed since this frame resource was
+    // last written.  Everything starts out dirty.
+    DirtyList DirtyObjects;
+    DirtyList DirtyMaterials;
+
+    // Buffer grows so far, the arena's included.
+    UINT Grows = 0;
 
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
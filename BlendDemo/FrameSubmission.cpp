@@ -0,0 +1,88 @@
+//***************************************************************************************
+// FrameSubmission.cpp
+//***************************************************************************************
+
+#include "FrameSubmission.h"
+
+void SubmitQueuedDraws(RenderContext& context, const RenderQueue& queue, const DrawRange& range,
+	const QueuedDraw* draws, const FrameBuffers& frame, DrawStateCache& state)
+{
+	state.Reset();
+
+	context.SetShaderResource(RootSlot_Material, frame.Material, 0);
+
+	for(std::uint32_t i = range.Begin; i < range.End; ++i)
+	{
+		const RenderQueueEntry& e = queue[i];
+		const QueuedDraw& draw = draws[e.Item];
+
+		if(state.SetPso(RenderQueue::KeyPso(e.Key)))
+			context.SetPipeline(RenderQueue::KeyPso(e.Key));
+
+		if(state.SetGeometry(draw.Geometry))
+			context.SetGeometry(draw.Vertices, draw.Indices);
+
+		if(state.SetTopology((std::uint32_t)draw.Topology))
+			context.SetTopology(draw.Topology);
+
+		if(state.SetMaterial(draw.Material))
+			context.SetTextureTable(RootSlot_Texture, draw.Texture);
+
+		context.SetConstantBuffer(RootSlot_Object, frame.Object, draw.Object);
+		state.SetObject();
+
+		context.DrawIndexed(draw.IndexCount, 1, draw.StartIndex, draw.BaseVertex, 0);
+		state.Draw();
+	}
+}
+
+void SubmitInstancedLayer(RenderContext& context, std::uint32_t pipeline, BufferHandle vertices, BufferHandle indices,
+	const IndirectArgsBuilder& args, std::uint32_t layer, const FrameBuffers& frame)
+{
+	std::uint32_t recordCount = args.LayerCount(layer);
+	if(recordCount == 0)
+		return;
+
+	context.SetPipeline(pipeline);
+	context.SetGeometry(vertices, indices);
+	context.SetTopology(PrimitiveTopology::TriangleList);
+
+	// Each record sets the instance offset root constant before its draw
+	context.SetShaderResource(RootSlot_Instances, frame.Instances, frame.InstancesElement);
+	context.SetTextureTable(RootSlot_BlockTextures, 0);
+	context.SetShaderResource(RootSlot_Material, frame.Material, 0);
+
+	context.DrawIndirect(frame.IndirectArgs, args.LayerOffset(layer), recordCount);
+}
+
+HeadlessRangeRecorder::HeadlessRangeRecorder(const RenderQueue& queue, const QueuedDraw* draws, std::uint32_t listCount)
+	: mQueue(queue), mDraws(draws), mStates(listCount)
+{
+}
+
+void HeadlessRangeRecorder::RecordRange(std::uint32_t list, const DrawRange& range)
+{
+	DrawStateCache& state = mStates[list];
+	state.Reset();
+
+	for(std::uint32_t i = range.Begin; i < range.End; ++i)
+	{
+		const RenderQueueEntry& e = mQueue[i];
+		const QueuedDraw& draw = mDraws[e.Item];
+
+		state.SetPso(RenderQueue::KeyPso(e.Key));
+		state.SetGeometry(draw.Geometry);
+		state.SetTopology((std::uint32_t)draw.Topology);
+		state.SetMaterial(draw.Material);
+		state.SetObject();
+		state.Draw();
+	}
+}
+
+RenderQueueStats HeadlessRangeRecorder::TotalStats()const
+{
+	RenderQueueStats total;
+	for(const auto& state : mStates)
+		total.Accumulate(state.Stats());
+	return total;
+}
@@ -0,0 +1,94 @@
+//***************************************************************************************
+// FrameSubmission.h
+//
+// Turns the sorted render queue and the instanced layers into RenderContext calls.
+// Everything here works on handles and indices only, so BlendApp records it into
+// D3D12 command lists and the benchmarks replay the same code on a RecordingBackend.
+//***************************************************************************************
+
+#pragma once
+
+#include "RenderBackend.h"
+#include "RenderQueue.h"
+#include "ParallelRecorder.h"
+#include "IndirectArgs.h"
+
+// Root parameter slots of BlendApp's root signature.
+enum RootSlot : std::uint32_t
+{
+	RootSlot_Texture = 0,
+	RootSlot_Object = 1,
+	RootSlot_Pass = 2,
+	RootSlot_Material = 3,
+	RootSlot_Instances = 4,
+	RootSlot_BlockTextures = 5,
+	RootSlot_InstanceOffset = 6
+};
+
+// The per-frame buffers the draws read from.  Elements of Object are indexed by the
+// draw's Object.  Material is the structured buffer of every material, bound whole;
+// shaders pick an element by the index in the object constants or the instance's
+// block id.  The pass constants and the instance records are single allocations that
+// start at PassElement and InstancesElement.
+struct FrameBuffers
+{
+	BufferHandle Pass = InvalidBuffer;
+	std::uint32_t PassElement = 0;
+	BufferHandle Object = InvalidBuffer;
+	BufferHandle Material = InvalidBuffer;
+	BufferHandle Instances = InvalidBuffer;
+	std::uint32_t InstancesElement = 0;
+	BufferHandle IndirectArgs = InvalidBuffer;
+};
+
+// One render queue item, flattened so recording does not chase render item pointers.
+// Geometry names the pair of Vertices and Indices, so binding them again can be
+// skipped; it is not taken from the key, which leaves it out in blended layers.
+struct QueuedDraw
+{
+	BufferHandle Vertices = InvalidBuffer;
+	BufferHandle Indices = InvalidBuffer;
+	std::uint32_t Geometry = 0;
+	PrimitiveTopology Topology = PrimitiveTopology::TriangleList;
+
+	std::uint32_t Texture = 0;
+	std::uint32_t Material = 0;
+	std::uint32_t Object = 0;
+
+	std::uint32_t IndexCount = 0;
+	std::uint32_t StartIndex = 0;
+	std::int32_t BaseVertex = 0;
+};
+
+// Records the queue entries in range.  The pipeline of each entry is the PSO field of
+// its key, the rest of its state comes from its draw; state already bound in this
+// range is not set again.  The material buffer is
+// bound once, and a change of material only changes the texture table.
+void SubmitQueuedDraws(RenderContext& context, const RenderQueue& queue, const DrawRange& range,
+	const QueuedDraw* draws, const FrameBuffers& frame, DrawStateCache& state);
+
+// Binds one mesh and submits the indirect records of an instanced layer.  The block id
+// of each instance is its material index, and the material names the texture in the
+// block texture table.
+void SubmitInstancedLayer(RenderContext& context, std::uint32_t pipeline, BufferHandle vertices, BufferHandle indices,
+	const IndirectArgsBuilder& args, std::uint32_t layer, const FrameBuffers& frame);
+
+// Replays ranges of a RenderQueue through a DrawStateCache per list instead of a
+// RenderContext, making the same state changes SubmitQueuedDraws would.  The stats
+// show how much state each range has to rebind because it starts from nothing, which
+// is the cost of splitting finer.
+class HeadlessRangeRecorder : public RangeRecorder
+{
+public:
+	HeadlessRangeRecorder(const RenderQueue& queue, const QueuedDraw* draws, std::uint32_t listCount);
+
+	virtual void RecordRange(std::uint32_t list, const DrawRange& range)override;
+
+	const RenderQueueStats& ListStats(std::uint32_t list)const { return mStates[list].Stats(); }
+	RenderQueueStats TotalStats()const;
+
+private:
+	const RenderQueue& mQueue;
+	const QueuedDraw* mDraws;
+	std::vector<DrawStateCache> mStates;
+};
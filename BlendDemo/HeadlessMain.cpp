@@ -0,0 +1,41 @@
+//***************************************************************************************
+// HeadlessMain.cpp
+//
+// Entry point of the BlendHeadless target, which builds everything that does not need
+// Direct3D or a window.  It runs the CPU checks, then the CPU benchmarks on the
+// RecordingBackend, so the frame pipeline can be tested and profiled on any machine.
+// BlendApp runs the same when built with BLEND_BENCHMARKS defined.
+//
+//   BlendHeadless            checks, then benchmarks
+//   BlendHeadless --checks   checks only
+//
+// Returns non-zero when a check failed.
+//***************************************************************************************
+
+#include "Benchmarks.h"
+#include "Checks.h"
+
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char* argv[])
+{
+	bool checksOnly = argc > 1 && std::strcmp(argv[1], "--checks") == 0;
+
+	std::vector<std::string> failures = RunCpuChecks();
+	for(const std::string& failure : failures)
+		std::printf("Check failed: %s\n", failure.c_str());
+	std::printf("%s\n", failures.empty() ? "All checks passed" : "Some checks failed");
+	std::fflush(stdout);
+
+	if(!checksOnly)
+	{
+		for(const BenchmarkResult& result : RunCpuBenchmarks())
+		{
+			std::printf("%s\n", result.ToString().c_str());
+			std::fflush(stdout);
+		}
+	}
+
+	return failures.empty() ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+//***************************************************************************************
+// IndirectArgs.cpp
+//***************************************************************************************
+
+#include "IndirectArgs.h"
+#include <cstring>
+
+void IndirectArgsBuilder::Reset(std::uint32_t layerCount)
+{
+	// Keep the inner vectors so their memory is reused from frame to frame.
+	if(mLayers.size() < layerCount)
+		mLayers.resize(layerCount);
+
+	for(auto& layer : mLayers)
+		layer.clear();
+
+	mLayerOffsets.assign(mLayers.size(), 0);
+}
+
+void IndirectArgsBuilder::AddDraw(std::uint32_t layer, const IndirectMesh& mesh, std::uint32_t instanceOffset, std::uint32_t instanceCount)
+{
+	if(instanceCount == 0 || mesh.IndexCount == 0)
+		return;
+
+	IndirectDrawArgs args;
+	args.InstanceDataOffset = instanceOffset;
+	args.IndexCountPerInstance = mesh.IndexCount;
+	args.InstanceCount = instanceCount;
+	args.StartIndexLocation = mesh.StartIndexLocation;
+	args.BaseVertexLocation = mesh.BaseVertexLocation;
+	args.StartInstanceLocation = 0;
+
+	mLayers[layer].push_back(args);
+}
+
+std::size_t IndirectArgsBuilder::Write(IndirectDrawArgs* dst)
+{
+	std::size_t written = 0;
+	for(std::size_t i = 0; i < mLayers.size(); ++i)
+	{
+		mLayerOffsets[i] = (std::uint32_t)written;
+
+		const auto& layer = mLayers[i];
+		if(!layer.empty())
+			std::memcpy(dst + written, layer.data(), layer.size() * sizeof(IndirectDrawArgs));
+
+		written += layer.size();
+	}
+
+	return written;
+}
+
+std::size_t IndirectArgsBuilder::RecordCount()const
+{
+	std::size_t count = 0;
+	for(const auto& layer : mLayers)
+		count += layer.size();
+	return count;
+}
@@ -0,0 +1,61 @@
+//***************************************************************************************
+// IndirectArgs.h
+//
+// Builds the argument records for ExecuteIndirect from the culled instance streams.
+// Each record is one DrawIndexedInstanced plus the root constant that tells the
+// instanced shader where its instances start, and records are grouped by layer so a
+// layer is submitted with a single ExecuteIndirect.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Layout of one indirect command: a root constant followed by
+// D3D12_DRAW_INDEXED_ARGUMENTS.  Must match the command signature built in BlendApp.
+struct IndirectDrawArgs
+{
+	std::uint32_t InstanceDataOffset;
+	std::uint32_t IndexCountPerInstance;
+	std::uint32_t InstanceCount;
+	std::uint32_t StartIndexLocation;
+	std::int32_t BaseVertexLocation;
+	std::uint32_t StartInstanceLocation;
+};
+
+static_assert(sizeof(IndirectDrawArgs) == 24, "IndirectDrawArgs must match the command signature stride.");
+
+// Where a mesh lives in its vertex and index buffers.
+struct IndirectMesh
+{
+	std::uint32_t IndexCount = 0;
+	std::uint32_t StartIndexLocation = 0;
+	std::int32_t BaseVertexLocation = 0;
+};
+
+class IndirectArgsBuilder
+{
+public:
+	// Forgets last frame's records and sizes for layerCount layers.
+	void Reset(std::uint32_t layerCount);
+
+	// Adds a draw of instanceCount instances of mesh, starting at instanceOffset in the
+	// instance stream.  Empty draws are dropped, so a layer can end up with no records.
+	void AddDraw(std::uint32_t layer, const IndirectMesh& mesh, std::uint32_t instanceOffset, std::uint32_t instanceCount);
+
+	// Writes every layer's records back to back into dst and returns the record count.
+	// dst needs room for RecordCount() records.
+	std::size_t Write(IndirectDrawArgs* dst);
+
+	std::size_t RecordCount()const;
+
+	// Valid after Write: where each layer's records start in dst, and how many it has.
+	std::uint32_t LayerOffset(std::uint32_t layer)const { return mLayerOffsets[layer]; }
+	std::uint32_t LayerCount(std::uint32_t layer)const { return (std::uint32_t)mLayers[layer].size(); }
+
+private:
+	std::vector<std::vector<IndirectDrawArgs>> mLayers;
+	std::vector<std::uint32_t> mLayerOffsets;
+};
@@ -0,0 +1,44 @@
+//***************************************************************************************
+// LinearAllocator.cpp
+//***************************************************************************************
+
+#include "LinearAllocator.h"
+
+#include <cassert>
+
+LinearAllocator::LinearAllocator(std::uint32_t capacity)
+	: mCapacity(capacity)
+{
+}
+
+std::uint32_t LinearAllocator::Allocate(std::uint32_t size, std::uint32_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	// 64-bit so that aligning or adding near the top of the range cannot wrap.
+	std::uint64_t offset = ((std::uint64_t)mUsed + alignment - 1) & ~(std::uint64_t)(alignment - 1);
+	std::uint64_t end = offset + size;
+
+	if(end > mCapacity)
+	{
+		mFailedAllocations++;
+		return InvalidOffset;
+	}
+
+	mUsed = (std::uint32_t)end;
+	if(mUsed > mHighWater)
+		mHighWater = mUsed;
+
+	return (std::uint32_t)offset;
+}
+
+void LinearAllocator::Reset()
+{
+	mUsed = 0;
+}
+
+void LinearAllocator::SetCapacity(std::uint32_t capacity)
+{
+	assert(mUsed == 0);
+	mCapacity = capacity;
+}
@@ -0,0 +1,44 @@
+//***************************************************************************************
+// LinearAllocator.h
+//
+// Bump allocator over a fixed range of bytes.  It hands out aligned offsets and frees
+// only all at once, which suits data written once per frame and dropped as soon as the
+// GPU has finished the frame.  It only does the offset arithmetic, so it knows nothing
+// about the memory behind the range.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+class LinearAllocator
+{
+public:
+	static const std::uint32_t InvalidOffset = 0xffffffff;
+
+	explicit LinearAllocator(std::uint32_t capacity = 0);
+
+	// Returns the offset of size bytes aligned to alignment, a power of two, or
+	// InvalidOffset when they do not fit.  A failed allocation changes nothing but
+	// the failure count, so the caller can fall back and carry on.
+	std::uint32_t Allocate(std::uint32_t size, std::uint32_t alignment);
+
+	// Frees every allocation.  Only call once nothing still reads them.
+	void Reset();
+
+	// Changes the size of the range.  Only valid while nothing is allocated.
+	void SetCapacity(std::uint32_t capacity);
+
+	std::uint32_t Capacity()const { return mCapacity; }
+	std::uint32_t Used()const { return mUsed; }
+
+	// Most bytes in use at once, and allocations that did not fit, since construction.
+	std::uint32_t HighWater()const { return mHighWater; }
+	std::uint32_t FailedAllocations()const { return mFailedAllocations; }
+
+private:
+	std::uint32_t mCapacity = 0;
+	std::uint32_t mUsed = 0;
+	std::uint32_t mHighWater = 0;
+	std::uint32_t mFailedAllocations = 0;
+};
@@ -0,0 +1,208 @@
+//***************************************************************************************
+// MappedRegion.cpp
+//***************************************************************************************
+
+#include "MappedRegion.h"
+
+#include <cassert>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedRegion::~MappedRegion()
+{
+	Close();
+}
+
+bool MappedRegion::Open(const std::string& path, RegionAccess access)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+		OPEN_EXISTING, access == RegionAccess_Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size) || size.QuadPart < RegionSectorBytes)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if(view == nullptr)
+	{
+		if(mapping != nullptr)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFile = file;
+	mMapping = mapping;
+	mData = static_cast<const std::uint8_t*>(view);
+	mSize = std::size_t(size.QuadPart);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if(file < 0)
+		return false;
+
+	struct stat status;
+	if(fstat(file, &status) != 0 || status.st_size < (off_t)RegionSectorBytes)
+	{
+		close(file);
+		return false;
+	}
+
+	// The mapping keeps the file referenced, so the descriptor can go straight away.
+	void* view = mmap(nullptr, std::size_t(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if(view == MAP_FAILED)
+		return false;
+
+	mData = static_cast<const std::uint8_t*>(view);
+	mSize = std::size_t(status.st_size);
+#endif
+
+	Advise(access);
+	return true;
+}
+
+void MappedRegion::Close()
+{
+	if(mData == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(mData);
+	CloseHandle(mMapping);
+	CloseHandle(mFile);
+	mFile = nullptr;
+	mMapping = nullptr;
+#else
+	munmap(const_cast<std::uint8_t*>(mData), mSize);
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+}
+
+void MappedRegion::Advise(RegionAccess access)
+{
+	if(mData == nullptr)
+		return;
+
+#ifdef _WIN32
+	// Windows has no per-mapping access pattern; the file was opened with the matching
+	// cache hint, and a scan of the whole file gets its pages read in up front.
+#if _WIN32_WINNT >= _WIN32_WINNT_WIN8
+	if(access == RegionAccess_Sequential)
+	{
+		WIN32_MEMORY_RANGE_ENTRY range = { const_cast<std::uint8_t*>(mData), mSize };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#endif
+#else
+	void* start = const_cast<std::uint8_t*>(mData);
+	if(access == RegionAccess_Sequential)
+	{
+		madvise(start, mSize, MADV_SEQUENTIAL);
+		madvise(start, mSize, MADV_WILLNEED);
+	}
+	else
+	{
+		madvise(start, mSize, MADV_RANDOM);
+	}
+#endif
+}
+
+bool MappedRegion::HasChunk(std::uint32_t lx, std::uint32_t lz)const
+{
+	assert(lx < RegionChunks && lz < RegionChunks);
+	return mData != nullptr && RegionTableEntry(mData, RegionEntryIndex(lx, lz)) != 0;
+}
+
+bool MappedRegion::ReadChunk(std::uint32_t lx, std::uint32_t lz, ChunkPayload& payload)const
+{
+	assert(lx < RegionChunks && lz < RegionChunks);
+	if(mData == nullptr)
+		return false;
+
+	std::uint32_t entry = RegionTableEntry(mData, RegionEntryIndex(lx, lz));
+	std::size_t first = std::size_t(RegionEntryOffset(entry)) * RegionSectorBytes;
+	std::size_t bytes = std::size_t(RegionEntrySectors(entry)) * RegionSectorBytes;
+	if(entry == 0 || first == 0 || first + bytes > mSize)
+		return false;
+
+	return ParseChunkPayload(mData + first, bytes, payload);
+}
+
+RegionMapCache::RegionMapCache(const std::string& prefix, RegionAccess access, std::size_t capacity) :
+	mPrefix(prefix),
+	mAccess(access),
+	mCapacity(capacity)
+{
+	assert(capacity > 0);
+}
+
+const MappedRegion* RegionMapCache::Find(std::uint32_t rx, std::uint32_t ry, std::uint32_t rz)
+{
+	std::uint64_t key = Key(rx, ry, rz);
+	auto found = mRegions.find(key);
+	if(found != mRegions.end())
+	{
+		found->second.LastUse = ++mUseClock;
+		return found->second.Region.get();
+	}
+
+	if(mRegions.size() >= mCapacity)
+	{
+		auto oldest = mRegions.begin();
+		for(auto i = mRegions.begin(); i != mRegions.end(); ++i)
+		{
+			if(i->second.LastUse < oldest->second.LastUse)
+				oldest = i;
+		}
+		mRegions.erase(oldest);
+	}
+
+	Entry& entry = mRegions[key];
+	entry.LastUse = ++mUseClock;
+
+	std::unique_ptr<MappedRegion> region = std::make_unique<MappedRegion>();
+	if(region->Open(RegionPath(mPrefix, rx, ry, rz), mAccess))
+		entry.Region = std::move(region);
+
+	return entry.Region.get();
+}
+
+bool RegionMapCache::ReadChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, ChunkPayload& payload)
+{
+	const MappedRegion* region = Find(cx / RegionChunks, cy, cz / RegionChunks);
+	return region != nullptr && region->ReadChunk(cx % RegionChunks, cz % RegionChunks, payload);
+}
+
+void RegionMapCache::Evict(std::uint32_t rx, std::uint32_t ry, std::uint32_t rz)
+{
+	mRegions.erase(Key(rx, ry, rz));
+}
+
+void RegionMapCache::Clear()
+{
+	mRegions.clear();
+}
+
+std::uint64_t RegionMapCache::Key(std::uint32_t rx, std::uint32_t ry, std::uint32_t rz)
+{
+	assert(rx < (1u << 21) && ry < (1u << 21) && rz < (1u << 21));
+	return std::uint64_t(rx) | std::uint64_t(ry) << 21 | std::uint64_t(rz) << 42;
+}
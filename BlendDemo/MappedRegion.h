@@ -0,0 +1,107 @@
+//***************************************************************************************
+// MappedRegion.h
+//
+// The read path for region files when many chunks load at once.  The whole file is
+// mapped read-only and chunks are decoded straight from the mapped pages: no read
+// call and no copy into a buffer per chunk, and the page cache does the I/O.  An
+// access hint tells the OS whether a region is about to be scanned end to end, as
+// when a world is loaded or pre-generated, or read a chunk here and there in play.
+//
+// RegionMapCache keeps the mappings of the regions in use, keyed by region
+// coordinate, so streaming chunks in does not map a file per chunk.
+//***************************************************************************************
+
+#pragma once
+
+#include "RegionFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+enum RegionAccess : std::uint32_t
+{
+	// Every chunk in turn: read ahead aggressively and prefetch the whole file.
+	RegionAccess_Sequential = 0,
+
+	// Chunks in no particular order: read only the pages that are touched.
+	RegionAccess_Random
+};
+
+class MappedRegion
+{
+public:
+	MappedRegion() = default;
+	MappedRegion(const MappedRegion&) = delete;
+	MappedRegion& operator=(const MappedRegion&) = delete;
+	~MappedRegion();
+
+	// Maps the region at path.  Returns false when it is missing, too short for its
+	// table or cannot be mapped.
+	bool Open(const std::string& path, RegionAccess access);
+	void Close();
+
+	bool IsOpen()const { return mData != nullptr; }
+
+	// Changes the access hint of an open region.
+	void Advise(RegionAccess access);
+
+	bool HasChunk(std::uint32_t lx, std::uint32_t lz)const;
+
+	// Points payload at the encoded blocks of chunk lx, lz in the mapping, good until the
+	// region is closed.  Returns false when the chunk is not stored or runs past the end
+	// of the file.
+	bool ReadChunk(std::uint32_t lx, std::uint32_t lz, ChunkPayload& payload)const;
+
+	std::size_t Size()const { return mSize; }
+
+private:
+	const std::uint8_t* mData = nullptr;
+	std::size_t mSize = 0;
+
+#ifdef _WIN32
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#endif
+};
+
+// The mapped regions of the save at a prefix, opened on first use.  Regions with no
+// file are remembered too, so asking for their chunks again costs nothing.  Past
+// capacity the least recently used region is unmapped.
+class RegionMapCache
+{
+public:
+	RegionMapCache(const std::string& prefix, RegionAccess access, std::size_t capacity = 64);
+
+	// The region, or nullptr when it has no file.  Good until the next call to Find or
+	// Evict.
+	const MappedRegion* Find(std::uint32_t rx, std::uint32_t ry, std::uint32_t rz);
+
+	// Points payload at the encoded blocks of chunk cx, cy, cz, given in world chunk
+	// coordinates, in its region's mapping.  Good until the next call to Find, ReadChunk
+	// or Evict.  Returns false when the chunk is not stored.
+	bool ReadChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, ChunkPayload& payload);
+
+	// Unmaps a region, say after its file was rewritten, or all of them.
+	void Evict(std::uint32_t rx, std::uint32_t ry, std::uint32_t rz);
+	void Clear();
+
+	std::size_t MappedCount()const { return mRegions.size(); }
+
+private:
+	struct Entry
+	{
+		std::unique_ptr<MappedRegion> Region;
+		std::uint64_t LastUse = 0;
+	};
+
+	static std::uint64_t Key(std::uint32_t rx, std::uint32_t ry, std::uint32_t rz);
+
+	std::string mPrefix;
+	RegionAccess mAccess;
+	std::size_t mCapacity;
+	std::uint64_t mUseClock = 0;
+
+	std::unordered_map<std::uint64_t, Entry> mRegions;
+};
@@ -0,0 +1,133 @@
+//***************************************************************************************
+// MeshCache.cpp
+//***************************************************************************************
+
+#include "MeshCache.h"
+
+#include <cassert>
+
+namespace
+{
+	// An entry is the mesher version as four bytes, the snapshot hash as eight and the
+	// cell count as four, then two bytes per cell, all little-endian.
+	const std::size_t EntryHeaderBytes = 16;
+
+	void PutUnsigned(std::vector<std::uint8_t>& out, std::uint64_t value, std::uint32_t bytes)
+	{
+		for(std::uint32_t i = 0; i < bytes; ++i)
+			out.push_back(std::uint8_t(value >> (8 * i)));
+	}
+
+	std::uint64_t GetUnsigned(const std::uint8_t* at, std::uint32_t bytes)
+	{
+		std::uint64_t value = 0;
+		for(std::uint32_t i = 0; i < bytes; ++i)
+			value |= std::uint64_t(at[i]) << (8 * i);
+		return value;
+	}
+}
+
+MeshCache::MeshCache(const std::string& prefix, std::size_t capacity) :
+	mPrefix(prefix),
+	mCapacity(capacity)
+{
+	assert(capacity > 0);
+}
+
+bool MeshCache::Find(const ChunkCoord& chunk, std::uint64_t hash, std::vector<MeshCell>& cells)
+{
+	cells.clear();
+
+	RegionFile* region = Region(chunk, false);
+	ChunkPayload payload;
+	if(region == nullptr || !region->ReadChunk(chunk.X % RegionChunks, chunk.Z % RegionChunks, mBuffer, payload))
+	{
+		mStats.Misses++;
+		return false;
+	}
+
+	const std::uint8_t* data = payload.Data;
+	if(payload.Codec != ChunkCodec_Mesh || payload.Size < EntryHeaderBytes ||
+		GetUnsigned(data, 4) != MesherVersion || GetUnsigned(data + 4, 8) != hash)
+	{
+		mStats.Misses++;
+		mStats.Stale++;
+		return false;
+	}
+
+	std::size_t count = (std::size_t)GetUnsigned(data + 12, 4);
+	if(payload.Size != EntryHeaderBytes + count * sizeof(MeshCell))
+	{
+		mStats.Misses++;
+		mStats.Stale++;
+		return false;
+	}
+
+	cells.resize(count);
+	for(std::size_t i = 0; i < count; ++i)
+		cells[i] = MeshCell(GetUnsigned(data + EntryHeaderBytes + i * sizeof(MeshCell), sizeof(MeshCell)));
+
+	mStats.Hits++;
+	mStats.BytesRead += payload.Size;
+	return true;
+}
+
+bool MeshCache::Store(const ChunkCoord& chunk, std::uint64_t hash, const std::vector<MeshCell>& cells)
+{
+	RegionFile* region = Region(chunk, true);
+	if(region == nullptr)
+		return false;
+
+	mBuffer.clear();
+	PutUnsigned(mBuffer, MesherVersion, 4);
+	PutUnsigned(mBuffer, hash, 8);
+	PutUnsigned(mBuffer, cells.size(), 4);
+	for(MeshCell cell : cells)
+		PutUnsigned(mBuffer, cell, sizeof(MeshCell));
+
+	if(!region->WriteChunk(chunk.X % RegionChunks, chunk.Z % RegionChunks, ChunkCodec_Mesh, mBuffer.data(), mBuffer.size()))
+		return false;
+
+	mStats.BytesWritten += mBuffer.size();
+	return true;
+}
+
+void MeshCache::Close()
+{
+	mRegions.clear();
+}
+
+RegionFile* MeshCache::Region(const ChunkCoord& chunk, bool create)
+{
+	std::uint32_t rx = chunk.X / RegionChunks;
+	std::uint32_t rz = chunk.Z / RegionChunks;
+	assert(rx < (1u << 21) && chunk.Y < (1u << 21) && rz < (1u << 21));
+	std::uint64_t key = std::uint64_t(rx) | std::uint64_t(chunk.Y) << 21 | std::uint64_t(rz) << 42;
+
+	auto found = mRegions.find(key);
+	if(found != mRegions.end())
+	{
+		found->second.LastUse = ++mUseClock;
+		if(found->second.Region != nullptr || !create)
+			return found->second.Region.get();
+	}
+	else if(mRegions.size() >= mCapacity)
+	{
+		auto oldest = mRegions.begin();
+		for(auto i = mRegions.begin(); i != mRegions.end(); ++i)
+		{
+			if(i->second.LastUse < oldest->second.LastUse)
+				oldest = i;
+		}
+		mRegions.erase(oldest);
+	}
+
+	std::unique_ptr<RegionFile> region = std::make_unique<RegionFile>();
+	bool opened = region->Open(RegionPath(mPrefix, rx, chunk.Y, rz), create);
+
+	Entry& entry = mRegions[key];
+	entry.LastUse = ++mUseClock;
+	if(opened)
+		entry.Region = std::move(region);
+	return entry.Region.get();
+}
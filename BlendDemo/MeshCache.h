@@ -0,0 +1,85 @@
+//***************************************************************************************
+// MeshCache.h
+//
+// Finished chunk meshes kept on disk, so a warm start, or a chunk seen again after
+// its mesh was evicted, skips the mesher.  A chunk's entry holds its mesh cells with
+// the mesher version that made them and a hash of the snapshot they were made from,
+// the chunk and its apron.  An entry is only used when both still match; anything
+// else is a miss, and the chunk's new mesh then overwrites the stale entry in place.
+//
+// Entries live in region files of their own, one slot per chunk, next to the world's
+// save.  Cells hold no world position or block ids, so the cache stays good when those
+// change.
+//***************************************************************************************
+
+#pragma once
+
+#include "ChunkMesher.h"
+#include "RegionFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct MeshCacheStats
+{
+	std::uint64_t Hits = 0;
+
+	// Chunks that had to be meshed, and of those the ones whose entry was made from
+	// other blocks or by another mesher version.
+	std::uint64_t Misses = 0;
+	std::uint64_t Stale = 0;
+
+	std::uint64_t BytesRead = 0;
+	std::uint64_t BytesWritten = 0;
+};
+
+class MeshCache
+{
+public:
+	// Keeps its regions at prefix.rx.ry.rz.region, with at most capacity of them open.
+	// A region file is only created by the first Store into it, so lookups alone leave
+	// nothing on disk.
+	explicit MeshCache(const std::string& prefix, std::size_t capacity = 8);
+	MeshCache(const MeshCache&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+
+	// Reads the cells of chunk into cells, which is cleared first, when its entry was made
+	// by this MesherVersion from a snapshot hashing to hash.
+	bool Find(const ChunkCoord& chunk, std::uint64_t hash, std::vector<MeshCell>& cells);
+
+	// Makes cells the chunk's entry for a snapshot hashing to hash.  Returns false when
+	// it cannot be written, which leaves the chunk to be meshed next time.
+	bool Store(const ChunkCoord& chunk, std::uint64_t hash, const std::vector<MeshCell>& cells);
+
+	// Closes every region file.
+	void Close();
+
+	const MeshCacheStats& Stats()const { return mStats; }
+
+	// The cache's prefix for the save at worldPrefix.
+	static std::string PrefixFor(const std::string& worldPrefix) { return worldPrefix + ".mesh"; }
+
+private:
+	// Region is null for a region file found missing, so it is not looked for again
+	// until a Store creates it.
+	struct Entry
+	{
+		std::unique_ptr<RegionFile> Region;
+		std::uint64_t LastUse = 0;
+	};
+
+	// The region file of chunk, created when there is none and create is set.  Null when
+	// there is none or it cannot be opened.
+	RegionFile* Region(const ChunkCoord& chunk, bool create);
+
+	std::string mPrefix;
+	std::size_t mCapacity;
+	std::uint64_t mUseClock = 0;
+	std::unordered_map<std::uint64_t, Entry> mRegions;
+
+	std::vector<std::uint8_t> mBuffer;
+	MeshCacheStats mStats;
+};
@@ -0,0 +1,100 @@
+//***************************************************************************************
+// Morton.h
+//
+// Z-order (Morton) codes for 3D block coordinates of up to 10 bits per axis.  The bits
+// of x, y and z are interleaved, x lowest, so blocks that are close in space are
+// mostly close in memory too and a block's neighbours share its cache lines far more
+// often than in a row-major layout.  Encoding and decoding use BMI2's pdep and pext
+// where the build allows it, and the usual shift-and-mask spreading otherwise.
+// Stepping to a neighbour works on the code directly, without decoding it.
+//***************************************************************************************
+
+#pragma once
+
+#include "Simd.h"
+
+#include <cstdint>
+
+// The bits of each axis in a Morton code.
+const std::uint32_t MortonMaskX = 0x09249249;
+const std::uint32_t MortonMaskY = MortonMaskX << 1;
+const std::uint32_t MortonMaskZ = MortonMaskX << 2;
+
+// Spreads the low 10 bits of v two bits apart.
+inline std::uint32_t MortonSpread(std::uint32_t v)
+{
+	v &= 0x3ff;
+	v = (v | (v << 16)) & 0x030000ff;
+	v = (v | (v << 8)) & 0x0300f00f;
+	v = (v | (v << 4)) & 0x030c30c3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+// Inverse of MortonSpread.
+inline std::uint32_t MortonCompact(std::uint32_t v)
+{
+	v &= 0x09249249;
+	v = (v | (v >> 2)) & 0x030c30c3;
+	v = (v | (v >> 4)) & 0x0300f00f;
+	v = (v | (v >> 8)) & 0x030000ff;
+	v = (v | (v >> 16)) & 0x000003ff;
+	return v;
+}
+
+// The shift-and-mask encoding, which MortonEncode falls back on without BMI2.  Its
+// decoding is MortonCompact of the code shifted down to the axis.
+inline std::uint32_t MortonEncodeSpread(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+{
+	return MortonSpread(x) | (MortonSpread(y) << 1) | (MortonSpread(z) << 2);
+}
+
+inline std::uint32_t MortonEncode(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+{
+#if BLEND_BMI2
+	return _pdep_u32(x, MortonMaskX) | _pdep_u32(y, MortonMaskY) | _pdep_u32(z, MortonMaskZ);
+#else
+	return MortonEncodeSpread(x, y, z);
+#endif
+}
+
+inline std::uint32_t MortonDecodeX(std::uint32_t code)
+{
+#if BLEND_BMI2
+	return _pext_u32(code, MortonMaskX);
+#else
+	return MortonCompact(code);
+#endif
+}
+
+inline std::uint32_t MortonDecodeY(std::uint32_t code)
+{
+#if BLEND_BMI2
+	return _pext_u32(code, MortonMaskY);
+#else
+	return MortonCompact(code >> 1);
+#endif
+}
+
+inline std::uint32_t MortonDecodeZ(std::uint32_t code)
+{
+#if BLEND_BMI2
+	return _pext_u32(code, MortonMaskZ);
+#else
+	return MortonCompact(code >> 2);
+#endif
+}
+
+// Adds one to or takes one from the axis of code selected by mask, leaving the other
+// axes alone.  Filling the other axes' bits with ones carries an increment straight
+// through them, and clearing them does the same for a borrow.  Stepping past the edge
+// of the mask wraps, so callers check bounds first.
+inline std::uint32_t MortonIncrement(std::uint32_t code, std::uint32_t mask)
+{
+	return (((code | ~mask) + 1) & mask) | (code & ~mask);
+}
+
+inline std::uint32_t MortonDecrement(std::uint32_t code, std::uint32_t mask)
+{
+	return (((code & mask) - 1) & mask) | (code & ~mask);
+}
@@ -0,0 +1,179 @@
+//***************************************************************************************
+// ObjectPool.h
+//
+// Typed pool for objects that are created and destroyed at runtime, such as render
+// items.  Objects live in fixed size pages, so they stay at the same address for their
+// whole life and neighbours share cache lines.  Creating and destroying are O(1)
+// through a free list, and ForEach walks the live objects in memory order.
+//
+// Objects are named by handles: a slot index plus the generation of the slot.  A slot's
+// generation changes when its object is destroyed, so a handle kept past the object's
+// life no longer resolves instead of silently naming whatever reuses the slot.
+//***************************************************************************************
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template<typename T>
+struct PoolHandle
+{
+	static const std::uint32_t InvalidIndex = 0xffffffff;
+
+	std::uint32_t Index = InvalidIndex;
+	std::uint32_t Generation = 0;
+
+	bool Valid()const { return Index != InvalidIndex; }
+
+	bool operator==(const PoolHandle& rhs)const { return Index == rhs.Index && Generation == rhs.Generation; }
+	bool operator!=(const PoolHandle& rhs)const { return !(*this == rhs); }
+};
+
+template<typename T, std::uint32_t PageSize = 256>
+class ObjectPool
+{
+public:
+	typedef PoolHandle<T> Handle;
+
+	ObjectPool() = default;
+	ObjectPool(const ObjectPool& rhs) = delete;
+	ObjectPool& operator=(const ObjectPool& rhs) = delete;
+
+	~ObjectPool()
+	{
+		Clear();
+	}
+
+	// Constructs an object from args in a free slot, the most recently freed first.
+	template<typename... Args>
+	Handle Create(Args&&... args)
+	{
+		std::uint32_t index;
+		if(!mFree.empty())
+		{
+			index = mFree.back();
+			mFree.pop_back();
+		}
+		else
+		{
+			index = (std::uint32_t)mGenerations.size();
+			if(index % PageSize == 0)
+				mPages.push_back(std::unique_ptr<Page>(new Page()));
+
+			mGenerations.push_back(0);
+			mAlive.push_back(0);
+		}
+
+		new(Slot(index)) T(std::forward<Args>(args)...);
+		mAlive[index] = 1;
+		mSize++;
+
+		Handle handle;
+		handle.Index = index;
+		handle.Generation = mGenerations[index];
+		return handle;
+	}
+
+	// Destroys the object and frees its slot.  Stale handles are ignored.
+	void Destroy(Handle handle)
+	{
+		if(Get(handle) == nullptr)
+			return;
+
+		Slot(handle.Index)->~T();
+		mAlive[handle.Index] = 0;
+		mGenerations[handle.Index]++;
+		mFree.push_back(handle.Index);
+		mSize--;
+	}
+
+	// The object, or null when the handle is stale or invalid.
+	T* Get(Handle handle)
+	{
+		return Alive(handle) ? Slot(handle.Index) : nullptr;
+	}
+
+	const T* Get(Handle handle)const
+	{
+		return Alive(handle) ? Slot(handle.Index) : nullptr;
+	}
+
+	bool Alive(Handle handle)const
+	{
+		return handle.Index < mGenerations.size() && mAlive[handle.Index] != 0 &&
+			mGenerations[handle.Index] == handle.Generation;
+	}
+
+	// Calls fn(T&) for every live object, in slot order, which is memory order.
+	template<typename Fn>
+	void ForEach(Fn fn)
+	{
+		for(std::uint32_t i = 0; i < (std::uint32_t)mAlive.size(); ++i)
+		{
+			if(mAlive[i] != 0)
+				fn(*Slot(i));
+		}
+	}
+
+	template<typename Fn>
+	void ForEach(Fn fn)const
+	{
+		for(std::uint32_t i = 0; i < (std::uint32_t)mAlive.size(); ++i)
+		{
+			if(mAlive[i] != 0)
+				fn(*Slot(i));
+		}
+	}
+
+	// Destroys every object.  Pages are kept for reuse, and every handle goes stale.
+	void Clear()
+	{
+		mFree.clear();
+		for(std::uint32_t i = (std::uint32_t)mAlive.size(); i-- > 0;)
+		{
+			if(mAlive[i] != 0)
+			{
+				Slot(i)->~T();
+				mAlive[i] = 0;
+				mGenerations[i]++;
+			}
+			mFree.push_back(i);
+		}
+		mSize = 0;
+	}
+
+	// Live objects, and slots in the pages allocated so far.
+	std::uint32_t Size()const { return mSize; }
+	std::uint32_t Capacity()const { return (std::uint32_t)mPages.size() * PageSize; }
+
+private:
+	struct Page
+	{
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type Slots[PageSize];
+	};
+
+	T* Slot(std::uint32_t index)
+	{
+		return reinterpret_cast<T*>(&mPages[index / PageSize]->Slots[index % PageSize]);
+	}
+
+	const T* Slot(std::uint32_t index)const
+	{
+		return reinterpret_cast<const T*>(&mPages[index / PageSize]->Slots[index % PageSize]);
+	}
+
+	std::vector<std::unique_ptr<Page>> mPages;
+
+	// Per slot: the current generation, and whether an object lives there.
+	std::vector<std::uint32_t> mGenerations;
+	std::vector<std::uint8_t> mAlive;
+
+	std::vector<std::uint32_t> mFree;
+	std::uint32_t mSize = 0;
+};
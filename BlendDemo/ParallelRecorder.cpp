@@ -0,0 +1,57 @@
+//***************************************************************************************
+// ParallelRecorder.cpp
+//***************************************************************************************
+
+#include "ParallelRecorder.h"
+
+void SplitDrawRanges(std::size_t itemCount, std::uint32_t maxRanges, std::uint32_t minItemsPerRange,
+	std::vector<DrawRange>& ranges)
+{
+	ranges.clear();
+	if(itemCount == 0 || maxRanges == 0)
+		return;
+
+	if(minItemsPerRange == 0)
+		minItemsPerRange = 1;
+
+	std::size_t rangeCount = itemCount / minItemsPerRange;
+	if(rangeCount < 1)
+		rangeCount = 1;
+	if(rangeCount > maxRanges)
+		rangeCount = maxRanges;
+
+	// Spread the remainder over the first ranges so sizes differ by at most one.
+	std::size_t base = itemCount / rangeCount;
+	std::size_t extra = itemCount % rangeCount;
+
+	std::uint32_t begin = 0;
+	for(std::size_t i = 0; i < rangeCount; ++i)
+	{
+		DrawRange r;
+		r.Begin = begin;
+		r.End = begin + (std::uint32_t)(base + (i < extra ? 1 : 0));
+		ranges.push_back(r);
+		begin = r.End;
+	}
+}
+
+ParallelRecorder::ParallelRecorder(std::uint32_t listCount)
+	: mListCount(listCount > 0 ? listCount : 1)
+{
+	mPool = std::make_unique<WorkerPool>(mListCount - 1);
+	mRanges.reserve(mListCount);
+}
+
+const std::vector<DrawRange>& ParallelRecorder::Split(std::size_t itemCount, std::uint32_t minItemsPerRange)
+{
+	SplitDrawRanges(itemCount, mListCount, minItemsPerRange, mRanges);
+	return mRanges;
+}
+
+void ParallelRecorder::Record(RangeRecorder& recorder)
+{
+	mPool->Run((std::uint32_t)mRanges.size(), [&](std::uint32_t list)
+	{
+		recorder.RecordRange(list, mRanges[list]);
+	});
+}
@@ -0,0 +1,64 @@
+//***************************************************************************************
+// ParallelRecorder.h
+//
+// Splits a sorted list of draws into contiguous ranges and records the ranges on
+// worker threads, one command list per range.  The lists are submitted in range order,
+// so the result draws exactly what a single list would have.  What "recording" means
+// is left to a RangeRecorder, which lets the splitting and scheduling run without a GPU;
+// FrameSubmission.h has one that only replays the state changes.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "RenderQueue.h"
+#include "WorkerPool.h"
+
+// Half open range [Begin, End) of queue entries recorded into one command list.
+struct DrawRange
+{
+	std::uint32_t Begin = 0;
+	std::uint32_t End = 0;
+};
+
+class RangeRecorder
+{
+public:
+	virtual ~RangeRecorder() = default;
+
+	// Called on a worker thread.  list is the index of the range and of the command
+	// list it goes into; no two calls in a batch share a list.
+	virtual void RecordRange(std::uint32_t list, const DrawRange& range) = 0;
+};
+
+// Splits itemCount items into at most maxRanges ranges of near equal size, using fewer
+// ranges when there are not minItemsPerRange items for each.  Empty input gives no ranges.
+void SplitDrawRanges(std::size_t itemCount, std::uint32_t maxRanges, std::uint32_t minItemsPerRange,
+	std::vector<DrawRange>& ranges);
+
+class ParallelRecorder
+{
+public:
+	// listCount is the most ranges a frame is split into.  The calling thread records
+	// one of them, so listCount - 1 worker threads are started.
+	explicit ParallelRecorder(std::uint32_t listCount);
+
+	std::uint32_t ListCount()const { return mListCount; }
+
+	// Decides the ranges for this frame.  The caller gets them back so it can prepare
+	// one command list per range before calling Record.
+	const std::vector<DrawRange>& Split(std::size_t itemCount, std::uint32_t minItemsPerRange);
+
+	// Records every range from the last Split in parallel and returns once all are done.
+	void Record(RangeRecorder& recorder);
+
+	const std::vector<DrawRange>& Ranges()const { return mRanges; }
+
+private:
+	std::uint32_t mListCount = 1;
+	std::unique_ptr<WorkerPool> mPool;
+	std::vector<DrawRange> mRanges;
+};
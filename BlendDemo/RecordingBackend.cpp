@@ -0,0 +1,54 @@
+//***************************************************************************************
+// RecordingBackend.cpp
+//***************************************************************************************
+
+#include "RecordingBackend.h"
+
+#include <cstring>
+#include <utility>
+
+std::uint32_t RecordingRenderDevice::ElementStride(BufferHandle buffer)const
+{
+	return mBuffers[buffer].Stride;
+}
+
+std::uint32_t RecordingRenderDevice::ElementCount(BufferHandle buffer)const
+{
+	return mBuffers[buffer].Desc.ElementCount;
+}
+
+BufferHandle RecordingRenderDevice::OnCreateBuffer(const BufferDesc& desc, const void* initialData)
+{
+	Buffer buffer;
+	buffer.Desc = desc;
+
+	// Same placement rule as the D3D12 backend, so byte counts match.
+	buffer.Stride = desc.Usage == BufferUsage::Constant ? (desc.ElementByteSize + 255) & ~255u : desc.ElementByteSize;
+	buffer.Data.resize((std::size_t)buffer.Stride * desc.ElementCount);
+
+	// Initial data is packed, one ElementByteSize after another.
+	if(initialData != nullptr)
+	{
+		for(std::uint32_t i = 0; i < desc.ElementCount; ++i)
+		{
+			std::memcpy(buffer.Data.data() + (std::size_t)buffer.Stride * i,
+				static_cast<const std::uint8_t*>(initialData) + (std::size_t)desc.ElementByteSize * i, desc.ElementByteSize);
+		}
+	}
+
+	mBuffers.push_back(std::move(buffer));
+	return (BufferHandle)(mBuffers.size() - 1);
+}
+
+void RecordingRenderDevice::OnGrowBuffer(BufferHandle buffer, std::uint32_t elementCount)
+{
+	Buffer& b = mBuffers[buffer];
+	b.Desc.ElementCount = elementCount;
+	b.Data.resize((std::size_t)b.Stride * elementCount);
+}
+
+std::uint8_t* RecordingRenderDevice::OnMapElements(BufferHandle buffer, std::uint32_t first)
+{
+	Buffer& b = mBuffers[buffer];
+	return b.Data.data() + (std::size_t)b.Stride * first;
+}
@@ -0,0 +1,49 @@
+//***************************************************************************************
+// RecordingBackend.h
+//
+// A RenderDevice and RenderContext that need no GPU.  Buffers are plain CPU memory and
+// commands are only counted, so the frame pipeline can be run and timed headless.
+//***************************************************************************************
+
+#pragma once
+
+#include <vector>
+#include "RenderBackend.h"
+
+class RecordingRenderDevice : public RenderDevice
+{
+public:
+	virtual std::uint32_t ElementStride(BufferHandle buffer)const override;
+	virtual std::uint32_t ElementCount(BufferHandle buffer)const override;
+
+	// Contents of a buffer, for checking what the frame wrote.
+	const std::uint8_t* BufferData(BufferHandle buffer)const { return mBuffers[buffer].Data.data(); }
+
+protected:
+	virtual BufferHandle OnCreateBuffer(const BufferDesc& desc, const void* initialData)override;
+	virtual void OnGrowBuffer(BufferHandle buffer, std::uint32_t elementCount)override;
+	virtual std::uint8_t* OnMapElements(BufferHandle buffer, std::uint32_t first)override;
+
+private:
+	struct Buffer
+	{
+		BufferDesc Desc;
+		std::uint32_t Stride = 0;
+		std::vector<std::uint8_t> Data;
+	};
+
+	std::vector<Buffer> mBuffers;
+};
+
+class RecordingRenderContext : public RenderContext
+{
+protected:
+	virtual void OnSetPipeline(std::uint32_t)override {}
+	virtual void OnSetGeometry(BufferHandle, BufferHandle)override {}
+	virtual void OnSetTopology(PrimitiveTopology)override {}
+	virtual void OnSetTextureTable(std::uint32_t, std::uint32_t)override {}
+	virtual void OnSetConstantBuffer(std::uint32_t, BufferHandle, std::uint32_t)override {}
+	virtual void OnSetShaderResource(std::uint32_t, BufferHandle, std::uint32_t)override {}
+	virtual void OnDrawIndexed(std::uint32_t, std::uint32_t, std::uint32_t, std::int32_t, std::uint32_t)override {}
+	virtual void OnDrawIndirect(BufferHandle, std::uint32_t, std::uint32_t)override {}
+};
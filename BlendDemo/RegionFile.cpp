@@ -0,0 +1,239 @@
+//***************************************************************************************
+// RegionFile.cpp
+//***************************************************************************************
+
+#include "RegionFile.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+	void PutU32(std::uint8_t* at, std::uint32_t value)
+	{
+		at[0] = std::uint8_t(value);
+		at[1] = std::uint8_t(value >> 8);
+		at[2] = std::uint8_t(value >> 16);
+		at[3] = std::uint8_t(value >> 24);
+	}
+
+	std::uint32_t GetU32(const std::uint8_t* at)
+	{
+		return std::uint32_t(at[0]) | std::uint32_t(at[1]) << 8 | std::uint32_t(at[2]) << 16 | std::uint32_t(at[3]) << 24;
+	}
+
+	std::uint32_t SectorsFor(std::size_t payloadBytes)
+	{
+		return std::uint32_t((RegionPayloadHeaderBytes + payloadBytes + RegionSectorBytes - 1) / RegionSectorBytes);
+	}
+
+	static_assert(RegionChunkCount * sizeof(std::uint32_t) == RegionSectorBytes, "The chunk table is one sector.");
+	static_assert(RegionPayloadHeaderBytes + WorldChunk::Dims::Volume <= 0xff * RegionSectorBytes,
+		"A raw chunk must fit the sector count of a table entry.");
+}
+
+std::FILE* OpenBinaryFile(const std::string& path, const char* mode)
+{
+#ifdef _MSC_VER
+	std::FILE* file = nullptr;
+	return fopen_s(&file, path.c_str(), mode) == 0 ? file : nullptr;
+#else
+	return std::fopen(path.c_str(), mode);
+#endif
+}
+
+std::string RegionPath(const std::string& prefix, std::uint32_t rx, std::uint32_t ry, std::uint32_t rz)
+{
+	return prefix + "." + std::to_string(rx) + "." + std::to_string(ry) + "." + std::to_string(rz) + ".region";
+}
+
+std::uint32_t RegionTableEntry(const std::uint8_t* table, std::uint32_t index)
+{
+	return GetU32(table + index * sizeof(std::uint32_t));
+}
+
+bool ParseChunkPayload(const std::uint8_t* sectors, std::size_t bytes, ChunkPayload& payload)
+{
+	if(bytes < RegionPayloadHeaderBytes)
+		return false;
+
+	std::uint32_t size = GetU32(sectors);
+	std::uint8_t codec = sectors[4];
+	if(codec >= ChunkCodec_Count || size > bytes - RegionPayloadHeaderBytes)
+		return false;
+
+	payload.Codec = ChunkCodec(codec);
+	payload.Data = sectors + RegionPayloadHeaderBytes;
+	payload.Size = size;
+	return true;
+}
+
+RegionFile::~RegionFile()
+{
+	Close();
+}
+
+bool RegionFile::Open(const std::string& path, bool create)
+{
+	Close();
+
+	mFile = OpenBinaryFile(path, "r+b");
+	if(mFile == nullptr && create)
+	{
+		mFile = OpenBinaryFile(path, "w+b");
+		if(mFile != nullptr)
+		{
+			std::uint8_t empty[RegionSectorBytes] = {};
+			if(std::fwrite(empty, 1, sizeof(empty), mFile) != sizeof(empty))
+				Close();
+		}
+	}
+	if(mFile == nullptr)
+		return false;
+
+	std::uint8_t table[RegionSectorBytes];
+	if(std::fseek(mFile, 0, SEEK_SET) != 0 || std::fread(table, 1, sizeof(table), mFile) != sizeof(table))
+	{
+		Close();
+		return false;
+	}
+
+	std::fseek(mFile, 0, SEEK_END);
+	long bytes = std::ftell(mFile);
+	mSectorUsed.assign(std::size_t(bytes + RegionSectorBytes - 1) / RegionSectorBytes, false);
+	mSectorUsed[0] = true;
+
+	// Entries that run past the end of the file, say after a crash mid-write, are
+	// dropped rather than trusted.
+	for(std::uint32_t i = 0; i < RegionChunkCount; ++i)
+	{
+		std::uint32_t entry = RegionTableEntry(table, i);
+		std::uint32_t first = RegionEntryOffset(entry);
+		std::uint32_t count = RegionEntrySectors(entry);
+		if(count == 0 || first == 0 || first + count > mSectorUsed.size())
+			entry = 0;
+
+		mTable[i] = entry;
+		MarkSectors(entry, true);
+	}
+
+	return true;
+}
+
+void RegionFile::Close()
+{
+	if(mFile != nullptr)
+		std::fclose(mFile);
+
+	mFile = nullptr;
+	std::memset(mTable, 0, sizeof(mTable));
+	mSectorUsed.clear();
+}
+
+bool RegionFile::HasChunk(std::uint32_t lx, std::uint32_t lz)const
+{
+	return mTable[EntryIndex(lx, lz)] != 0;
+}
+
+bool RegionFile::ReadChunk(std::uint32_t lx, std::uint32_t lz, std::vector<std::uint8_t>& buffer, ChunkPayload& payload)
+{
+	std::uint32_t entry = mTable[EntryIndex(lx, lz)];
+	if(mFile == nullptr || entry == 0)
+		return false;
+
+	std::size_t bytes = std::size_t(RegionEntrySectors(entry)) * RegionSectorBytes;
+	buffer.resize(bytes);
+	if(std::fseek(mFile, long(RegionEntryOffset(entry)) * RegionSectorBytes, SEEK_SET) != 0 ||
+		std::fread(buffer.data(), 1, bytes, mFile) != bytes)
+		return false;
+
+	return ParseChunkPayload(buffer.data(), bytes, payload);
+}
+
+bool RegionFile::WriteChunk(std::uint32_t lx, std::uint32_t lz, ChunkCodec codec, const std::uint8_t* data, std::size_t size)
+{
+	if(mFile == nullptr)
+		return false;
+
+	std::uint32_t index = EntryIndex(lx, lz);
+	std::uint32_t entry = mTable[index];
+	std::uint32_t count = SectorsFor(size);
+
+	// A payload that still fits stays put and gives back the sectors it no longer needs.
+	MarkSectors(entry, false);
+	std::uint32_t first = count <= RegionEntrySectors(entry) ? RegionEntryOffset(entry) : FindFreeSectors(count);
+
+	std::vector<std::uint8_t> sectors(std::size_t(count) * RegionSectorBytes, 0);
+	PutU32(sectors.data(), std::uint32_t(size));
+	sectors[4] = codec;
+	std::memcpy(sectors.data() + RegionPayloadHeaderBytes, data, size);
+
+	if(std::fseek(mFile, long(first) * RegionSectorBytes, SEEK_SET) != 0 ||
+		std::fwrite(sectors.data(), 1, sectors.size(), mFile) != sectors.size())
+	{
+		MarkSectors(entry, true);
+		return false;
+	}
+
+	entry = first << 8 | count;
+	if(first + count > mSectorUsed.size())
+		mSectorUsed.resize(first + count, false);
+	MarkSectors(entry, true);
+	return WriteEntry(index, entry);
+}
+
+bool RegionFile::EraseChunk(std::uint32_t lx, std::uint32_t lz)
+{
+	std::uint32_t index = EntryIndex(lx, lz);
+	if(mFile == nullptr)
+		return false;
+	if(mTable[index] == 0)
+		return true;
+
+	MarkSectors(mTable[index], false);
+	return WriteEntry(index, 0);
+}
+
+std::uint32_t RegionFile::UsedSectors()const
+{
+	std::uint32_t used = 0;
+	for(bool sector : mSectorUsed)
+		used += sector ? 1 : 0;
+	return used;
+}
+
+std::uint32_t RegionFile::EntryIndex(std::uint32_t lx, std::uint32_t lz)
+{
+	assert(lx < RegionChunks && lz < RegionChunks);
+	return RegionEntryIndex(lx, lz);
+}
+
+bool RegionFile::WriteEntry(std::uint32_t index, std::uint32_t entry)
+{
+	mTable[index] = entry;
+
+	std::uint8_t bytes[sizeof(std::uint32_t)];
+	PutU32(bytes, entry);
+	return std::fseek(mFile, long(index * sizeof(std::uint32_t)), SEEK_SET) == 0 &&
+		std::fwrite(bytes, 1, sizeof(bytes), mFile) == sizeof(bytes);
+}
+
+void RegionFile::MarkSectors(std::uint32_t entry, bool used)
+{
+	std::uint32_t first = RegionEntryOffset(entry);
+	for(std::uint32_t i = 0; i < RegionEntrySectors(entry); ++i)
+		mSectorUsed[first + i] = used;
+}
+
+std::uint32_t RegionFile::FindFreeSectors(std::uint32_t count)const
+{
+	// First fit, and past the end of the file when no gap is big enough.
+	std::uint32_t run = 0;
+	for(std::uint32_t i = 1; i < mSectorUsed.size(); ++i)
+	{
+		run = mSectorUsed[i] ? 0 : run + 1;
+		if(run == count)
+			return i + 1 - count;
+	}
+	return (std::uint32_t)mSectorUsed.size() - run;
+}
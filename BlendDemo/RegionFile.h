@@ -0,0 +1,105 @@
+//***************************************************************************************
+// RegionFile.h
+//
+// The on-disk home of a region: 32x32 chunks of one chunk layer of the world in one
+// file.  The file starts with a one-sector table with an entry per chunk that gives
+// the sector its payload starts at and how many sectors it takes.  Payloads are
+// whole 4096-byte sectors, so a chunk loads with one seek and one read of exactly its
+// sectors, and a rewritten chunk that still fits stays where it is.
+//
+// A payload is the encoded length as four bytes, the codec as one, then the encoded
+// blocks, see ChunkCodec.h.  Everything is little-endian.
+//***************************************************************************************
+
+#pragma once
+
+#include "ChunkCodec.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Side of a region in chunks, along x and z.
+const std::uint32_t RegionChunks = 32;
+const std::uint32_t RegionChunkCount = RegionChunks * RegionChunks;
+
+const std::uint32_t RegionSectorBytes = 4096;
+const std::uint32_t RegionPayloadHeaderBytes = 5;
+
+// std::fopen, without the deprecation warning MSVC gives it.
+std::FILE* OpenBinaryFile(const std::string& path, const char* mode);
+
+// Name of the region file of region rx, ry, rz: prefix.rx.ry.rz.region.  Region y is
+// the chunk layer.
+std::string RegionPath(const std::string& prefix, std::uint32_t rx, std::uint32_t ry, std::uint32_t rz);
+
+// The encoded blocks of one chunk, pointing into storage owned by whoever read them.
+struct ChunkPayload
+{
+	ChunkCodec Codec = ChunkCodec_Raw;
+	const std::uint8_t* Data = nullptr;
+	std::size_t Size = 0;
+};
+
+// Table entries hold the first sector of a chunk's payload in the high 24 bits and its
+// sector count in the low 8, or are zero when the chunk is not stored.  Entries are
+// x fastest.
+inline std::uint32_t RegionEntryIndex(std::uint32_t lx, std::uint32_t lz) { return lx + lz * RegionChunks; }
+inline std::uint32_t RegionEntryOffset(std::uint32_t entry) { return entry >> 8; }
+inline std::uint32_t RegionEntrySectors(std::uint32_t entry) { return entry & 0xff; }
+
+// Entry index of the region table, read from the little-endian table.
+std::uint32_t RegionTableEntry(const std::uint8_t* table, std::uint32_t index);
+
+// Points payload at the encoded blocks in bytes of a chunk's sectors.  Returns false
+// when the payload header does not fit them.
+bool ParseChunkPayload(const std::uint8_t* sectors, std::size_t bytes, ChunkPayload& payload);
+
+class RegionFile
+{
+public:
+	RegionFile() = default;
+	RegionFile(const RegionFile&) = delete;
+	RegionFile& operator=(const RegionFile&) = delete;
+	~RegionFile();
+
+	// Opens the region at path, or when create is set and there is none, makes an empty
+	// one.  Returns false when the file cannot be opened or its table is cut short.
+	bool Open(const std::string& path, bool create);
+	void Close();
+
+	bool IsOpen()const { return mFile != nullptr; }
+
+	// Chunk coordinates are local to the region, 0 to RegionChunks - 1.
+	bool HasChunk(std::uint32_t lx, std::uint32_t lz)const;
+
+	// Reads the sectors of chunk lx, lz into buffer and points payload at its encoded
+	// blocks.  Returns false when the chunk is not stored or its sectors are damaged.
+	bool ReadChunk(std::uint32_t lx, std::uint32_t lz, std::vector<std::uint8_t>& buffer, ChunkPayload& payload);
+
+	// Stores size bytes encoded with codec as chunk lx, lz, in place when they fit the
+	// chunk's sectors and otherwise in the first free run of sectors big enough.
+	bool WriteChunk(std::uint32_t lx, std::uint32_t lz, ChunkCodec codec, const std::uint8_t* data, std::size_t size);
+
+	// Removes chunk lx, lz, which then reads as not stored.
+	bool EraseChunk(std::uint32_t lx, std::uint32_t lz);
+
+	// Sectors in the file, the table included, and of those the ones holding chunks.
+	std::uint32_t SectorCount()const { return (std::uint32_t)mSectorUsed.size(); }
+	std::uint32_t UsedSectors()const;
+
+private:
+	static std::uint32_t EntryIndex(std::uint32_t lx, std::uint32_t lz);
+
+	bool WriteEntry(std::uint32_t index, std::uint32_t entry);
+	void MarkSectors(std::uint32_t entry, bool used);
+	std::uint32_t FindFreeSectors(std::uint32_t count)const;
+
+	std::FILE* mFile = nullptr;
+
+	// The entries of the region table.
+	std::uint32_t mTable[RegionChunkCount] = {};
+
+	std::vector<bool> mSectorUsed;
+};
@@ -0,0 +1,95 @@
+//***************************************************************************************
+// Registry.h
+//
+// Named resources, such as geometries, materials, textures, shaders and PSOs, stored in
+// an array and named by small integer handles.  Names are hashed only when a handle is
+// looked up, which is meant for load time; per frame code keeps the handles and pays an
+// array index.  The names stay around for tools and debug output.
+//***************************************************************************************
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+template<typename T>
+struct RegistryHandle
+{
+	static const std::uint32_t InvalidIndex = 0xffffffff;
+
+	std::uint32_t Index = InvalidIndex;
+
+	bool Valid()const { return Index != InvalidIndex; }
+
+	bool operator==(const RegistryHandle& rhs)const { return Index == rhs.Index; }
+	bool operator!=(const RegistryHandle& rhs)const { return Index != rhs.Index; }
+};
+
+template<typename T>
+class Registry
+{
+public:
+	typedef RegistryHandle<T> Handle;
+
+	// The handle of name, registering it with a default constructed value the first time.
+	Handle Register(const std::string& name)
+	{
+		Handle handle = Find(name);
+		if(handle.Valid())
+			return handle;
+
+		handle.Index = (std::uint32_t)mValues.size();
+		mValues.emplace_back();
+		mNames.push_back(name);
+		mIndices.emplace(name, handle.Index);
+		return handle;
+	}
+
+	// The handle of name, or an invalid handle when it was never registered.
+	Handle Find(const std::string& name)const
+	{
+		Handle handle;
+		auto it = mIndices.find(name);
+		if(it != mIndices.end())
+			handle.Index = it->second;
+		return handle;
+	}
+
+	// Lookup by name registers on first use, like std::unordered_map.  For load time.
+	T& operator[](const std::string& name) { return mValues[Register(name).Index]; }
+
+	T& operator[](Handle handle)
+	{
+		assert(handle.Index < mValues.size());
+		return mValues[handle.Index];
+	}
+
+	const T& operator[](Handle handle)const
+	{
+		assert(handle.Index < mValues.size());
+		return mValues[handle.Index];
+	}
+
+	// The name a handle was registered under, for tools and debug output.
+	const std::string& Name(Handle handle)const
+	{
+		assert(handle.Index < mNames.size());
+		return mNames[handle.Index];
+	}
+
+	std::uint32_t Size()const { return (std::uint32_t)mValues.size(); }
+
+	// The values in handle order.
+	typename std::vector<T>::iterator begin() { return mValues.begin(); }
+	typename std::vector<T>::iterator end() { return mValues.end(); }
+	typename std::vector<T>::const_iterator begin()const { return mValues.begin(); }
+	typename std::vector<T>::const_iterator end()const { return mValues.end(); }
+
+private:
+	std::vector<T> mValues;
+	std::vector<std::string> mNames;
+	std::unordered_map<std::string, std::uint32_t> mIndices;
+};
@@ -0,0 +1,121 @@
+//***************************************************************************************
+// RenderBackend.cpp
+//***************************************************************************************
+
+#include "RenderBackend.h"
+
+#include <cassert>
+#include <cstring>
+
+void RenderBackendStats::Accumulate(const RenderBackendStats& rhs)
+{
+	Draws += rhs.Draws;
+	IndirectCalls += rhs.IndirectCalls;
+	IndirectRecords += rhs.IndirectRecords;
+	PipelineSets += rhs.PipelineSets;
+	GeometrySets += rhs.GeometrySets;
+	TopologySets += rhs.TopologySets;
+	TableSets += rhs.TableSets;
+	BufferBinds += rhs.BufferBinds;
+	BuffersCreated += rhs.BuffersCreated;
+	BuffersGrown += rhs.BuffersGrown;
+	BytesCreated += rhs.BytesCreated;
+	BytesUploaded += rhs.BytesUploaded;
+}
+
+BufferHandle RenderDevice::CreateBuffer(const BufferDesc& desc, const void* initialData)
+{
+	assert(desc.CpuWritable || initialData != nullptr);
+
+	BufferHandle buffer = OnCreateBuffer(desc, initialData);
+
+	std::uint64_t byteSize = (std::uint64_t)ElementStride(buffer) * desc.ElementCount;
+	mStats.BuffersCreated++;
+	mStats.BytesCreated += byteSize;
+	if(initialData != nullptr)
+		mStats.BytesUploaded += (std::uint64_t)desc.ElementByteSize * desc.ElementCount;
+
+	return buffer;
+}
+
+void RenderDevice::GrowBuffer(BufferHandle buffer, std::uint32_t elementCount)
+{
+	std::uint32_t oldCount = ElementCount(buffer);
+	assert(elementCount >= oldCount);
+	if(elementCount == oldCount)
+		return;
+
+	OnGrowBuffer(buffer, elementCount);
+
+	// The kept elements are copied into the new memory, which counts as an upload.
+	mStats.BuffersGrown++;
+	mStats.BytesCreated += (std::uint64_t)ElementStride(buffer) * elementCount;
+	mStats.BytesUploaded += (std::uint64_t)ElementStride(buffer) * oldCount;
+}
+
+void RenderDevice::WriteElement(BufferHandle buffer, std::uint32_t element, const void* data, std::uint32_t byteSize)
+{
+	assert(element < ElementCount(buffer));
+	assert(byteSize <= ElementStride(buffer));
+
+	std::memcpy(OnMapElements(buffer, element), data, byteSize);
+	mStats.BytesUploaded += byteSize;
+}
+
+void* RenderDevice::MapElements(BufferHandle buffer, std::uint32_t first, std::uint32_t count)
+{
+	assert(first + count <= ElementCount(buffer));
+
+	mStats.BytesUploaded += (std::uint64_t)ElementStride(buffer) * count;
+	return OnMapElements(buffer, first);
+}
+
+void RenderContext::SetPipeline(std::uint32_t pipeline)
+{
+	mStats.PipelineSets++;
+	OnSetPipeline(pipeline);
+}
+
+void RenderContext::SetGeometry(BufferHandle vertices, BufferHandle indices)
+{
+	mStats.GeometrySets++;
+	OnSetGeometry(vertices, indices);
+}
+
+void RenderContext::SetTopology(PrimitiveTopology topology)
+{
+	mStats.TopologySets++;
+	OnSetTopology(topology);
+}
+
+void RenderContext::SetTextureTable(std::uint32_t slot, std::uint32_t firstTexture)
+{
+	mStats.TableSets++;
+	OnSetTextureTable(slot, firstTexture);
+}
+
+void RenderContext::SetConstantBuffer(std::uint32_t slot, BufferHandle buffer, std::uint32_t element)
+{
+	mStats.BufferBinds++;
+	OnSetConstantBuffer(slot, buffer, element);
+}
+
+void RenderContext::SetShaderResource(std::uint32_t slot, BufferHandle buffer, std::uint32_t element)
+{
+	mStats.BufferBinds++;
+	OnSetShaderResource(slot, buffer, element);
+}
+
+void RenderContext::DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex,
+	std::int32_t baseVertex, std::uint32_t startInstance)
+{
+	mStats.Draws++;
+	OnDrawIndexed(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void RenderContext::DrawIndirect(BufferHandle args, std::uint32_t firstRecord, std::uint32_t recordCount)
+{
+	mStats.IndirectCalls++;
+	mStats.IndirectRecords += recordCount;
+	OnDrawIndirect(args, firstRecord, recordCount);
+}
@@ -0,0 +1,169 @@
+//***************************************************************************************
+// RenderBackend.h
+//
+// The small slice of a graphics API the frame needs: creating buffers, writing into
+// them, binding pipelines and resources, and submitting draws.  Resources are named by
+// plain integer handles so nothing above this layer sees Direct3D types.  The public
+// calls are counted here and forwarded to the backend, which gives every backend the
+// same counters; D3D12Backend talks to the GPU, RecordingBackend only keeps the counts.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+typedef std::uint32_t BufferHandle;
+static const BufferHandle InvalidBuffer = 0xffffffff;
+
+enum class BufferUsage : std::uint32_t
+{
+	Vertex = 0,
+	Index,
+	Constant,
+	Structured,
+	IndirectArgs
+};
+
+enum class PrimitiveTopology : std::uint32_t
+{
+	TriangleList = 0,
+	TriangleStrip,
+	LineList,
+	PointList
+};
+
+struct BufferDesc
+{
+	BufferUsage Usage = BufferUsage::Vertex;
+	std::uint32_t ElementCount = 0;
+
+	// Size of one element as the CPU sees it.  Backends may place elements further
+	// apart, constant buffers in particular; ElementStride gives the real distance.
+	std::uint32_t ElementByteSize = 0;
+
+	// CPU writable buffers live in memory the CPU can see and are rewritten every frame.
+	// The others are filled once from the data given to CreateBuffer.
+	bool CpuWritable = false;
+};
+
+struct RenderBackendStats
+{
+	std::uint32_t Draws = 0;
+	std::uint32_t IndirectCalls = 0;
+	std::uint32_t IndirectRecords = 0;
+
+	std::uint32_t PipelineSets = 0;
+	std::uint32_t GeometrySets = 0;
+	std::uint32_t TopologySets = 0;
+	std::uint32_t TableSets = 0;
+	std::uint32_t BufferBinds = 0;
+
+	std::uint32_t BuffersCreated = 0;
+	std::uint32_t BuffersGrown = 0;
+	std::uint64_t BytesCreated = 0;
+	std::uint64_t BytesUploaded = 0;
+
+	std::uint32_t StateChanges()const
+	{
+		return PipelineSets + GeometrySets + TopologySets + TableSets + BufferBinds;
+	}
+
+	void Accumulate(const RenderBackendStats& rhs);
+};
+
+// The element count to grow a buffer of capacity elements to so that it holds required.
+// Doubling keeps the number of grows, and the copies they make, logarithmic in the
+// final size.
+inline std::uint32_t GrowCapacity(std::uint32_t capacity, std::uint32_t required)
+{
+	if(required <= capacity)
+		return capacity;
+
+	std::uint64_t doubled = (std::uint64_t)capacity * 2;
+	if(doubled > 0xffffffffu)
+		doubled = 0xffffffffu;
+
+	return required > doubled ? required : (std::uint32_t)doubled;
+}
+
+// Creates buffers and writes into them.  Called from one thread, outside recording.
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() = default;
+
+	// initialData may be null for CPU writable buffers.
+	BufferHandle CreateBuffer(const BufferDesc& desc, const void* initialData);
+
+	// Gives a CPU writable buffer room for elementCount elements, keeping the handle and
+	// the contents of the existing elements.  The memory behind the buffer is replaced,
+	// so only grow a buffer once the GPU has finished every frame that reads it.
+	void GrowBuffer(BufferHandle buffer, std::uint32_t elementCount);
+
+	// Copies byteSize bytes to the start of one element of a CPU writable buffer.
+	void WriteElement(BufferHandle buffer, std::uint32_t element, const void* data, std::uint32_t byteSize);
+
+	template<typename T>
+	void Write(BufferHandle buffer, std::uint32_t element, const T& value)
+	{
+		WriteElement(buffer, element, &value, (std::uint32_t)sizeof(T));
+	}
+
+	// Memory for elements [first, first + count) of a CPU writable buffer, for callers
+	// that fill many elements in place.  The whole range counts as uploaded.
+	void* MapElements(BufferHandle buffer, std::uint32_t first, std::uint32_t count);
+
+	virtual std::uint32_t ElementStride(BufferHandle buffer)const = 0;
+	virtual std::uint32_t ElementCount(BufferHandle buffer)const = 0;
+
+	const RenderBackendStats& Stats()const { return mStats; }
+	void ResetStats() { mStats = RenderBackendStats(); }
+
+protected:
+	virtual BufferHandle OnCreateBuffer(const BufferDesc& desc, const void* initialData) = 0;
+	virtual void OnGrowBuffer(BufferHandle buffer, std::uint32_t elementCount) = 0;
+	virtual std::uint8_t* OnMapElements(BufferHandle buffer, std::uint32_t first) = 0;
+
+	RenderBackendStats mStats;
+};
+
+// Records binding and draw commands.  One context per command list; contexts can be
+// recorded on different threads as long as the device is not changed meanwhile.
+class RenderContext
+{
+public:
+	virtual ~RenderContext() = default;
+
+	void SetPipeline(std::uint32_t pipeline);
+	void SetGeometry(BufferHandle vertices, BufferHandle indices);
+	void SetTopology(PrimitiveTopology topology);
+
+	// Binds a descriptor table starting at texture firstTexture to a root slot.
+	void SetTextureTable(std::uint32_t slot, std::uint32_t firstTexture);
+
+	void SetConstantBuffer(std::uint32_t slot, BufferHandle buffer, std::uint32_t element);
+	void SetShaderResource(std::uint32_t slot, BufferHandle buffer, std::uint32_t element);
+
+	void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex,
+		std::int32_t baseVertex, std::uint32_t startInstance);
+
+	// Submits recordCount IndirectDrawArgs records starting at record firstRecord.
+	void DrawIndirect(BufferHandle args, std::uint32_t firstRecord, std::uint32_t recordCount);
+
+	const RenderBackendStats& Stats()const { return mStats; }
+	void ResetStats() { mStats = RenderBackendStats(); }
+
+protected:
+	virtual void OnSetPipeline(std::uint32_t pipeline) = 0;
+	virtual void OnSetGeometry(BufferHandle vertices, BufferHandle indices) = 0;
+	virtual void OnSetTopology(PrimitiveTopology topology) = 0;
+	virtual void OnSetTextureTable(std::uint32_t slot, std::uint32_t firstTexture) = 0;
+	virtual void OnSetConstantBuffer(std::uint32_t slot, BufferHandle buffer, std::uint32_t element) = 0;
+	virtual void OnSetShaderResource(std::uint32_t slot, BufferHandle buffer, std::uint32_t element) = 0;
+	virtual void OnDrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex,
+		std::int32_t baseVertex, std::uint32_t startInstance) = 0;
+	virtual void OnDrawIndirect(BufferHandle args, std::uint32_t firstRecord, std::uint32_t recordCount) = 0;
+
+	RenderBackendStats mStats;
+};
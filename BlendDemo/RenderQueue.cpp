@@ -0,0 +1,180 @@
+//***************************************************************************************
+// RenderQueue.cpp
+//***************************************************************************************
+
+#include "RenderQueue.h"
+#include <cstring>
+
+std::uint64_t RenderQueue::MakeKey(std::uint32_t layer, std::uint32_t pso, std::uint32_t geometry, std::uint32_t material)
+{
+	return MakeKey(layer, pso, geometry, material, 0);
+}
+
+std::uint64_t RenderQueue::MakeKey(std::uint32_t layer, std::uint32_t pso, std::uint32_t geometry, std::uint32_t material, std::uint32_t depth)
+{
+	std::uint64_t key = 0;
+	key |= ((std::uint64_t)layer & ((1ull << LayerBits) - 1)) << LayerShift;
+	key |= ((std::uint64_t)pso & ((1ull << PsoBits) - 1)) << PsoShift;
+	key |= ((std::uint64_t)geometry & ((1ull << GeometryBits) - 1)) << GeometryShift;
+	key |= ((std::uint64_t)material & ((1ull << MaterialBits) - 1)) << MaterialShift;
+	key |= ((std::uint64_t)depth & ((1ull << DepthBits) - 1)) << DepthShift;
+	return key;
+}
+
+std::uint32_t RenderQueue::QuantizeDepth(float viewDepth, float nearZ, float farZ, bool backToFront)
+{
+	const std::uint32_t maxDepth = (1u << DepthBits) - 1;
+
+	float t = (viewDepth - nearZ) / (farZ - nearZ);
+	if(!(t > 0.0f)) // Also catches NaN.
+		t = 0.0f;
+	else if(t > 1.0f)
+		t = 1.0f;
+
+	std::uint32_t depth = (std::uint32_t)(t * (float)maxDepth);
+	if(depth > maxDepth)
+		depth = maxDepth;
+
+	return backToFront ? maxDepth - depth : depth;
+}
+
+void RenderQueue::Clear()
+{
+	mEntries.clear();
+}
+
+void RenderQueue::Reserve(std::size_t count)
+{
+	mEntries.reserve(count);
+	mScratch.reserve(count);
+}
+
+void RenderQueue::Push(std::uint64_t key, std::uint32_t item)
+{
+	RenderQueueEntry e;
+	e.Key = key;
+	e.Item = item;
+	mEntries.push_back(e);
+}
+
+void RenderQueue::Sort()
+{
+	mLastSortPasses = 0;
+
+	const std::size_t count = mEntries.size();
+	if(count < 2)
+		return;
+
+	// Build the histograms for all eight digits in one read over the keys.
+	std::uint32_t histograms[8][256];
+	std::memset(histograms, 0, sizeof(histograms));
+
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		std::uint64_t key = mEntries[i].Key;
+		for(int pass = 0; pass < 8; ++pass)
+			++histograms[pass][(key >> (pass * 8)) & 0xff];
+	}
+
+	mScratch.resize(count);
+	RenderQueueEntry* src = mEntries.data();
+	RenderQueueEntry* dst = mScratch.data();
+
+	for(int pass = 0; pass < 8; ++pass)
+	{
+		std::uint32_t* histogram = histograms[pass];
+		const int shift = pass * 8;
+
+		// Every key shares this byte, so the pass would not move anything.
+		if(histogram[(src[0].Key >> shift) & 0xff] == count)
+			continue;
+
+		std::uint32_t offset = 0;
+		for(int digit = 0; digit < 256; ++digit)
+		{
+			std::uint32_t n = histogram[digit];
+			histogram[digit] = offset;
+			offset += n;
+		}
+
+		for(std::size_t i = 0; i < count; ++i)
+			dst[histogram[(src[i].Key >> shift) & 0xff]++] = src[i];
+
+		RenderQueueEntry* tmp = src;
+		src = dst;
+		dst = tmp;
+		++mLastSortPasses;
+	}
+
+	// An odd number of passes leaves the result in the scratch buffer.
+	if(src != mEntries.data())
+		mEntries.swap(mScratch);
+}
+
+void DrawStateCache::Reset()
+{
+	mPso = Unbound;
+	mGeometry = Unbound;
+	mTopology = Unbound;
+	mMaterial = Unbound;
+	mStats = RenderQueueStats();
+}
+
+bool DrawStateCache::SetPso(std::uint32_t pso)
+{
+	if(pso == mPso)
+		return false;
+
+	mPso = pso;
+	++mStats.PsoSets;
+	return true;
+}
+
+bool DrawStateCache::SetGeometry(std::uint32_t geometry)
+{
+	if(geometry == mGeometry)
+	{
+		++mStats.GeometrySkipped;
+		return false;
+	}
+
+	mGeometry = geometry;
+	++mStats.GeometrySets;
+	return true;
+}
+
+bool DrawStateCache::SetTopology(std::uint32_t topology)
+{
+	if(topology == mTopology)
+	{
+		++mStats.TopologySkipped;
+		return false;
+	}
+
+	mTopology = topology;
+	++mStats.TopologySets;
+	return true;
+}
+
+bool DrawStateCache::SetMaterial(std::uint32_t material)
+{
+	if(material == mMaterial)
+	{
+		++mStats.MaterialSkipped;
+		return false;
+	}
+
+	mMaterial = material;
+	++mStats.MaterialSets;
+	return true;
+}
+
+void DrawStateCache::SetObject()
+{
+	++mStats.ObjectSets;
+}
+
+void DrawStateCache::Draw()
+{
+	++mStats.Draws;
+}
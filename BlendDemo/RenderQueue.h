@@ -0,0 +1,155 @@
+//***************************************************************************************
+// RenderQueue.h
+//
+// Collects draws for a frame as 64-bit sort keys, radix sorts them, and tracks the
+// pipeline state that has already been bound so redundant state sets can be skipped.
+// Nothing in here touches Direct3D, so the key building and sorting can be exercised
+// on the CPU alone.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A draw waiting to be submitted.  Item is an index chosen by the caller, usually into
+// an array of render items gathered while the queue was being filled.
+struct RenderQueueEntry
+{
+	std::uint64_t Key = 0;
+	std::uint32_t Item = 0;
+};
+
+class RenderQueue
+{
+public:
+	// Key layout, most significant field first:
+	//   [63..60] layer  [59..52] PSO  [51..40] geometry  [39..28] material  [27..0] depth
+	// An ascending sort therefore groups draws by layer, then by the state that is most
+	// expensive to change, and finally orders each group by depth.  Blended layers leave
+	// geometry and material zero, so depth alone orders the whole layer.
+	static const int LayerBits = 4;
+	static const int PsoBits = 8;
+	static const int GeometryBits = 12;
+	static const int MaterialBits = 12;
+	static const int DepthBits = 28;
+
+	static const int DepthShift = 0;
+	static const int MaterialShift = DepthShift + DepthBits;
+	static const int GeometryShift = MaterialShift + MaterialBits;
+	static const int PsoShift = GeometryShift + GeometryBits;
+	static const int LayerShift = PsoShift + PsoBits;
+
+	// Builds the part of a key that does not change from frame to frame.
+	static std::uint64_t MakeKey(std::uint32_t layer, std::uint32_t pso, std::uint32_t geometry, std::uint32_t material);
+	static std::uint64_t MakeKey(std::uint32_t layer, std::uint32_t pso, std::uint32_t geometry, std::uint32_t material, std::uint32_t depth);
+
+	// Maps a view space depth into the depth field.  Opaque draws want front to back
+	// order to make the most of early z, blended draws want back to front.
+	static std::uint32_t QuantizeDepth(float viewDepth, float nearZ, float farZ, bool backToFront);
+
+	static std::uint32_t KeyLayer(std::uint64_t key)    { return Field(key, LayerShift, LayerBits); }
+	static std::uint32_t KeyPso(std::uint64_t key)      { return Field(key, PsoShift, PsoBits); }
+	static std::uint32_t KeyGeometry(std::uint64_t key) { return Field(key, GeometryShift, GeometryBits); }
+	static std::uint32_t KeyMaterial(std::uint64_t key) { return Field(key, MaterialShift, MaterialBits); }
+	static std::uint32_t KeyDepth(std::uint64_t key)    { return Field(key, DepthShift, DepthBits); }
+
+public:
+	void Clear();
+	void Reserve(std::size_t count);
+	void Push(std::uint64_t key, std::uint32_t item);
+
+	// Stable LSD radix sort on the whole key, one byte per pass.  Passes where every
+	// key has the same byte are skipped, which is the common case for the high bytes.
+	void Sort();
+
+	std::size_t Size()const { return mEntries.size(); }
+	bool Empty()const { return mEntries.empty(); }
+	const RenderQueueEntry& operator[](std::size_t i)const { return mEntries[i]; }
+	const RenderQueueEntry* Data()const { return mEntries.data(); }
+
+	// Number of byte passes the last Sort actually had to run.
+	int LastSortPasses()const { return mLastSortPasses; }
+
+private:
+	static std::uint32_t Field(std::uint64_t key, int shift, int bits)
+	{
+		return (std::uint32_t)((key >> shift) & ((1ull << bits) - 1));
+	}
+
+	std::vector<RenderQueueEntry> mEntries;
+	std::vector<RenderQueueEntry> mScratch;
+	int mLastSortPasses = 0;
+};
+
+// Counters for one frame of submission.  "Saved" is measured against the old path,
+// which set vertex buffer, index buffer, topology, texture table, material CBV and
+// object CBV for every draw, and the PSO once per layer.
+struct RenderQueueStats
+{
+	std::uint32_t Draws = 0;
+
+	std::uint32_t PsoSets = 0;
+	std::uint32_t GeometrySets = 0;
+	std::uint32_t TopologySets = 0;
+	std::uint32_t MaterialSets = 0;
+	std::uint32_t ObjectSets = 0;
+
+	std::uint32_t GeometrySkipped = 0;
+	std::uint32_t TopologySkipped = 0;
+	std::uint32_t MaterialSkipped = 0;
+
+	// Total API calls issued for state, counting a geometry set as vertex and index
+	// buffer and a material set as texture table and constant buffer.
+	std::uint32_t StateChangesIssued()const
+	{
+		return PsoSets + 2 * GeometrySets + TopologySets + 2 * MaterialSets + ObjectSets;
+	}
+
+	std::uint32_t StateChangesSaved()const
+	{
+		return 2 * GeometrySkipped + TopologySkipped + 2 * MaterialSkipped;
+	}
+
+	// Adds another list's counters, for frames recorded over several command lists.
+	void Accumulate(const RenderQueueStats& rhs)
+	{
+		Draws += rhs.Draws;
+		PsoSets += rhs.PsoSets;
+		GeometrySets += rhs.GeometrySets;
+		TopologySets += rhs.TopologySets;
+		MaterialSets += rhs.MaterialSets;
+		ObjectSets += rhs.ObjectSets;
+		GeometrySkipped += rhs.GeometrySkipped;
+		TopologySkipped += rhs.TopologySkipped;
+		MaterialSkipped += rhs.MaterialSkipped;
+	}
+};
+
+// Remembers what is currently bound on a command list.  Each Set* call returns true
+// when the caller has to issue the state change, and false when it is redundant.
+class DrawStateCache
+{
+public:
+	void Reset();
+
+	bool SetPso(std::uint32_t pso);
+	bool SetGeometry(std::uint32_t geometry);
+	bool SetTopology(std::uint32_t topology);
+	bool SetMaterial(std::uint32_t material);
+	void SetObject();
+	void Draw();
+
+	const RenderQueueStats& Stats()const { return mStats; }
+
+private:
+	static const std::uint32_t Unbound = 0xffffffff;
+
+	std::uint32_t mPso = Unbound;
+	std::uint32_t mGeometry = Unbound;
+	std::uint32_t mTopology = Unbound;
+	std::uint32_t mMaterial = Unbound;
+
+	RenderQueueStats mStats;
+};
@@ -0,0 +1,168 @@
+//***************************************************************************************
+// Instanced.hlsl
+//
+// Draws unit blocks from a structured buffer of per-instance records, so a whole
+// layer of blocks sharing a mesh can be drawn with one DrawIndexedInstanced.
+//***************************************************************************************
+
+// Defaults for number of lights.
+#ifndef NUM_DIR_LIGHTS
+    #define NUM_DIR_LIGHTS 3
+#endif
+
+#ifndef NUM_POINT_LIGHTS
+    #define NUM_POINT_LIGHTS 0
+#endif
+
+#ifndef NUM_SPOT_LIGHTS
+    #define NUM_SPOT_LIGHTS 0
+#endif
+
+#ifndef NUM_BLOCK_TEXTURES
+    #define NUM_BLOCK_TEXTURES 9
+#endif
+
+// Include structures and functions for lighting.
+#include "LightingUtil.hlsl"
+
+// Matches BlockInstance in BlockInstances.h.
+struct BlockInstance
+{
+	float3 PosW;
+	uint   BlockAndFlags; // block id in the low 16 bits, flags in the high 16 bits
+};
+
+// Matches MaterialData in FrameResource.h.
+struct MaterialData
+{
+	float4   DiffuseAlbedo;
+	float3   FresnelR0;
+	float    Roughness;
+	float4x4 MatTransform;
+	uint     DiffuseMapIndex;
+	uint     MatPad0;
+	uint     MatPad1;
+	uint     MatPad2;
+};
+
+StructuredBuffer<BlockInstance> gInstances : register(t0, space1);
+
+// Every material; an instance's block id is its material index.
+StructuredBuffer<MaterialData> gMaterials : register(t0, space3);
+
+// Set by each indirect draw record to where its instances start in gInstances.
+cbuffer cbInstance : register(b3)
+{
+	uint gInstanceOffset;
+};
+
+// Every block texture, indexed by the material's DiffuseMapIndex.
+Texture2D gBlockMaps[NUM_BLOCK_TEXTURES] : register(t0, space2);
+
+SamplerState gsamPointWrap        : register(s0);
+SamplerState gsamPointClamp       : register(s1);
+SamplerState gsamLinearWrap       : register(s2);
+SamplerState gsamLinearClamp      : register(s3);
+SamplerState gsamAnisotropicWrap  : register(s4);
+SamplerState gsamAnisotropicClamp : register(s5);
+
+// Constant data that varies per pass.
+cbuffer cbPass : register(b1)
+{
+    float4x4 gView;
+    float4x4 gInvView;
+    float4x4 gProj;
+    float4x4 gInvProj;
+    float4x4 gViewProj;
+    float4x4 gInvViewProj;
+    float3 gEyePosW;
+    float cbPerObjectPad1;
+    float2 gRenderTargetSize;
+    float2 gInvRenderTargetSize;
+    float gNearZ;
+    float gFarZ;
+    float gTotalTime;
+    float gDeltaTime;
+    float4 gAmbientLight;
+
+	float4 gFogColor;
+	float gFogStart;
+	float gFogRange;
+	float2 cbPerObjectPad2;
+
+    Light gLights[MaxLights];
+
+	float4x4 gShadowTransform;
+};
+
+struct VertexIn
+{
+	float3 PosL    : POSITION;
+    float3 NormalL : NORMAL;
+	float2 TexC    : TEXCOORD;
+};
+
+struct VertexOut
+{
+	float4 PosH    : SV_POSITION;
+    float3 PosW    : POSITION;
+    float3 NormalW : NORMAL;
+	float2 TexC    : TEXCOORD;
+	nointerpolation uint MatIndex : MATINDEX;
+};
+
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
+{
+	VertexOut vout = (VertexOut)0.0f;
+
+	BlockInstance inst = gInstances[gInstanceOffset + instanceID];
+
+    // Blocks are unit cubes that are only ever translated.
+    float4 posW = float4(vin.PosL + inst.PosW, 1.0f);
+    vout.PosW = posW.xyz;
+    vout.NormalW = vin.NormalL;
+
+    vout.PosH = mul(posW, gViewProj);
+
+	vout.MatIndex = inst.BlockAndFlags & 0xffff;
+	vout.TexC = mul(float4(vin.TexC, 0.0f, 1.0f), gMaterials[vout.MatIndex].MatTransform).xy;
+
+    return vout;
+}
+
+float4 PS(VertexOut pin) : SV_Target
+{
+	MaterialData matData = gMaterials[pin.MatIndex];
+
+	// Neighbouring pixels can belong to different instances, so the index is not uniform.
+    float4 diffuseAlbedo = gBlockMaps[NonUniformResourceIndex(matData.DiffuseMapIndex)].Sample(gsamAnisotropicWrap, pin.TexC) * matData.DiffuseAlbedo;
+
+#ifdef ALPHA_TEST
+	clip(diffuseAlbedo.a - 0.1f);
+#endif
+
+    pin.NormalW = normalize(pin.NormalW);
+
+	float3 toEyeW = gEyePosW - pin.PosW;
+	float distToEye = length(toEyeW);
+	toEyeW /= distToEye; // normalize
+
+    float4 ambient = gAmbientLight*diffuseAlbedo;
+
+    const float shininess = 1.0f - matData.Roughness;
+    Material mat = { diffuseAlbedo, matData.FresnelR0, shininess };
+    float3 shadowFactor = 1.0f;
+    float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
+        pin.NormalW, toEyeW, shadowFactor);
+
+    float4 litColor = ambient + directLight;
+
+#ifdef FOG
+	float fogAmount = saturate(((distToEye - gFogStart) / gFogRange))/4.0f;
+	litColor = lerp(litColor, gFogColor, fogAmount);
+#endif
+
+    litColor.a = diffuseAlbedo.a;
+
+    return litColor;
+}
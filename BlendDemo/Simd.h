@@ -0,0 +1,24 @@
+//***************************************************************************************
+// Simd.h
+//
+// Picks the SIMD paths for the CPU side kernels.  SSE2 is assumed on x64 and on x86
+// builds that enable it; everything else falls back to the scalar loops.
+//***************************************************************************************
+
+#pragma once
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+	#define BLEND_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define BLEND_SSE2 0
+#endif
+
+// BMI2's pdep and pext, for bit interleaving.  MSVC has no switch of its own for BMI2,
+// so it is taken to come with AVX2, as it does on every CPU that has both.
+#if defined(__BMI2__) || defined(__AVX2__)
+	#define BLEND_BMI2 1
+	#include <immintrin.h>
+#else
+	#define BLEND_BMI2 0
+#endif
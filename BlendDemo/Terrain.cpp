@@ -0,0 +1,115 @@
+//***************************************************************************************
+// Terrain.cpp
+//***************************************************************************************
+
+#include "Terrain.h"
+
+#include <memory>
+
+namespace
+{
+	typedef WorldChunk::Dims Dims;
+
+	// A well mixed 32-bit hash of the seed and a block's coordinates, in place of rand()
+	// so that every block's dice roll is the same whenever and wherever it is made.
+	std::uint32_t TerrainHash(std::uint32_t seed, std::int32_t x, std::int32_t y, std::int32_t z)
+	{
+		std::uint32_t h = seed;
+		h ^= std::uint32_t(x) * 0x8da6b343u;
+		h ^= std::uint32_t(y) * 0xd8163841u;
+		h ^= std::uint32_t(z) * 0xcb1ab31fu;
+		h = (h ^ (h >> 16)) * 0x7feb352du;
+		h = (h ^ (h >> 15)) * 0x846ca68bu;
+		return h ^ (h >> 16);
+	}
+
+	// The layer every column has at height y: bedrock, stone, dirt and grass.
+	BlockType LayerBlock(std::int32_t y)
+	{
+		if(y < 2)
+			return BlockType_BedRock;
+		if(y <= TerrainDepth/2)
+			return BlockType_Stone;
+		if(y < TerrainDepth-2)
+			return BlockType_Dirt;
+		if(y < TerrainDepth-1)
+			return BlockType_Grass;
+		return BlockType_Air;
+	}
+
+	// The block of the layer at y, or its random replacement.  The borders of
+	// bedrock/stone and stone/dirt are a 50/50 chance of either texture so they look like
+	// they blend into each other, 1 in 20 stone blocks is an emerald, and half the
+	// columns have one more grass block.
+	BlockType TerrainBlock(std::uint32_t seed, std::int32_t x, std::int32_t y, std::int32_t z, BlockType layer)
+	{
+		std::uint32_t roll = TerrainHash(seed, x, y, z);
+
+		if(y == 2)
+			return roll % 2 != 0 ? BlockType_BedRock : layer;
+		if(y > 2 && y < TerrainDepth/2)
+			return roll % 20 == 0 ? BlockType_Emerald : layer;
+		if(y == TerrainDepth/2)
+			return roll % 2 == 0 ? BlockType_Dirt : layer;
+		if(y == TerrainDepth-1)
+			return roll % 2 != 0 ? BlockType_Grass : layer;
+		return layer;
+	}
+
+	// Whether the layer at y is the same block in every column.
+	bool LayerIsPlain(std::int32_t y)
+	{
+		return y < 2 || (y > TerrainDepth/2 && y < TerrainDepth-1) || y >= TerrainDepth;
+	}
+}
+
+void GenerateTerrainChunk(std::uint32_t seed, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, WorldChunk& chunk)
+{
+	const std::int32_t baseX = std::int32_t(cx * Dims::SizeX);
+	const std::int32_t baseY = std::int32_t(cy * Dims::SizeY);
+	const std::int32_t baseZ = std::int32_t(cz * Dims::SizeZ);
+
+	for(std::uint32_t ly = 0; ly < Dims::SizeY; ++ly)
+	{
+		std::int32_t y = baseY + std::int32_t(ly);
+		BlockType layer = LayerBlock(y);
+
+		for(std::uint32_t lz = 0; lz < Dims::SizeZ; ++lz)
+		{
+			for(std::uint32_t lx = 0; lx < Dims::SizeX; ++lx)
+			{
+				chunk.Set(lx, ly, lz, LayerIsPlain(y) ? layer :
+					TerrainBlock(seed, baseX + std::int32_t(lx), y, baseZ + std::int32_t(lz), layer));
+			}
+		}
+	}
+}
+
+void GenerateTerrain(World& world, std::int32_t size, std::uint32_t seed)
+{
+	world.Resize(size, TerrainDepth, size);
+
+	WorldChunk generated;
+	for(std::uint32_t cy = 0; cy < world.ChunksY(); ++cy)
+	{
+		for(std::uint32_t cz = 0; cz < world.ChunksZ(); ++cz)
+		{
+			for(std::uint32_t cx = 0; cx < world.ChunksX(); ++cx)
+			{
+				GenerateTerrainChunk(seed, cx, cy, cz, generated);
+				if(generated.IsUniform())
+					world.FillChunk(cx, cy, cz, generated[0]);
+				else
+					world.AdoptChunk(cx, cy, cz, std::make_shared<WorldChunk>(generated));
+			}
+		}
+	}
+
+	for(std::uint32_t cz = 0; cz < world.ChunksZ(); ++cz)
+	{
+		for(std::uint32_t cx = 0; cx < world.ChunksX(); ++cx)
+			world.RefreshSurface(cx, cz);
+	}
+
+	world.Compact();
+}
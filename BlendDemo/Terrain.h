@@ -0,0 +1,28 @@
+//***************************************************************************************
+// Terrain.h
+//
+// The demo's terrain generator: columns of bedrock, stone with the odd emerald, dirt
+// and grass, with the borders between layers blended at random.  Generation is a
+// pure function of a seed and the chunk's coordinates, so chunks can be generated in
+// any order, on any thread, and generated again later with the same blocks.
+//***************************************************************************************
+
+#pragma once
+
+#include "World.h"
+
+// Bumped whenever the terrain generated from a seed changes.  Saved chunks are deltas
+// against the generated ones, so a save made by another generator cannot be loaded.
+const std::uint32_t TerrainVersion = 1;
+
+// Height of the generated terrain in blocks.  Columns are TerrainDepth - 1 or
+// TerrainDepth blocks tall.
+const std::int32_t TerrainDepth = 8;
+
+// Fills chunk with the blocks of chunk cx, cy, cz of the terrain of seed.  Above the
+// terrain is air.
+void GenerateTerrainChunk(std::uint32_t seed, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, WorldChunk& chunk);
+
+// Resizes world to size x TerrainDepth x size blocks, fills every chunk with the
+// terrain of seed and compacts it.
+void GenerateTerrain(World& world, std::int32_t size, std::uint32_t seed);
@@ -0,0 +1,126 @@
+//***************************************************************************************
+// TransformStore.cpp
+//***************************************************************************************
+
+#include "TransformStore.h"
+#include "Simd.h"
+
+#include <cassert>
+
+namespace
+{
+	const float gIdentity[16] =
+	{
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	};
+
+	void Scatter(float (*elements)[TransformStore::Width], std::uint32_t lane, const float* m)
+	{
+		for(int e = 0; e < 16; ++e)
+			elements[e][lane] = m[e];
+	}
+
+	// Writes the transpose of every valid lane's matrix to dst + lane * stride.
+	void WriteTransposedMatrices(const float (*elements)[TransformStore::Width], std::uint32_t lanes,
+		std::uint8_t* dst, std::uint32_t stride)
+	{
+#if BLEND_SSE2
+		if(lanes == TransformStore::Width)
+		{
+			for(int r = 0; r < 4; ++r)
+			{
+				// Element (c, r) of four matrices per load; the transpose turns them
+				// into row r of each transposed matrix.
+				__m128 v0 = _mm_loadu_ps(elements[0 * 4 + r]);
+				__m128 v1 = _mm_loadu_ps(elements[1 * 4 + r]);
+				__m128 v2 = _mm_loadu_ps(elements[2 * 4 + r]);
+				__m128 v3 = _mm_loadu_ps(elements[3 * 4 + r]);
+
+				_MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+
+				_mm_storeu_ps((float*)(dst + 0 * stride) + r * 4, v0);
+				_mm_storeu_ps((float*)(dst + 1 * stride) + r * 4, v1);
+				_mm_storeu_ps((float*)(dst + 2 * stride) + r * 4, v2);
+				_mm_storeu_ps((float*)(dst + 3 * stride) + r * 4, v3);
+			}
+			return;
+		}
+#endif
+
+		for(std::uint32_t lane = 0; lane < lanes; ++lane)
+		{
+			float* out = (float*)(dst + lane * stride);
+			for(int r = 0; r < 4; ++r)
+			{
+				for(int c = 0; c < 4; ++c)
+					out[r * 4 + c] = elements[c * 4 + r][lane];
+			}
+		}
+	}
+}
+
+const std::uint32_t TransformStore::Width;
+
+std::uint32_t TransformStore::Add(const float* world, const float* texTransform)
+{
+	std::uint32_t index = mCount++;
+	if(index % Width == 0)
+	{
+		// Unused lanes hold identities, so a partial block is still valid data.
+		Block block;
+		for(std::uint32_t lane = 0; lane < Width; ++lane)
+		{
+			Scatter(block.World, lane, gIdentity);
+			Scatter(block.TexTransform, lane, gIdentity);
+		}
+		mBlocks.push_back(block);
+	}
+
+	SetWorld(index, world);
+	SetTexTransform(index, texTransform != nullptr ? texTransform : gIdentity);
+	return index;
+}
+
+void TransformStore::SetWorld(std::uint32_t index, const float* world)
+{
+	assert(index < mCount);
+	Scatter(mBlocks[index / Width].World, index % Width, world);
+}
+
+void TransformStore::SetTexTransform(std::uint32_t index, const float* texTransform)
+{
+	assert(index < mCount);
+	Scatter(mBlocks[index / Width].TexTransform, index % Width, texTransform);
+}
+
+void TransformStore::GetWorld(std::uint32_t index, float* world)const
+{
+	assert(index < mCount);
+	const Block& block = mBlocks[index / Width];
+	for(int e = 0; e < 16; ++e)
+		world[e] = block.World[e][index % Width];
+}
+
+void TransformStore::GetTranslation(std::uint32_t index, float* xyz)const
+{
+	assert(index < mCount);
+	const Block& block = mBlocks[index / Width];
+	xyz[0] = block.World[12][index % Width];
+	xyz[1] = block.World[13][index % Width];
+	xyz[2] = block.World[14][index % Width];
+}
+
+void TransformStore::WriteTransposed(std::uint32_t block, void* dst, std::uint32_t stride)const
+{
+	assert(block < mBlocks.size());
+
+	std::uint32_t first = block * Width;
+	std::uint32_t lanes = mCount - first < Width ? mCount - first : Width;
+
+	std::uint8_t* out = static_cast<std::uint8_t*>(dst);
+	WriteTransposedMatrices(mBlocks[block].World, lanes, out, stride);
+	WriteTransposedMatrices(mBlocks[block].TexTransform, lanes, out + 16 * sizeof(float), stride);
+}
@@ -0,0 +1,55 @@
+//***************************************************************************************
+// TransformStore.h
+//
+// World and texture transforms of every object, indexed by object constant buffer
+// index.  They are kept in blocks of Width transforms with each matrix element stored
+// for the whole block side by side, so a block's elements load Width at a time.  The
+// object constants want the matrices transposed, and in this layout a transposed row
+// of Width matrices is one 4x4 transpose of four loads.
+//
+// That is the same loads, shuffles and stores per matrix as transposing each one on
+// its own, so the layout saves no arithmetic.  What it saves is the staging copy and
+// the trip through every render item, and that is small next to the 128 bytes each
+// object writes: the upload is bound by memory bandwidth either way.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class TransformStore
+{
+public:
+	static const std::uint32_t Width = 4;
+
+	// Matrices are 16 floats in row-major order, as in XMFLOAT4X4.  A null texture
+	// transform is the identity.
+	std::uint32_t Add(const float* world, const float* texTransform = nullptr);
+
+	void SetWorld(std::uint32_t index, const float* world);
+	void SetTexTransform(std::uint32_t index, const float* texTransform);
+	void GetWorld(std::uint32_t index, float* world)const;
+
+	// The translation row of the world matrix.
+	void GetTranslation(std::uint32_t index, float* xyz)const;
+
+	std::uint32_t Size()const { return mCount; }
+	std::uint32_t BlockCount()const { return (std::uint32_t)mBlocks.size(); }
+
+	// Writes the transposed world matrix followed by the transposed texture transform,
+	// 32 floats, for each transform of block to dst + lane * stride.  Lanes past Size()
+	// are left alone.  dst is usually mapped upload heap memory, so each matrix row is
+	// written whole and in order.
+	void WriteTransposed(std::uint32_t block, void* dst, std::uint32_t stride)const;
+
+private:
+	struct Block
+	{
+		float World[16][Width];
+		float TexTransform[16][Width];
+	};
+
+	std::vector<Block> mBlocks;
+	std::uint32_t mCount = 0;
+};
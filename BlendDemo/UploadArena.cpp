@@ -0,0 +1,60 @@
+//***************************************************************************************
+// UploadArena.cpp
+//***************************************************************************************
+
+#include "UploadArena.h"
+
+UploadArena::UploadArena(RenderDevice& device, std::uint32_t byteSize)
+	: mDevice(device)
+{
+	// Constant usage with Granularity sized elements makes every element a legal
+	// constant buffer view start.
+	BufferDesc desc;
+	desc.Usage = BufferUsage::Constant;
+	desc.ElementCount = (byteSize + Granularity - 1) / Granularity;
+	desc.ElementByteSize = Granularity;
+	desc.CpuWritable = true;
+
+	mBuffer = mDevice.CreateBuffer(desc, nullptr);
+	mAllocator.SetCapacity(desc.ElementCount * Granularity);
+}
+
+UploadAllocation UploadArena::Allocate(std::uint32_t byteSize)
+{
+	UploadAllocation allocation;
+
+	std::uint64_t demand = (std::uint64_t)mDemand + ((std::uint64_t)byteSize + Granularity - 1) / Granularity * Granularity;
+	mDemand = demand > 0xffffffffu ? 0xffffffffu : (std::uint32_t)demand;
+
+	std::uint32_t offset = mAllocator.Allocate(byteSize, Granularity);
+	if(offset == LinearAllocator::InvalidOffset)
+		return allocation;
+
+	allocation.Buffer = mBuffer;
+	allocation.Element = offset / Granularity;
+	allocation.Data = mDevice.MapElements(mBuffer, allocation.Element, (byteSize + Granularity - 1) / Granularity);
+	return allocation;
+}
+
+void UploadArena::Reset(std::uint32_t minByteSize)
+{
+	std::uint32_t required = minByteSize > mDemand ? minByteSize : mDemand;
+	std::uint32_t elementCount = mDevice.ElementCount(mBuffer);
+	std::uint32_t requiredCount = (std::uint32_t)(((std::uint64_t)required + Granularity - 1) / Granularity);
+
+	mAllocator.Reset();
+	mDemand = 0;
+
+	// Offsets are 32 bit, which caps the arena just short of 4GB.
+	const std::uint32_t maxCount = 0xffffffffu / Granularity;
+	if(requiredCount > elementCount && elementCount < maxCount)
+	{
+		elementCount = GrowCapacity(elementCount, requiredCount);
+		if(elementCount > maxCount)
+			elementCount = maxCount;
+
+		mDevice.GrowBuffer(mBuffer, elementCount);
+		mAllocator.SetCapacity(elementCount * Granularity);
+		mGrows++;
+	}
+}
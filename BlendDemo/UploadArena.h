@@ -0,0 +1,67 @@
+//***************************************************************************************
+// UploadArena.h
+//
+// One large CPU writable buffer per frame resource, carved up with a LinearAllocator
+// for the data that is rewritten every frame: pass constants and block instances.
+// Allocations are aligned to the constant buffer placement rule, so any of them can
+// be bound as a constant buffer or a root shader resource.  The arena is reset when
+// its frame resource comes round again, after the frame's fence has passed, and grows
+// then if the previous frame asked for more than it had.
+//***************************************************************************************
+
+#pragma once
+
+#include "LinearAllocator.h"
+#include "RenderBackend.h"
+
+// Where an allocation lives.  Element counts in Granularity sized steps, which is what
+// RenderContext binds by.  Data is null when the arena was full.
+struct UploadAllocation
+{
+	void* Data = nullptr;
+	BufferHandle Buffer = InvalidBuffer;
+	std::uint32_t Element = 0;
+
+	bool Valid()const { return Data != nullptr; }
+};
+
+class UploadArena
+{
+public:
+	static const std::uint32_t Granularity = 256;
+
+	UploadArena(RenderDevice& device, std::uint32_t byteSize);
+	UploadArena(const UploadArena& rhs) = delete;
+	UploadArena& operator=(const UploadArena& rhs) = delete;
+
+	UploadAllocation Allocate(std::uint32_t byteSize);
+
+	template<typename T>
+	UploadAllocation Push(const T& value)
+	{
+		UploadAllocation allocation = Allocate((std::uint32_t)sizeof(T));
+		if(allocation.Valid())
+			*static_cast<T*>(allocation.Data) = value;
+		return allocation;
+	}
+
+	// Frees every allocation, first growing the arena to hold at least minByteSize and
+	// everything asked of it since the last reset, failed allocations included.  Only
+	// call once the GPU has finished the frames that read the arena.
+	void Reset(std::uint32_t minByteSize = 0);
+
+	// Bytes asked for since the last reset, rounded up to Granularity.  Can be more
+	// than the capacity when allocations failed.
+	std::uint32_t Demand()const { return mDemand; }
+	std::uint32_t Grows()const { return mGrows; }
+
+	BufferHandle Buffer()const { return mBuffer; }
+	const LinearAllocator& Allocator()const { return mAllocator; }
+
+private:
+	RenderDevice& mDevice;
+	BufferHandle mBuffer = InvalidBuffer;
+	LinearAllocator mAllocator;
+	std::uint32_t mDemand = 0;
+	std::uint32_t mGrows = 0;
+};
@@ -0,0 +1,88 @@
+//***************************************************************************************
+// WorkerPool.cpp
+//***************************************************************************************
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(unsigned threadCount)
+	: mNextTask(0)
+{
+	mThreads.reserve(threadCount);
+	for(unsigned i = 0; i < threadCount; ++i)
+		mThreads.emplace_back(&WorkerPool::WorkerMain, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mWake.notify_all();
+
+	for(auto& t : mThreads)
+		t.join();
+}
+
+void WorkerPool::Run(std::uint32_t taskCount, const std::function<void(std::uint32_t)>& task)
+{
+	if(taskCount == 0)
+		return;
+
+	if(mThreads.empty())
+	{
+		for(std::uint32_t i = 0; i < taskCount; ++i)
+			task(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTask = &task;
+		mTaskCount = taskCount;
+		mNextTask = 0;
+		mWorkersDone = 0;
+		++mGeneration;
+	}
+	mWake.notify_all();
+
+	Drain();
+
+	// Every worker checks in once per batch, even if the calling thread already took
+	// all the tasks.  That way no worker can still be looking at this batch when the
+	// next one starts.
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDone.wait(lock, [this] { return mWorkersDone == mThreads.size(); });
+	mTask = nullptr;
+}
+
+void WorkerPool::WorkerMain()
+{
+	std::uint64_t seen = 0;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	for(;;)
+	{
+		mWake.wait(lock, [&] { return mQuit || mGeneration != seen; });
+		if(mQuit)
+			return;
+
+		seen = mGeneration;
+
+		lock.unlock();
+		Drain();
+		lock.lock();
+
+		if(++mWorkersDone == mThreads.size())
+			mDone.notify_one();
+	}
+}
+
+void WorkerPool::Drain()
+{
+	const std::function<void(std::uint32_t)>& task = *mTask;
+	const std::uint32_t count = mTaskCount;
+
+	for(std::uint32_t i = mNextTask++; i < count; i = mNextTask++)
+		task(i);
+}
@@ -0,0 +1,51 @@
+//***************************************************************************************
+// WorkerPool.h
+//
+// A fixed set of threads that run a batch of numbered tasks together with the calling
+// thread.  Run blocks until every task in the batch has finished, so the caller never
+// has to deal with tasks that outlive the data they were given.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+public:
+	explicit WorkerPool(unsigned threadCount);
+	WorkerPool(const WorkerPool& rhs) = delete;
+	WorkerPool& operator=(const WorkerPool& rhs) = delete;
+	~WorkerPool();
+
+	// Threads owned by the pool, not counting the thread that calls Run.
+	unsigned ThreadCount()const { return (unsigned)mThreads.size(); }
+
+	// Calls task(i) once for every i in [0, taskCount).  Tasks must not throw.
+	void Run(std::uint32_t taskCount, const std::function<void(std::uint32_t)>& task);
+
+private:
+	void WorkerMain();
+	void Drain();
+
+	std::vector<std::thread> mThreads;
+
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mDone;
+
+	// Batch state, written under mMutex before mGeneration is bumped.
+	const std::function<void(std::uint32_t)>* mTask = nullptr;
+	std::uint32_t mTaskCount = 0;
+	std::atomic<std::uint32_t> mNextTask;
+
+	std::uint64_t mGeneration = 0;
+	unsigned mWorkersDone = 0;
+	bool mQuit = false;
+};
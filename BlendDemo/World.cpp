@@ -0,0 +1,325 @@
+//***************************************************************************************
+// World.cpp
+//***************************************************************************************
+
+#include "World.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+namespace
+{
+	typedef WorldChunk::Dims Dims;
+
+	std::uint32_t ChunksFor(std::uint32_t blocks, std::uint32_t chunkSize)
+	{
+		return (blocks + chunkSize - 1) / chunkSize;
+	}
+
+	// FNV-1a over the blocks, eight at a time.
+	std::uint64_t HashChunk(const WorldChunk& chunk)
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		const BlockType* blocks = chunk.Data();
+		for(std::uint32_t i = 0; i < Dims::Volume; i += 8)
+		{
+			std::uint64_t word;
+			std::memcpy(&word, blocks + i, sizeof(word));
+			hash = (hash ^ word) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	static_assert(Dims::Volume % 8 == 0, "HashChunk reads whole eight block words.");
+}
+
+void World::Resize(std::uint32_t sizeX, std::uint32_t sizeY, std::uint32_t sizeZ)
+{
+	mChunksX = ChunksFor(sizeX, Dims::SizeX);
+	mChunksY = ChunksFor(sizeY, Dims::SizeY);
+	mChunksZ = ChunksFor(sizeZ, Dims::SizeZ);
+
+	mChunks.assign((std::size_t)mChunksX * mChunksY * mChunksZ, UniformChunk(BlockType_Air));
+
+	ColumnSurface empty;
+	std::fill(std::begin(empty.SolidTop), std::end(empty.SolidTop), (std::int16_t)-1);
+	std::fill(std::begin(empty.LightTop), std::end(empty.LightTop), (std::int16_t)-1);
+	std::fill(std::begin(empty.TopType), std::end(empty.TopType), BlockType_Air);
+	mSurfaces.assign((std::size_t)mChunksX * mChunksZ, empty);
+
+	mDirtyChunks = DirtyList();
+	mDirtyChunks.Resize((std::uint32_t)mChunks.size());
+}
+
+bool World::Contains(std::int32_t x, std::int32_t y, std::int32_t z)const
+{
+	return (std::uint32_t)x < SizeX() && (std::uint32_t)y < SizeY() && (std::uint32_t)z < SizeZ();
+}
+
+std::size_t World::ChunkIndex(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)const
+{
+	assert(cx < mChunksX && cy < mChunksY && cz < mChunksZ);
+	return cx + (std::size_t)mChunksX * (cz + (std::size_t)mChunksZ * cy);
+}
+
+const std::shared_ptr<WorldChunk>& World::UniformChunk(BlockType type)
+{
+	std::shared_ptr<WorldChunk>& chunk = mUniformChunks[type];
+	if(!chunk)
+	{
+		chunk = std::make_shared<WorldChunk>();
+		chunk->Fill(type);
+	}
+	return chunk;
+}
+
+BlockType World::Get(std::int32_t x, std::int32_t y, std::int32_t z)const
+{
+	if(!Contains(x, y, z))
+		return BlockType_Air;
+
+	const WorldChunk& chunk = GetChunk(x / Dims::SizeX, y / Dims::SizeY, z / Dims::SizeZ);
+	return chunk.Get(x % Dims::SizeX, y % Dims::SizeY, z % Dims::SizeZ);
+}
+
+void World::Set(std::int32_t x, std::int32_t y, std::int32_t z, BlockType type)
+{
+	assert(Contains(x, y, z));
+
+	// Writing what is already there would copy a shared chunk for nothing.
+	std::uint32_t cx = x / Dims::SizeX, cy = y / Dims::SizeY, cz = z / Dims::SizeZ;
+	std::uint32_t lx = x % Dims::SizeX, ly = y % Dims::SizeY, lz = z % Dims::SizeZ;
+	std::uint32_t index = Dims::Index(lx, ly, lz);
+	std::size_t chunkIndex = ChunkIndex(cx, cy, cz);
+	if((*mChunks[chunkIndex])[index] == type)
+		return;
+
+	EditChunk(cx, cy, cz)[index] = type;
+	UpdateSurface(x, y, z, type);
+
+	// Only a block on the chunk's edge dirties its neighbours too.
+	if(lx - 1 < Dims::SizeX - 2 && ly - 1 < Dims::SizeY - 2 && lz - 1 < Dims::SizeZ - 2)
+		mDirtyChunks.Mark((std::uint32_t)chunkIndex);
+	else
+		MarkDirty(MakeBlockBox(x, y, z, x + 1, y + 1, z + 1));
+}
+
+void World::MarkDirty(const BlockBox& box)
+{
+	// The box grows by a block since the chunks next to it mesh against its edges.
+	std::int32_t minCX = std::max(box.MinX - 1, 0) / (std::int32_t)Dims::SizeX;
+	std::int32_t minCY = std::max(box.MinY - 1, 0) / (std::int32_t)Dims::SizeY;
+	std::int32_t minCZ = std::max(box.MinZ - 1, 0) / (std::int32_t)Dims::SizeZ;
+	std::int32_t maxCX = std::min(box.MaxX, (std::int32_t)SizeX() - 1) / (std::int32_t)Dims::SizeX;
+	std::int32_t maxCY = std::min(box.MaxY, (std::int32_t)SizeY() - 1) / (std::int32_t)Dims::SizeY;
+	std::int32_t maxCZ = std::min(box.MaxZ, (std::int32_t)SizeZ() - 1) / (std::int32_t)Dims::SizeZ;
+
+	for(std::int32_t cy = minCY; cy <= maxCY; ++cy)
+	{
+		for(std::int32_t cz = minCZ; cz <= maxCZ; ++cz)
+		{
+			for(std::int32_t cx = minCX; cx <= maxCX; ++cx)
+				mDirtyChunks.Mark((std::uint32_t)ChunkIndex(cx, cy, cz));
+		}
+	}
+}
+
+std::uint32_t World::SurfaceColumn(std::int32_t x, std::int32_t z)
+{
+	return (x % Dims::SizeX) + Dims::SizeX * (z % Dims::SizeZ);
+}
+
+ColumnSurface& World::SurfaceOf(std::int32_t x, std::int32_t z)
+{
+	return mSurfaces[x / Dims::SizeX + (std::size_t)mChunksX * (z / Dims::SizeZ)];
+}
+
+const ColumnSurface* World::FindSurface(std::int32_t x, std::int32_t z)const
+{
+	if((std::uint32_t)x >= SizeX() || (std::uint32_t)z >= SizeZ())
+		return nullptr;
+	return &mSurfaces[x / Dims::SizeX + (std::size_t)mChunksX * (z / Dims::SizeZ)];
+}
+
+std::int32_t World::SurfaceHeight(std::int32_t x, std::int32_t z)const
+{
+	const ColumnSurface* surface = FindSurface(x, z);
+	return surface ? surface->SolidTop[SurfaceColumn(x, z)] : -1;
+}
+
+std::int32_t World::LightHeight(std::int32_t x, std::int32_t z)const
+{
+	const ColumnSurface* surface = FindSurface(x, z);
+	return surface ? surface->LightTop[SurfaceColumn(x, z)] : -1;
+}
+
+BlockType World::SurfaceBlock(std::int32_t x, std::int32_t z)const
+{
+	const ColumnSurface* surface = FindSurface(x, z);
+	return surface ? surface->TopType[SurfaceColumn(x, z)] : BlockType_Air;
+}
+
+std::int32_t World::FindTop(std::int32_t x, std::int32_t fromY, std::int32_t z, bool (*test)(BlockType))const
+{
+	const std::shared_ptr<WorldChunk>& air = mUniformChunks[BlockType_Air];
+	std::uint32_t cx = x / Dims::SizeX, cz = z / Dims::SizeZ;
+
+	for(std::int32_t y = fromY; y >= 0;)
+	{
+		std::uint32_t cy = y / Dims::SizeY;
+		const std::shared_ptr<WorldChunk>& chunk = mChunks[ChunkIndex(cx, cy, cz)];
+
+		// The empty chunks above the ground are skipped whole.
+		std::int32_t chunkBottom = (std::int32_t)(cy * Dims::SizeY);
+		if(chunk == air)
+		{
+			y = chunkBottom - 1;
+			continue;
+		}
+
+		for(; y >= chunkBottom; --y)
+		{
+			if(test(chunk->Get(x % Dims::SizeX, y % Dims::SizeY, z % Dims::SizeZ)))
+				return y;
+		}
+	}
+	return -1;
+}
+
+void World::UpdateSurface(std::int32_t x, std::int32_t y, std::int32_t z, BlockType type)
+{
+	ColumnSurface& surface = SurfaceOf(x, z);
+	std::uint32_t column = SurfaceColumn(x, z);
+
+	// A block above the top becomes the top; removing the top block means looking
+	// down for the next one.  Anything lower leaves the top alone.
+	if(BlockIsSolid(type) ? y >= surface.SolidTop[column] : y == surface.SolidTop[column])
+	{
+		std::int32_t top = BlockIsSolid(type) ? y : FindTop(x, y - 1, z, BlockIsSolid);
+		surface.SolidTop[column] = (std::int16_t)top;
+		surface.TopType[column] = top == y ? type : top >= 0 ? Get(x, top, z) : BlockType_Air;
+	}
+
+	if(BlockBlocksLight(type) ? y >= surface.LightTop[column] : y == surface.LightTop[column])
+		surface.LightTop[column] = (std::int16_t)(BlockBlocksLight(type) ? y : FindTop(x, y - 1, z, BlockBlocksLight));
+}
+
+void World::RefreshSurface(std::uint32_t cx, std::uint32_t cz)
+{
+	ColumnSurface& surface = mSurfaces[cx + (std::size_t)mChunksX * cz];
+	std::int32_t topY = (std::int32_t)SizeY() - 1;
+
+	for(std::uint32_t lz = 0; lz < Dims::SizeZ; ++lz)
+	{
+		for(std::uint32_t lx = 0; lx < Dims::SizeX; ++lx)
+		{
+			std::int32_t x = (std::int32_t)(cx * Dims::SizeX + lx);
+			std::int32_t z = (std::int32_t)(cz * Dims::SizeZ + lz);
+			std::uint32_t column = SurfaceColumn(x, z);
+
+			std::int32_t solidTop = FindTop(x, topY, z, BlockIsSolid);
+			surface.SolidTop[column] = (std::int16_t)solidTop;
+			surface.TopType[column] = solidTop >= 0 ? Get(x, solidTop, z) : BlockType_Air;
+			surface.LightTop[column] = (std::int16_t)FindTop(x, topY, z, BlockBlocksLight);
+		}
+	}
+}
+
+const WorldChunk& World::GetChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)const
+{
+	return *mChunks[ChunkIndex(cx, cy, cz)];
+}
+
+WorldChunk& World::EditChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)
+{
+	std::shared_ptr<WorldChunk>& chunk = mChunks[ChunkIndex(cx, cy, cz)];
+	if(chunk.use_count() > 1)
+		chunk = std::make_shared<WorldChunk>(*chunk);
+	return *chunk;
+}
+
+std::shared_ptr<const WorldChunk> World::ShareChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)const
+{
+	return mChunks[ChunkIndex(cx, cy, cz)];
+}
+
+void World::FillChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, BlockType type)
+{
+	mChunks[ChunkIndex(cx, cy, cz)] = UniformChunk(type);
+}
+
+void World::AdoptChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, const std::shared_ptr<const WorldChunk>& storage)
+{
+	// Shared storage is only ever written after EditChunk has made it private, so
+	// dropping const here does not let anyone write to what others hold.
+	mChunks[ChunkIndex(cx, cy, cz)] = std::const_pointer_cast<WorldChunk>(storage);
+}
+
+std::size_t World::Compact()
+{
+	std::size_t released = 0;
+	std::unordered_map<std::uint64_t, std::vector<std::shared_ptr<WorldChunk>>> byHash;
+
+	for(std::shared_ptr<WorldChunk>& chunk : mChunks)
+	{
+		const std::shared_ptr<WorldChunk>& uniform = UniformChunk((*chunk)[0]);
+		if(chunk == uniform)
+			continue;
+
+		std::shared_ptr<WorldChunk> shared;
+		if(chunk->IsUniform())
+		{
+			shared = uniform;
+		}
+		else
+		{
+			std::vector<std::shared_ptr<WorldChunk>>& candidates = byHash[HashChunk(*chunk)];
+			for(const std::shared_ptr<WorldChunk>& candidate : candidates)
+			{
+				if(candidate == chunk || std::memcmp(candidate->Data(), chunk->Data(), Dims::Volume) == 0)
+				{
+					shared = candidate;
+					break;
+				}
+			}
+
+			if(!shared)
+			{
+				candidates.push_back(chunk);
+				continue;
+			}
+		}
+
+		if(shared != chunk)
+		{
+			if(chunk.use_count() == 1)
+				released++;
+			chunk = shared;
+		}
+	}
+	return released;
+}
+
+WorldMemoryStats World::MemoryStats()const
+{
+	WorldMemoryStats stats;
+	stats.Chunks = mChunks.size();
+
+	std::unordered_map<const WorldChunk*, bool> seen;
+	for(const std::shared_ptr<WorldChunk>& chunk : mChunks)
+	{
+		if(seen.emplace(chunk.get(), true).second)
+		{
+			stats.StoredChunks++;
+			if(chunk == mUniformChunks[(*chunk)[0]])
+				stats.UniformChunks++;
+		}
+	}
+
+	stats.StoredBytes = stats.StoredChunks * sizeof(WorldChunk);
+	stats.DenseBytes = stats.Chunks * sizeof(WorldChunk);
+	return stats;
+}
@@ -0,0 +1,233 @@
+//***************************************************************************************
+// World.h
+//
+// The blocks of the whole world, kept as a grid of 16x16x16 chunks.  Block
+// coordinates start at zero in the world's low corner; anything outside reads as air.
+//
+// Chunk storage is shared and copied on write.  Every chunk made of a single block
+// type, such as the air above the ground or the stone and bedrock below it, points at
+// one shared chunk of that type, and Compact() makes identical chunks share one copy.
+// The first edit of a shared chunk gives it a private copy.  Memory then grows with
+// the number of distinct chunks, which follows the detail of the surface rather than
+// the volume of the world.
+//
+// For every block column the world also keeps its top: the highest solid block, the
+// highest block that stops sky light and the type of the top block.  Set keeps them
+// current as it goes, so "top of column" queries for lighting, spawning, shadows and
+// the map view never scan.
+//***************************************************************************************
+
+#pragma once
+
+#include "Chunk.h"
+#include "DirtyList.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+typedef Chunk<16, 16, 16> WorldChunk;
+
+// The tops of the block columns of one column of chunks.  Heights are world block y,
+// or -1 for a column with no such block.
+struct ColumnSurface
+{
+	static const std::uint32_t Columns = WorldChunk::Dims::SizeX * WorldChunk::Dims::SizeZ;
+
+	std::int16_t SolidTop[Columns];
+	std::int16_t LightTop[Columns];
+	BlockType TopType[Columns];
+};
+
+// A box of blocks, from Min up to but not including Max.
+struct BlockBox
+{
+	std::int32_t MinX = 0;
+	std::int32_t MinY = 0;
+	std::int32_t MinZ = 0;
+	std::int32_t MaxX = 0;
+	std::int32_t MaxY = 0;
+	std::int32_t MaxZ = 0;
+
+	bool Empty()const { return MinX >= MaxX || MinY >= MaxY || MinZ >= MaxZ; }
+};
+
+inline BlockBox MakeBlockBox(std::int32_t minX, std::int32_t minY, std::int32_t minZ,
+	std::int32_t maxX, std::int32_t maxY, std::int32_t maxZ)
+{
+	BlockBox box;
+	box.MinX = minX;
+	box.MinY = minY;
+	box.MinZ = minZ;
+	box.MaxX = maxX;
+	box.MaxY = maxY;
+	box.MaxZ = maxZ;
+	return box;
+}
+
+// A chunk's coordinates: block coordinates divided by the chunk size.
+struct ChunkCoord
+{
+	std::uint32_t X;
+	std::uint32_t Y;
+	std::uint32_t Z;
+};
+
+// True when the centre of chunk is within radius blocks of centre, in world block
+// coordinates.
+inline bool ChunkInSphere(const ChunkCoord& chunk, const float centre[3], float radius)
+{
+	float dx = (chunk.X + 0.5f) * WorldChunk::Dims::SizeX - centre[0];
+	float dy = (chunk.Y + 0.5f) * WorldChunk::Dims::SizeY - centre[1];
+	float dz = (chunk.Z + 0.5f) * WorldChunk::Dims::SizeZ - centre[2];
+	return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+// Calls fn(chunk) for every chunk of a world of chunksX x chunksY x chunksZ chunks
+// whose centre is within radius blocks of centre, y slowest and x fastest.
+template<typename Fn>
+void ForEachChunkInSphere(const float centre[3], float radius,
+	std::uint32_t chunksX, std::uint32_t chunksY, std::uint32_t chunksZ, Fn fn)
+{
+	const std::uint32_t sizes[3] = { WorldChunk::Dims::SizeX, WorldChunk::Dims::SizeY, WorldChunk::Dims::SizeZ };
+	const std::uint32_t chunks[3] = { chunksX, chunksY, chunksZ };
+	std::int32_t first[3];
+	std::int32_t last[3];
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		first[axis] = std::max((std::int32_t)std::floor((centre[axis] - radius) / sizes[axis]), 0);
+		last[axis] = std::min((std::int32_t)std::floor((centre[axis] + radius) / sizes[axis]), (std::int32_t)chunks[axis] - 1);
+	}
+
+	for(std::int32_t cy = first[1]; cy <= last[1]; ++cy)
+	{
+		for(std::int32_t cz = first[2]; cz <= last[2]; ++cz)
+		{
+			for(std::int32_t cx = first[0]; cx <= last[0]; ++cx)
+			{
+				ChunkCoord chunk = { (std::uint32_t)cx, (std::uint32_t)cy, (std::uint32_t)cz };
+				if(ChunkInSphere(chunk, centre, radius))
+					fn(chunk);
+			}
+		}
+	}
+}
+
+// What the world's chunks cost.
+struct WorldMemoryStats
+{
+	std::size_t Chunks = 0;
+
+	// Distinct chunk storage, shared uniform chunks included.
+	std::size_t StoredChunks = 0;
+	std::size_t UniformChunks = 0;
+
+	std::size_t StoredBytes = 0;
+	std::size_t DenseBytes = 0;
+};
+
+class World
+{
+public:
+	// Sized to hold at least sizeX x sizeY x sizeZ blocks, all air.
+	void Resize(std::uint32_t sizeX, std::uint32_t sizeY, std::uint32_t sizeZ);
+
+	BlockType Get(std::int32_t x, std::int32_t y, std::int32_t z)const;
+	void Set(std::int32_t x, std::int32_t y, std::int32_t z, BlockType type);
+
+	// y of the highest solid block of column x, z, or -1 when there is none.
+	std::int32_t SurfaceHeight(std::int32_t x, std::int32_t z)const;
+
+	// y of the highest block of column x, z that stops sky light, or -1.
+	std::int32_t LightHeight(std::int32_t x, std::int32_t z)const;
+
+	// Type of the highest solid block of column x, z; air when there is none.
+	BlockType SurfaceBlock(std::int32_t x, std::int32_t z)const;
+
+	// Chunk coordinates are block coordinates divided by the chunk size.
+	const WorldChunk& GetChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)const;
+
+	// The chunk for writing.  Gives the chunk its own copy first when its storage is
+	// shared, so the reference is only good until the next call that edits the world.
+	// Neither column tops nor dirty chunks are updated; call RefreshSurface for the
+	// chunk's column and MarkDirty for what was written after.
+	WorldChunk& EditChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz);
+
+	// Recomputes the column tops of chunk column cx, cz from its blocks.
+	void RefreshSurface(std::uint32_t cx, std::uint32_t cz);
+
+	// The chunk's storage, for holding on to an immutable version of it.  Edits made
+	// after this go to a copy and leave what was returned alone.
+	std::shared_ptr<const WorldChunk> ShareChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)const;
+
+	// Makes chunk cx, cy, cz the shared chunk of type, dropping its blocks.  Like
+	// EditChunk it leaves column tops and dirty chunks to the caller, so bulk edits can
+	// update them once at the end.
+	void FillChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, BlockType type);
+
+	// Points chunk cx, cy, cz at storage, such as another chunk's from ShareChunk, which
+	// it then shares.  Like FillChunk, it leaves column tops and dirty chunks to the
+	// caller.
+	void AdoptChunk(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, const std::shared_ptr<const WorldChunk>& storage);
+
+	// Chunks whose blocks, or whose neighbours' blocks next to them, changed since they
+	// were last flushed, and so need meshing again.  Every chunk starts out dirty.
+	// MarkDirty marks every chunk within a block of box.
+	void MarkDirty(const BlockBox& box);
+
+	// Calls fn(cx, cy, cz) for every dirty chunk and clears them.
+	template<typename Fn>
+	void FlushDirtyChunks(Fn fn)
+	{
+		mDirtyChunks.Flush([&](std::uint32_t index)
+		{
+			fn(index % mChunksX, index / (mChunksX * mChunksZ), index / mChunksX % mChunksZ);
+		});
+	}
+
+	std::size_t DirtyChunks()const { return mDirtyChunks.Pending(); }
+
+	// Points uniform chunks at the shared chunk of their type and makes chunks with the
+	// same blocks share one copy.  For after generating or loading; returns the number of
+	// chunks whose storage was released.
+	std::size_t Compact();
+
+	WorldMemoryStats MemoryStats()const;
+
+	std::uint32_t ChunksX()const { return mChunksX; }
+	std::uint32_t ChunksY()const { return mChunksY; }
+	std::uint32_t ChunksZ()const { return mChunksZ; }
+
+	std::uint32_t SizeX()const { return mChunksX * WorldChunk::Dims::SizeX; }
+	std::uint32_t SizeY()const { return mChunksY * WorldChunk::Dims::SizeY; }
+	std::uint32_t SizeZ()const { return mChunksZ * WorldChunk::Dims::SizeZ; }
+
+private:
+	bool Contains(std::int32_t x, std::int32_t y, std::int32_t z)const;
+	std::size_t ChunkIndex(std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)const;
+	const std::shared_ptr<WorldChunk>& UniformChunk(BlockType type);
+
+	// Index of column x, z in its chunk column's ColumnSurface.
+	static std::uint32_t SurfaceColumn(std::int32_t x, std::int32_t z);
+	ColumnSurface& SurfaceOf(std::int32_t x, std::int32_t z);
+	const ColumnSurface* FindSurface(std::int32_t x, std::int32_t z)const;
+
+	// y of the highest block at or below fromY of column x, z that passes test, or -1.
+	std::int32_t FindTop(std::int32_t x, std::int32_t fromY, std::int32_t z, bool (*test)(BlockType))const;
+	void UpdateSurface(std::int32_t x, std::int32_t y, std::int32_t z, BlockType type);
+
+	std::vector<std::shared_ptr<WorldChunk>> mChunks;
+	std::uint32_t mChunksX = 0;
+	std::uint32_t mChunksY = 0;
+	std::uint32_t mChunksZ = 0;
+
+	// One per column of chunks, x fastest.
+	std::vector<ColumnSurface> mSurfaces;
+
+	// Indexed like mChunks.
+	DirtyList mDirtyChunks;
+
+	// The shared chunk of each block type, made on first use.  Never written.
+	std::shared_ptr<WorldChunk> mUniformChunks[BlockType_Count];
+};
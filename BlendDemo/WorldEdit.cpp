@@ -0,0 +1,245 @@
+//***************************************************************************************
+// WorldEdit.cpp
+//***************************************************************************************
+
+#include "WorldEdit.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace
+{
+	typedef WorldChunk::Dims Dims;
+
+	static_assert(Dims::SizeX == 16 && Dims::Index(1, 0, 0) == 1,
+		"Row edits expect a chunk row to be sixteen contiguous blocks.");
+
+	BlockBox ClipToWorld(const World& world, const BlockBox& box)
+	{
+		return MakeBlockBox(
+			std::max(box.MinX, 0), std::max(box.MinY, 0), std::max(box.MinZ, 0),
+			std::min(box.MaxX, (std::int32_t)world.SizeX()),
+			std::min(box.MaxY, (std::int32_t)world.SizeY()),
+			std::min(box.MaxZ, (std::int32_t)world.SizeZ()));
+	}
+
+	// The part of box inside chunk cx, cy, cz, in the chunk's block coordinates.
+	struct ChunkPart
+	{
+		std::uint32_t CX, CY, CZ;
+		std::uint32_t MinX, MinY, MinZ;
+		std::uint32_t MaxX, MaxY, MaxZ;
+
+		bool Whole()const
+		{
+			return MinX == 0 && MinY == 0 && MinZ == 0 &&
+				MaxX == Dims::SizeX && MaxY == Dims::SizeY && MaxZ == Dims::SizeZ;
+		}
+	};
+
+	// Calls fn(part) for every chunk box overlaps, which must be inside the world.
+	template<typename Fn>
+	void ForEachChunkPart(const BlockBox& box, Fn fn)
+	{
+		for(std::int32_t cy = box.MinY / (std::int32_t)Dims::SizeY; cy * (std::int32_t)Dims::SizeY < box.MaxY; ++cy)
+		{
+			for(std::int32_t cz = box.MinZ / (std::int32_t)Dims::SizeZ; cz * (std::int32_t)Dims::SizeZ < box.MaxZ; ++cz)
+			{
+				for(std::int32_t cx = box.MinX / (std::int32_t)Dims::SizeX; cx * (std::int32_t)Dims::SizeX < box.MaxX; ++cx)
+				{
+					ChunkPart part;
+					part.CX = cx;
+					part.CY = cy;
+					part.CZ = cz;
+					part.MinX = std::max(box.MinX - cx * (std::int32_t)Dims::SizeX, 0);
+					part.MinY = std::max(box.MinY - cy * (std::int32_t)Dims::SizeY, 0);
+					part.MinZ = std::max(box.MinZ - cz * (std::int32_t)Dims::SizeZ, 0);
+					part.MaxX = std::min(box.MaxX - cx * (std::int32_t)Dims::SizeX, (std::int32_t)Dims::SizeX);
+					part.MaxY = std::min(box.MaxY - cy * (std::int32_t)Dims::SizeY, (std::int32_t)Dims::SizeY);
+					part.MaxZ = std::min(box.MaxZ - cz * (std::int32_t)Dims::SizeZ, (std::int32_t)Dims::SizeZ);
+					fn(part);
+				}
+			}
+		}
+	}
+
+	// Column tops and meshes, once for the whole edit.
+	void FinishEdit(World& world, const BlockBox& box)
+	{
+		for(std::int32_t cz = box.MinZ / (std::int32_t)Dims::SizeZ; cz * (std::int32_t)Dims::SizeZ < box.MaxZ; ++cz)
+		{
+			for(std::int32_t cx = box.MinX / (std::int32_t)Dims::SizeX; cx * (std::int32_t)Dims::SizeX < box.MaxX; ++cx)
+				world.RefreshSurface(cx, cz);
+		}
+		world.MarkDirty(box);
+	}
+
+	// Replaces from with to in blocks [begin, end) of one sixteen block row.
+	void ReplaceInRow(BlockType* row, std::uint32_t begin, std::uint32_t end, BlockType from, BlockType to)
+	{
+#if BLEND_SSE2
+		// Lanes of the row inside [begin, end).
+		static const std::uint8_t lanes[32] =
+		{
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+		};
+		__m128i inRange = _mm_andnot_si128(
+			_mm_loadu_si128((const __m128i*)(lanes + 16 - end)),
+			_mm_loadu_si128((const __m128i*)(lanes + 16 - begin)));
+
+		__m128i blocks = _mm_loadu_si128((const __m128i*)row);
+		__m128i replace = _mm_and_si128(_mm_cmpeq_epi8(blocks, _mm_set1_epi8((char)from)), inRange);
+		blocks = _mm_or_si128(_mm_andnot_si128(replace, blocks), _mm_and_si128(replace, _mm_set1_epi8((char)to)));
+		_mm_storeu_si128((__m128i*)row, blocks);
+#else
+		for(std::uint32_t x = begin; x < end; ++x)
+		{
+			if(row[x] == from)
+				row[x] = to;
+		}
+#endif
+	}
+
+	bool ChunkIsAll(const WorldChunk& chunk, BlockType type)
+	{
+		const BlockType* blocks = chunk.Data();
+		return blocks[0] == type && std::memcmp(blocks, blocks + 1, Dims::Volume - 1) == 0;
+	}
+}
+
+void FillBlocks(World& world, const BlockBox& box, BlockType type)
+{
+	BlockBox clipped = ClipToWorld(world, box);
+	if(clipped.Empty())
+		return;
+
+	ForEachChunkPart(clipped, [&](const ChunkPart& part)
+	{
+		if(part.Whole())
+		{
+			world.FillChunk(part.CX, part.CY, part.CZ, type);
+			return;
+		}
+
+		WorldChunk& chunk = world.EditChunk(part.CX, part.CY, part.CZ);
+		for(std::uint32_t y = part.MinY; y < part.MaxY; ++y)
+		{
+			for(std::uint32_t z = part.MinZ; z < part.MaxZ; ++z)
+				std::memset(chunk.Data() + Dims::Index(part.MinX, y, z), type, part.MaxX - part.MinX);
+		}
+	});
+
+	FinishEdit(world, clipped);
+}
+
+void ReplaceBlocks(World& world, const BlockBox& box, BlockType from, BlockType to)
+{
+	BlockBox clipped = ClipToWorld(world, box);
+	if(clipped.Empty() || from == to)
+		return;
+
+	ForEachChunkPart(clipped, [&](const ChunkPart& part)
+	{
+		// Nothing to replace leaves shared storage shared.
+		const WorldChunk& current = world.GetChunk(part.CX, part.CY, part.CZ);
+		if(std::find(current.Data(), current.Data() + Dims::Volume, from) == current.Data() + Dims::Volume)
+			return;
+
+		if(part.Whole() && ChunkIsAll(current, from))
+		{
+			world.FillChunk(part.CX, part.CY, part.CZ, to);
+			return;
+		}
+
+		WorldChunk& chunk = world.EditChunk(part.CX, part.CY, part.CZ);
+		for(std::uint32_t y = part.MinY; y < part.MaxY; ++y)
+		{
+			for(std::uint32_t z = part.MinZ; z < part.MaxZ; ++z)
+				ReplaceInRow(chunk.Data() + Dims::Index(0, y, z), part.MinX, part.MaxX, from, to);
+		}
+	});
+
+	FinishEdit(world, clipped);
+}
+
+void CloneBlocks(World& world, const BlockBox& source, std::int32_t dstX, std::int32_t dstY, std::int32_t dstZ)
+{
+	// Clip the destination to the world, and the source with it, then the source to
+	// the world, and the destination with that.
+	std::int32_t offsetX = dstX - source.MinX;
+	std::int32_t offsetY = dstY - source.MinY;
+	std::int32_t offsetZ = dstZ - source.MinZ;
+
+	BlockBox dst = ClipToWorld(world, MakeBlockBox(
+		source.MinX + offsetX, source.MinY + offsetY, source.MinZ + offsetZ,
+		source.MaxX + offsetX, source.MaxY + offsetY, source.MaxZ + offsetZ));
+	BlockBox src = ClipToWorld(world, MakeBlockBox(
+		dst.MinX - offsetX, dst.MinY - offsetY, dst.MinZ - offsetZ,
+		dst.MaxX - offsetX, dst.MaxY - offsetY, dst.MaxZ - offsetZ));
+	dst = MakeBlockBox(
+		src.MinX + offsetX, src.MinY + offsetY, src.MinZ + offsetZ,
+		src.MaxX + offsetX, src.MaxY + offsetY, src.MaxZ + offsetZ);
+	if(src.Empty())
+		return;
+
+	bool aligned = offsetX % (std::int32_t)Dims::SizeX == 0 && offsetY % (std::int32_t)Dims::SizeY == 0 &&
+		offsetZ % (std::int32_t)Dims::SizeZ == 0;
+
+	// The source is read in full before anything is written, so overlapping boxes copy
+	// what was there before the edit.  Whole aligned chunks keep a reference to their
+	// storage instead of a copy of their blocks.
+	std::uint32_t sizeX = src.MaxX - src.MinX, sizeY = src.MaxY - src.MinY, sizeZ = src.MaxZ - src.MinZ;
+	std::vector<BlockType> blocks((std::size_t)sizeX * sizeY * sizeZ);
+	std::vector<std::shared_ptr<const WorldChunk>> whole;
+
+	ForEachChunkPart(src, [&](const ChunkPart& part)
+	{
+		if(aligned && part.Whole())
+		{
+			whole.push_back(world.ShareChunk(part.CX, part.CY, part.CZ));
+			return;
+		}
+
+		const WorldChunk& chunk = world.GetChunk(part.CX, part.CY, part.CZ);
+		std::uint32_t baseX = part.CX * Dims::SizeX - src.MinX;
+		std::uint32_t baseY = part.CY * Dims::SizeY - src.MinY;
+		std::uint32_t baseZ = part.CZ * Dims::SizeZ - src.MinZ;
+		for(std::uint32_t y = part.MinY; y < part.MaxY; ++y)
+		{
+			for(std::uint32_t z = part.MinZ; z < part.MaxZ; ++z)
+			{
+				std::memcpy(&blocks[baseX + part.MinX + sizeX * ((baseZ + z) + (std::size_t)sizeZ * (baseY + y))],
+					chunk.Data() + Dims::Index(part.MinX, y, z), part.MaxX - part.MinX);
+			}
+		}
+	});
+
+	std::size_t nextWhole = 0;
+	ForEachChunkPart(dst, [&](const ChunkPart& part)
+	{
+		if(aligned && part.Whole())
+		{
+			// Taken in the same chunk order as the source, so the next one is this one's.
+			world.AdoptChunk(part.CX, part.CY, part.CZ, whole[nextWhole++]);
+			return;
+		}
+
+		WorldChunk& chunk = world.EditChunk(part.CX, part.CY, part.CZ);
+		std::uint32_t baseX = part.CX * Dims::SizeX - dst.MinX;
+		std::uint32_t baseY = part.CY * Dims::SizeY - dst.MinY;
+		std::uint32_t baseZ = part.CZ * Dims::SizeZ - dst.MinZ;
+		for(std::uint32_t y = part.MinY; y < part.MaxY; ++y)
+		{
+			for(std::uint32_t z = part.MinZ; z < part.MaxZ; ++z)
+			{
+				std::memcpy(chunk.Data() + Dims::Index(part.MinX, y, z),
+					&blocks[baseX + part.MinX + sizeX * ((baseZ + z) + (std::size_t)sizeZ * (baseY + y))], part.MaxX - part.MinX);
+			}
+		}
+	});
+
+	FinishEdit(world, dst);
+}
@@ -0,0 +1,24 @@
+//***************************************************************************************
+// WorldEdit.h
+//
+// Edits of whole boxes of blocks, for generating terrain, map tools and placing
+// structures.  They work a chunk at a time: a chunk the box covers completely is
+// replaced in one go by pointing it at shared storage, and the rest is written a row
+// at a time, sixteen blocks per SSE2 operation where a row allows.  Column tops are
+// refreshed and chunks marked for meshing once per edit, not once per block.
+//***************************************************************************************
+
+#pragma once
+
+#include "World.h"
+
+// Sets every block of box to type.  Parts of box outside the world are ignored.
+void FillBlocks(World& world, const BlockBox& box, BlockType type);
+
+// Sets every block of box that is from to to.
+void ReplaceBlocks(World& world, const BlockBox& box, BlockType from, BlockType to);
+
+// Copies the blocks of source to the box of the same size whose low corner is dstX,
+// dstY, dstZ.  The two may overlap.  Chunks copied whole and chunk aligned share
+// storage with their source until either is edited.
+void CloneBlocks(World& world, const BlockBox& source, std::int32_t dstX, std::int32_t dstY, std::int32_t dstZ);
@@ -0,0 +1,263 @@
+//***************************************************************************************
+// WorldFile.cpp
+//***************************************************************************************
+
+#include "WorldFile.h"
+#include "Terrain.h"
+
+#include <cstdio>
+
+namespace
+{
+	const std::uint32_t LevelMagic = 0x444c5742; // "BWLD"
+	const std::uint32_t LevelVersion = 3;
+
+	// Version 2 level files end before LevelInfo::Generator.
+	const std::uint32_t LevelVersionNoGenerator = 2;
+
+	struct LevelHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		LevelInfo Level;
+	};
+
+	std::uint32_t RegionsFor(std::uint32_t chunks)
+	{
+		return (chunks + RegionChunks - 1) / RegionChunks;
+	}
+
+	// The blocks chunk cx, cy, cz has before anyone edits it: generated from seed, or air
+	// in a world with no seed.
+	void BaseChunk(std::uint32_t seed, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, WorldChunk& chunk)
+	{
+		if(seed != 0)
+			GenerateTerrainChunk(seed, cx, cy, cz, chunk);
+		else
+			chunk.Fill(BlockType_Air);
+	}
+
+	// Writes chunk cx, cy, cz of world to its slot in region as a delta against its base
+	// chunk, or whole when that is smaller, and erases it when it equals its base.  base
+	// and encoded are scratch space.
+	bool StoreChunk(RegionFile& region, const World& world, std::uint32_t seed,
+		std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, WorldChunk& base, std::vector<std::uint8_t>& encoded)
+	{
+		BaseChunk(seed, cx, cy, cz, base);
+		encoded.clear();
+		ChunkCodec codec = EncodeChunkDelta(world.GetChunk(cx, cy, cz), base, encoded);
+
+		std::uint32_t lx = cx % RegionChunks;
+		std::uint32_t lz = cz % RegionChunks;
+		if(codec == ChunkCodec_Delta && encoded.empty())
+			return region.EraseChunk(lx, lz);
+		return region.WriteChunk(lx, lz, codec, encoded.data(), encoded.size());
+	}
+}
+
+bool ReadLevel(const std::string& prefix, LevelInfo& level)
+{
+	std::FILE* file = OpenBinaryFile(prefix + ".level", "rb");
+	if(file == nullptr)
+		return false;
+
+	LevelHeader header;
+	std::size_t read = std::fread(&header, 1, sizeof(header), file);
+	std::fclose(file);
+	if(read < sizeof(header.Magic) + sizeof(header.Version) || header.Magic != LevelMagic)
+		return false;
+
+	// Older files are still read, so their regions can be found and deleted, but with
+	// a generator no save matches.
+	if(header.Version == LevelVersionNoGenerator && read == sizeof(header) - sizeof(header.Level.Generator))
+		header.Level.Generator = 0;
+	else if(header.Version != LevelVersion || read != sizeof(header))
+		return false;
+
+	level = header.Level;
+	return true;
+}
+
+bool WriteLevel(const std::string& prefix, const LevelInfo& level)
+{
+	std::FILE* file = OpenBinaryFile(prefix + ".level", "wb");
+	if(file == nullptr)
+		return false;
+
+	LevelHeader header = { LevelMagic, LevelVersion, level };
+	bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	return std::fclose(file) == 0 && written;
+}
+
+void DeleteWorld(const std::string& prefix)
+{
+	LevelInfo level;
+	if(!ReadLevel(prefix, level))
+		return;
+
+	for(std::uint32_t cy = 0; cy < level.ChunksY; ++cy)
+	{
+		for(std::uint32_t rz = 0; rz < RegionsFor(level.ChunksZ); ++rz)
+		{
+			for(std::uint32_t rx = 0; rx < RegionsFor(level.ChunksX); ++rx)
+				std::remove(RegionPath(prefix, rx, cy, rz).c_str());
+		}
+	}
+	std::remove((prefix + ".level").c_str());
+}
+
+bool SaveWorld(const World& world, const std::string& prefix, std::uint32_t seed)
+{
+	LevelInfo level;
+	level.ChunksX = world.ChunksX();
+	level.ChunksY = world.ChunksY();
+	level.ChunksZ = world.ChunksZ();
+	level.Seed = seed;
+	if(!WriteLevel(prefix, level))
+		return false;
+
+	RegionFile region;
+	WorldChunk base;
+	std::vector<std::uint8_t> encoded;
+	for(std::uint32_t cy = 0; cy < world.ChunksY(); ++cy)
+	{
+		for(std::uint32_t rz = 0; rz < RegionsFor(world.ChunksZ()); ++rz)
+		{
+			for(std::uint32_t rx = 0; rx < RegionsFor(world.ChunksX()); ++rx)
+			{
+				if(!region.Open(RegionPath(prefix, rx, cy, rz), true))
+					return false;
+
+				for(std::uint32_t lz = 0; lz < RegionChunks; ++lz)
+				{
+					for(std::uint32_t lx = 0; lx < RegionChunks; ++lx)
+					{
+						std::uint32_t cx = rx * RegionChunks + lx;
+						std::uint32_t cz = rz * RegionChunks + lz;
+						if(cx >= world.ChunksX() || cz >= world.ChunksZ())
+							continue;
+
+						if(!StoreChunk(region, world, seed, cx, cy, cz, base, encoded))
+							return false;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool SaveChunk(const World& world, const std::string& prefix, std::uint32_t seed,
+	std::uint32_t cx, std::uint32_t cy, std::uint32_t cz)
+{
+	RegionFile region;
+	if(!region.Open(RegionPath(prefix, cx / RegionChunks, cy, cz / RegionChunks), true))
+		return false;
+
+	WorldChunk base;
+	std::vector<std::uint8_t> encoded;
+	return StoreChunk(region, world, seed, cx, cy, cz, base, encoded);
+}
+
+bool LoadWorld(World& world, const std::string& prefix)
+{
+	LevelInfo level;
+	if(!ReadLevel(prefix, level) || level.Generator != TerrainVersion)
+		return false;
+
+	world.Resize(level.ChunksX * WorldChunk::Dims::SizeX, level.ChunksY * WorldChunk::Dims::SizeY,
+		level.ChunksZ * WorldChunk::Dims::SizeZ);
+
+	// A region at a time, so each is mapped and read through once, decoding chunks
+	// straight from the mapped pages.
+	RegionMapCache regions(prefix, RegionAccess_Sequential, 1);
+	LoadedChunk chunk;
+	for(std::uint32_t cy = 0; cy < world.ChunksY(); ++cy)
+	{
+		for(std::uint32_t rz = 0; rz < RegionsFor(world.ChunksZ()); ++rz)
+		{
+			for(std::uint32_t rx = 0; rx < RegionsFor(world.ChunksX()); ++rx)
+			{
+				for(std::uint32_t lz = 0; lz < RegionChunks; ++lz)
+				{
+					for(std::uint32_t lx = 0; lx < RegionChunks; ++lx)
+					{
+						std::uint32_t cx = rx * RegionChunks + lx;
+						std::uint32_t cz = rz * RegionChunks + lz;
+						if(cx >= world.ChunksX() || cz >= world.ChunksZ())
+							continue;
+
+						if(!LoadChunk(regions, level.Seed, cx, cy, cz, chunk))
+							return false;
+						PlaceChunk(world, cx, cy, cz, chunk);
+					}
+				}
+			}
+		}
+	}
+
+	for(std::uint32_t cz = 0; cz < world.ChunksZ(); ++cz)
+	{
+		for(std::uint32_t cx = 0; cx < world.ChunksX(); ++cx)
+			world.RefreshSurface(cx, cz);
+	}
+
+	world.Compact();
+	return true;
+}
+
+bool LoadChunk(RegionMapCache& regions, std::uint32_t seed, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz,
+	LoadedChunk& chunk)
+{
+	chunk.Blocks.reset();
+	chunk.Uniform = BlockType_Air;
+
+	ChunkPayload payload;
+	if(regions.ReadChunk(cx, cy, cz, payload))
+	{
+		if(EncodedChunkUniform(payload.Codec, payload.Data, payload.Size, chunk.Uniform))
+			return true;
+
+		chunk.Blocks = std::make_shared<WorldChunk>();
+		if(payload.Codec == ChunkCodec_Delta)
+			BaseChunk(seed, cx, cy, cz, *chunk.Blocks);
+		if(!DecodeChunk(payload.Codec, payload.Data, payload.Size, *chunk.Blocks))
+			return false;
+
+		// Edits can leave a chunk of one type, which is shared rather than kept.
+		if(payload.Codec == ChunkCodec_Delta && chunk.Blocks->IsUniform())
+		{
+			chunk.Uniform = (*chunk.Blocks)[0];
+			chunk.Blocks.reset();
+		}
+		return true;
+	}
+
+	GenerateChunk(seed, cx, cy, cz, chunk);
+	return true;
+}
+
+void GenerateChunk(std::uint32_t seed, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, LoadedChunk& chunk)
+{
+	chunk.Blocks.reset();
+	chunk.Uniform = BlockType_Air;
+	if(seed == 0)
+		return;
+
+	chunk.Blocks = std::make_shared<WorldChunk>();
+	GenerateTerrainChunk(seed, cx, cy, cz, *chunk.Blocks);
+	if(chunk.Blocks->IsUniform())
+	{
+		chunk.Uniform = (*chunk.Blocks)[0];
+		chunk.Blocks.reset();
+	}
+}
+
+void PlaceChunk(World& world, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, const LoadedChunk& chunk)
+{
+	if(chunk.Blocks)
+		world.AdoptChunk(cx, cy, cz, chunk.Blocks);
+	else
+		world.FillChunk(cx, cy, cz, chunk.Uniform);
+}
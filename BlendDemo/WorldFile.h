@@ -0,0 +1,80 @@
+//***************************************************************************************
+// WorldFile.h
+//
+// Saving a world to region files and loading it back.  A small level file next to
+// the regions records the world's size, the seed its terrain was generated from and
+// the version of the generator.
+// A chunk that is not in the regions is generated again from the seed, or is air in
+// a world with no seed; uniform chunks load as the world's shared chunk of their type
+// without being decoded.
+//
+// Generation is a pure function of the seed and the chunk, so only edits need saving.
+// A chunk is stored as the runs of blocks that differ from its generated blocks,
+// which loading generates again and patches, and whole only when that is smaller.  A
+// chunk nobody edited is not stored at all.
+//***************************************************************************************
+
+#pragma once
+
+#include "MappedRegion.h"
+#include "Terrain.h"
+#include "World.h"
+
+#include <memory>
+#include <string>
+
+// What the level file holds.  A seed of zero means the world was not generated.
+// Generator is the TerrainVersion the chunks were saved against, zero in level files
+// written before it was recorded.
+struct LevelInfo
+{
+	std::uint32_t ChunksX = 0;
+	std::uint32_t ChunksY = 0;
+	std::uint32_t ChunksZ = 0;
+	std::uint32_t Seed = 0;
+	std::uint32_t Generator = TerrainVersion;
+};
+
+bool ReadLevel(const std::string& prefix, LevelInfo& level);
+bool WriteLevel(const std::string& prefix, const LevelInfo& level);
+
+// Removes the level file of the save at prefix and every region file it covers, so a
+// new world does not pick up the chunks of an old one.
+void DeleteWorld(const std::string& prefix);
+
+// Writes world to prefix.level and the region files prefix.rx.ry.rz.region.  Chunks
+// that equal what they would be generated as, or air in a world with no seed, are
+// left out.  Returns false when a file cannot be written.
+bool SaveWorld(const World& world, const std::string& prefix, std::uint32_t seed);
+
+// Writes chunk cx, cy, cz of world into its region file at prefix, creating the file
+// when there is none, as SaveWorld would with seed.  Returns false when it cannot be
+// written.
+bool SaveChunk(const World& world, const std::string& prefix, std::uint32_t seed,
+	std::uint32_t cx, std::uint32_t cy, std::uint32_t cz);
+
+// Replaces world with the one saved at prefix, compacted and with every chunk dirty,
+// reading the regions through sequential mappings.  Returns false, leaving world in
+// an unspecified state, when there is no save, it is damaged, or it was saved against
+// another TerrainVersion.
+bool LoadWorld(World& world, const std::string& prefix);
+
+// The blocks of one chunk as loaded: Blocks, or when that is empty, Uniform.
+struct LoadedChunk
+{
+	std::shared_ptr<WorldChunk> Blocks;
+	BlockType Uniform = BlockType_Air;
+};
+
+// Reads chunk cx, cy, cz from regions, or generates it from seed when it is not stored.
+// Touches nothing but regions and chunk, so chunks load on any thread that has its
+// own RegionMapCache.  Returns false when the stored chunk does not decode.
+bool LoadChunk(RegionMapCache& regions, std::uint32_t seed, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz,
+	LoadedChunk& chunk);
+
+// Generates chunk cx, cy, cz from seed, or makes it air when seed is zero.
+void GenerateChunk(std::uint32_t seed, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, LoadedChunk& chunk);
+
+// Points chunk cx, cy, cz of world at the loaded blocks.  Like World::FillChunk it
+// leaves column tops and dirty chunks to the caller.
+void PlaceChunk(World& world, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, const LoadedChunk& chunk);